@@ -0,0 +1,267 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "Arduino.h"
+#include "simClock.h"
+#include "simBoard.h"
+#include <stdarg.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+/**
+ * Temporizador hardware simulado con un hilo
+ */
+struct hw_timer_s
+{
+    uint16_t divider = 80;
+    uint64_t alarm_ticks = 0;
+    void (*isr)(void) = NULL;
+    std::atomic<bool> enabled;
+    std::thread thread;
+};
+
+// El reloj de los temporizadores del ESP32 es de 80 MHz
+static const uint32_t TIMER_BASE_HZ = 80000000;
+// Espera minima del hilo de un temporizador en el host
+static const uint32_t TIMER_MIN_SLEEP_US = 20;
+
+static uint32_t ledc_duty[16];
+static uint32_t random_seed = 0x12345678;
+
+static String numberToString(unsigned long value, unsigned char base, bool negative)
+{
+    char buffer[sizeof(unsigned long) * 8 + 2];
+    char *p = buffer + sizeof(buffer) - 1;
+    *p = '\0';
+
+    base = base < 2 ? 10 : base;
+    do
+    {
+        unsigned long digit = value % base;
+        *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+        value /= base;
+    } while (value > 0);
+
+    if (negative)
+    {
+        *--p = '-';
+    }
+
+    return String(p);
+}
+
+String::String(unsigned char value, unsigned char base) : String(numberToString(value, base, false)) {}
+String::String(int value, unsigned char base) : String(base == 10 && value < 0 ? numberToString(-(long)value, base, true) : numberToString((unsigned int)value, base, false)) {}
+String::String(unsigned int value, unsigned char base) : String(numberToString(value, base, false)) {}
+String::String(long value, unsigned char base) : String(base == 10 && value < 0 ? numberToString(-(unsigned long)value, base, true) : numberToString((unsigned long)value, base, false)) {}
+String::String(unsigned long value, unsigned char base) : String(numberToString(value, base, false)) {}
+String::String(float value, unsigned char decimals) : String((double)value, decimals) {}
+
+String::String(double value, unsigned char decimals)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+    assign(buffer);
+}
+
+size_t HardwareSerial::print(const String &value) { return fputs(value.c_str(), stdout) >= 0 ? value.length() : 0; }
+size_t HardwareSerial::print(const char *value) { return print(String(value)); }
+size_t HardwareSerial::print(char value) { return print(String(value)); }
+size_t HardwareSerial::print(int value) { return print(String(value)); }
+size_t HardwareSerial::print(unsigned int value) { return print(String(value)); }
+size_t HardwareSerial::print(long value) { return print(String(value)); }
+size_t HardwareSerial::print(unsigned long value) { return print(String(value)); }
+size_t HardwareSerial::print(double value, int decimals) { return print(String(value, decimals)); }
+size_t HardwareSerial::println() { return print("\n"); }
+
+size_t HardwareSerial::printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int result = vprintf(format, args);
+    va_end(args);
+
+    return result > 0 ? result : 0;
+}
+
+void HardwareSerial::flush()
+{
+    fflush(stdout);
+}
+
+HardwareSerial Serial;
+
+unsigned long millis()
+{
+    return DomDomSimClock.millis();
+}
+
+unsigned long micros()
+{
+    return DomDomSimClock.micros();
+}
+
+void delay(uint32_t ms)
+{
+    DomDomSimClock.sleep((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    DomDomSimClock.sleep(us);
+}
+
+void yield()
+{
+    std::this_thread::yield();
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    DomDomSimBoard.pinMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    DomDomSimBoard.digitalWrite(pin, value);
+}
+
+int digitalRead(uint8_t pin)
+{
+    return DomDomSimBoard.digitalRead(pin);
+}
+
+void dacWrite(uint8_t pin, uint8_t value)
+{
+    DomDomSimBoard.dacWrite(pin, value);
+}
+
+int digitalPinToInterrupt(uint8_t pin)
+{
+    return pin;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode)
+{
+    DomDomSimBoard.attachInterrupt(pin, isr, NULL, NULL, mode);
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode)
+{
+    DomDomSimBoard.attachInterrupt(pin, NULL, isr, arg, mode);
+}
+
+void detachInterrupt(uint8_t pin)
+{
+    DomDomSimBoard.detachInterrupt(pin);
+}
+
+void ledcSetup(uint8_t channel, double frequency, uint8_t resolution) {}
+void ledcAttachPin(uint8_t pin, uint8_t channel) {}
+
+void ledcWrite(uint8_t channel, uint32_t duty)
+{
+    if (channel < 16)
+    {
+        ledc_duty[channel] = duty;
+    }
+}
+
+hw_timer_t *timerBegin(uint8_t timer, uint16_t divider, bool countUp)
+{
+    hw_timer_t *result = new hw_timer_t();
+    result->divider = divider > 0 ? divider : 1;
+    result->enabled = false;
+
+    return result;
+}
+
+void timerEnd(hw_timer_t *timer)
+{
+    timerAlarmDisable(timer);
+    delete timer;
+}
+
+void timerAttachInterrupt(hw_timer_t *timer, void (*isr)(void), bool edge)
+{
+    timer->isr = isr;
+}
+
+void timerDetachInterrupt(hw_timer_t *timer)
+{
+    timerAlarmDisable(timer);
+    timer->isr = NULL;
+}
+
+void timerAlarmWrite(hw_timer_t *timer, uint64_t ticks, bool autoreload)
+{
+    timer->alarm_ticks = ticks;
+}
+
+void timerAlarmEnable(hw_timer_t *timer)
+{
+    if (timer->enabled || timer->isr == NULL || timer->alarm_ticks == 0)
+    {
+        return;
+    }
+
+    timer->enabled = true;
+    timer->thread = std::thread([timer]
+    {
+        uint64_t period_us = timer->alarm_ticks * timer->divider * 1000000ULL / TIMER_BASE_HZ;
+        while (timer->enabled)
+        {
+            std::chrono::microseconds wait = DomDomSimClock.hostDuration(period_us);
+            std::this_thread::sleep_for(wait.count() < TIMER_MIN_SLEEP_US ? std::chrono::microseconds(TIMER_MIN_SLEEP_US) : wait);
+
+            portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+            portENTER_CRITICAL_ISR(&mux);
+            timer->isr();
+            portEXIT_CRITICAL_ISR(&mux);
+        }
+    });
+}
+
+void timerAlarmDisable(hw_timer_t *timer)
+{
+    timer->enabled = false;
+    if (timer->thread.joinable())
+    {
+        timer->thread.join();
+    }
+}
+
+uint32_t esp_random()
+{
+    random_seed = random_seed * 1664525UL + 1013904223UL;
+    return random_seed;
+}
+
+long random(long max)
+{
+    return max > 0 ? esp_random() % max : 0;
+}
+
+long random(long min, long max)
+{
+    return min < max ? min + random(max - min) : min;
+}
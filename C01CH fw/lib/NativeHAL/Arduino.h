@@ -0,0 +1,180 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_NATIVE_ARDUINO_h
+#define DOMDOM_NATIVE_ARDUINO_h
+
+/**
+ * Sustituto de Arduino.h para el entorno native.
+ *
+ * Declara el subconjunto del nucleo Arduino-ESP32 que usa el firmware.
+ * El tiempo sale del reloj simulado (simClock.h), los pines, el DAC y
+ * las interrupciones de la placa simulada (simBoard.h) y las tareas de
+ * hilos POSIX (nativeRTOS.h).
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "nativeRTOS.h"
+
+#define ARDUINO_ARCH_NATIVE
+
+#define IRAM_ATTR
+#define PROGMEM
+#define pgm_read_byte(addr)     (*(const unsigned char *)(addr))
+#define memcpy_P                memcpy
+
+#define LOW             0x0
+#define HIGH            0x1
+#define INPUT           0x01
+#define OUTPUT          0x02
+#define INPUT_PULLUP    0x05
+#define RISING          0x01
+#define FALLING         0x02
+#define CHANGE          0x03
+
+#define B111            7
+#define B00000111       7
+
+#define bitRead(value, bit)     (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit)      ((value) |= (1UL << (bit)))
+#define bitClear(value, bit)    ((value) &= ~(1UL << (bit)))
+#define word(high, low)         ((uint16_t)(((high) << 8) | (low)))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+using std::isnan;
+using std::isinf;
+
+/**
+ * Cadena compatible con la clase String de Arduino.
+ */
+class String : public std::string
+{
+    public:
+        String() {};
+        String(const char *value) : std::string(value != NULL ? value : "") {};
+        String(const std::string &value) : std::string(value) {};
+        String(char value) : std::string(1, value) {};
+        explicit String(unsigned char value, unsigned char base = 10);
+        explicit String(int value, unsigned char base = 10);
+        explicit String(unsigned int value, unsigned char base = 10);
+        explicit String(long value, unsigned char base = 10);
+        explicit String(unsigned long value, unsigned char base = 10);
+        explicit String(float value, unsigned char decimals = 2);
+        explicit String(double value, unsigned char decimals = 2);
+
+        bool concat(const String &value) { append(value); return true; };
+        bool concat(const char *value) { if (value != NULL) append(value); return true; };
+        bool concat(char value) { push_back(value); return true; };
+        bool concat(unsigned char value) { return concat(String(value)); };
+        bool concat(int value) { return concat(String(value)); };
+        bool concat(unsigned int value) { return concat(String(value)); };
+        bool concat(long value) { return concat(String(value)); };
+        bool concat(unsigned long value) { return concat(String(value)); };
+        bool concat(float value) { return concat(String(value)); };
+        bool concat(double value) { return concat(String(value)); };
+
+        template <typename T>
+        String &operator+=(const T &value) { concat(value); return *this; };
+
+        int toInt() const { return atoi(c_str()); };
+        float toFloat() const { return atof(c_str()); };
+        bool equals(const String &value) const { return *this == value; };
+};
+
+template <typename T>
+String operator+(const String &left, const T &right) { String result(left); result.concat(right); return result; }
+inline String operator+(const char *left, const String &right) { String result(left); result.concat(right); return result; }
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+/**
+ * Puerto serie. Escribe en la salida estandar.
+ */
+class HardwareSerial
+{
+    public:
+        void begin(unsigned long baud) {};
+        size_t print(const String &value);
+        size_t print(const char *value);
+        size_t print(char value);
+        size_t print(int value);
+        size_t print(unsigned int value);
+        size_t print(long value);
+        size_t print(unsigned long value);
+        size_t print(double value, int decimals = 2);
+        size_t println();
+        template <typename T>
+        size_t println(const T &value) { return print(value) + println(); };
+        size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+        void flush();
+};
+
+extern HardwareSerial Serial;
+
+// Tiempo (reloj simulado)
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// Pines, DAC e interrupciones (placa simulada)
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void dacWrite(uint8_t pin, uint8_t value);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// PWM. Solo guarda el ultimo valor
+void ledcSetup(uint8_t channel, double frequency, uint8_t resolution);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+// Temporizadores hardware. Cada temporizador activo es un hilo
+typedef struct hw_timer_s hw_timer_t;
+hw_timer_t *timerBegin(uint8_t timer, uint16_t divider, bool countUp);
+void timerEnd(hw_timer_t *timer);
+void timerAttachInterrupt(hw_timer_t *timer, void (*isr)(void), bool edge);
+void timerDetachInterrupt(hw_timer_t *timer);
+void timerAlarmWrite(hw_timer_t *timer, uint64_t ticks, bool autoreload);
+void timerAlarmEnable(hw_timer_t *timer);
+void timerAlarmDisable(hw_timer_t *timer);
+
+uint32_t esp_random();
+long random(long max);
+long random(long min, long max);
+
+#endif /* DOMDOM_NATIVE_ARDUINO_h */
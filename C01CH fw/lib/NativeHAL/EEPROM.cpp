@@ -0,0 +1,145 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "EEPROM.h"
+
+EEPROMClass::EEPROMClass()
+{
+    const char *file = getenv("DOMDOM_EEPROM_FILE");
+    _file = file != NULL ? file : EEPROM_NATIVE_DEFAULT_FILE;
+    _dirty = false;
+}
+
+bool EEPROMClass::begin(size_t size)
+{
+    if (size == 0)
+    {
+        return false;
+    }
+
+    // Como en el ESP32, una segunda llamada con mas tamaño conserva los datos
+    if (_data.size() >= size)
+    {
+        return true;
+    }
+
+    _data.assign(size, 0xFF);
+
+    FILE *f = fopen(_file.c_str(), "rb");
+    if (f != NULL)
+    {
+        size_t read = fread(&_data[0], 1, size, f);
+        (void)read;
+        fclose(f);
+    }
+
+    _dirty = false;
+    return true;
+}
+
+bool EEPROMClass::commit()
+{
+    if (_data.empty())
+    {
+        return false;
+    }
+
+    if (!_dirty)
+    {
+        return true;
+    }
+
+    FILE *f = fopen(_file.c_str(), "wb");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    bool result = fwrite(&_data[0], 1, _data.size(), f) == _data.size();
+    fclose(f);
+
+    _dirty = !result;
+    return result;
+}
+
+void EEPROMClass::end()
+{
+    commit();
+    _data.clear();
+}
+
+size_t EEPROMClass::readString(int address, char *value, size_t length)
+{
+    size_t i = 0;
+    while (i + 1 < length && address + i < _data.size() && _data[address + i] != 0)
+    {
+        value[i] = _data[address + i];
+        i++;
+    }
+
+    if (length > 0)
+    {
+        value[i] = '\0';
+    }
+
+    return i;
+}
+
+String EEPROMClass::readString(int address)
+{
+    String value;
+    for (size_t i = address; i < _data.size() && _data[i] != 0; i++)
+    {
+        value.concat((char)_data[i]);
+    }
+
+    return value;
+}
+
+size_t EEPROMClass::readBytes(int address, void *value, size_t length)
+{
+    if (address < 0 || address + length > _data.size())
+    {
+        return 0;
+    }
+
+    memcpy(value, &_data[address], length);
+    return length;
+}
+
+size_t EEPROMClass::writeString(int address, const char *value)
+{
+    return writeBytes(address, value, strlen(value) + 1);
+}
+
+size_t EEPROMClass::writeBytes(int address, const void *value, size_t length)
+{
+    if (address < 0 || address + length > _data.size())
+    {
+        return 0;
+    }
+
+    memcpy(&_data[address], value, length);
+    _dirty = true;
+    return length;
+}
+
+EEPROMClass EEPROM;
@@ -0,0 +1,125 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_NATIVE_EEPROM_h
+#define DOMDOM_NATIVE_EEPROM_h
+
+#include "Arduino.h"
+
+#define EEPROM_NATIVE_DEFAULT_FILE  "eeprom.bin"
+
+/**
+ * EEPROM del ESP32 guardada en un fichero del host.
+ *
+ * begin() carga el fichero (o lo deja borrado a 0xFF) y commit()
+ * lo escribe entero, igual que la emulacion sobre flash del ESP32.
+ * El fichero se puede cambiar con setFile() o con la variable de
+ * entorno DOMDOM_EEPROM_FILE.
+ */
+class EEPROMClass
+{
+    private:
+        std::vector<uint8_t> _data;
+        String _file;
+        bool _dirty;
+
+        template <typename T>
+        T readValue(int address) const
+        {
+            T value = T();
+            if (address >= 0 && address + sizeof(T) <= _data.size())
+            {
+                memcpy(&value, &_data[address], sizeof(T));
+            }
+            return value;
+        };
+        template <typename T>
+        size_t writeValue(int address, const T &value)
+        {
+            if (address < 0 || address + sizeof(T) > _data.size())
+            {
+                return 0;
+            }
+            memcpy(&_data[address], &value, sizeof(T));
+            _dirty = true;
+            return sizeof(T);
+        };
+
+    public:
+        EEPROMClass();
+        /**
+         * Cambia el fichero. Debe llamarse antes de begin().
+         */
+        void setFile(const char *file) { _file = file; };
+        bool begin(size_t size);
+        bool commit();
+        void end();
+        uint16_t length() const { return _data.size(); };
+
+        uint8_t read(int address) { return readValue<uint8_t>(address); };
+        void write(int address, uint8_t value) { writeValue(address, value); };
+
+        template <typename T>
+        T &get(int address, T &value) { value = readValue<T>(address); return value; };
+        template <typename T>
+        const T &put(int address, const T &value) { writeValue(address, value); return value; };
+
+        uint8_t readByte(int address) { return readValue<uint8_t>(address); };
+        int8_t readChar(int address) { return readValue<int8_t>(address); };
+        uint8_t readUChar(int address) { return readValue<uint8_t>(address); };
+        int16_t readShort(int address) { return readValue<int16_t>(address); };
+        uint16_t readUShort(int address) { return readValue<uint16_t>(address); };
+        int32_t readInt(int address) { return readValue<int32_t>(address); };
+        uint32_t readUInt(int address) { return readValue<uint32_t>(address); };
+        int32_t readLong(int address) { return readValue<int32_t>(address); };
+        uint32_t readULong(int address) { return readValue<uint32_t>(address); };
+        int64_t readLong64(int address) { return readValue<int64_t>(address); };
+        uint64_t readULong64(int address) { return readValue<uint64_t>(address); };
+        float readFloat(int address) { return readValue<float>(address); };
+        double readDouble(int address) { return readValue<double>(address); };
+        bool readBool(int address) { return readValue<uint8_t>(address) != 0; };
+        size_t readString(int address, char *value, size_t length);
+        String readString(int address);
+        size_t readBytes(int address, void *value, size_t length);
+
+        size_t writeByte(int address, uint8_t value) { return writeValue(address, value); };
+        size_t writeChar(int address, int8_t value) { return writeValue(address, value); };
+        size_t writeUChar(int address, uint8_t value) { return writeValue(address, value); };
+        size_t writeShort(int address, int16_t value) { return writeValue(address, value); };
+        size_t writeUShort(int address, uint16_t value) { return writeValue(address, value); };
+        size_t writeInt(int address, int32_t value) { return writeValue(address, value); };
+        size_t writeUInt(int address, uint32_t value) { return writeValue(address, value); };
+        size_t writeLong(int address, int32_t value) { return writeValue(address, value); };
+        size_t writeULong(int address, uint32_t value) { return writeValue(address, value); };
+        size_t writeLong64(int address, int64_t value) { return writeValue(address, value); };
+        size_t writeULong64(int address, uint64_t value) { return writeValue(address, value); };
+        size_t writeFloat(int address, float value) { return writeValue(address, value); };
+        size_t writeDouble(int address, double value) { return writeValue(address, value); };
+        size_t writeBool(int address, bool value) { return writeValue(address, (uint8_t)(value ? 1 : 0)); };
+        size_t writeString(int address, const char *value);
+        size_t writeString(int address, String value) { return writeString(address, value.c_str()); };
+        size_t writeBytes(int address, const void *value, size_t length);
+};
+
+extern EEPROMClass EEPROM;
+
+#endif /* DOMDOM_NATIVE_EEPROM_h */
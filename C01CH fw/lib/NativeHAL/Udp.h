@@ -0,0 +1,52 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_NATIVE_UDP_h
+#define DOMDOM_NATIVE_UDP_h
+
+#include "Arduino.h"
+
+/**
+ * Socket UDP del host sin red.
+ *
+ * Los envios se descartan y nunca llega ningun paquete, asi el cliente
+ * NTP compila y se comporta como si el servidor no respondiera.
+ */
+class UDP
+{
+    public:
+        virtual ~UDP() {};
+        virtual uint8_t begin(uint16_t port) { return 1; };
+        virtual void stop() {};
+        virtual int beginPacket(const char *host, uint16_t port) { return 1; };
+        virtual int endPacket() { return 1; };
+        virtual size_t write(uint8_t value) { return 1; };
+        virtual size_t write(const uint8_t *buffer, size_t size) { return size; };
+        virtual int parsePacket() { return 0; };
+        virtual int available() { return 0; };
+        virtual int read() { return -1; };
+        virtual int read(unsigned char *buffer, size_t len) { return 0; };
+        virtual int read(char *buffer, size_t len) { return 0; };
+        virtual void flush() {};
+};
+
+#endif /* DOMDOM_NATIVE_UDP_h */
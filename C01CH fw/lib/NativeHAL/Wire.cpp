@@ -0,0 +1,100 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "Wire.h"
+#include "simBoard.h"
+
+TwoWire::TwoWire()
+{
+    _address = 0;
+    _tx_length = 0;
+    _rx_length = 0;
+    _rx_index = 0;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    _address = address;
+    _tx_length = 0;
+}
+
+uint8_t TwoWire::endTransmission(bool stop)
+{
+    DomDomSimI2CDevice *device = DomDomSimBoard.device(_address);
+    if (device == NULL)
+    {
+        return 2;
+    }
+
+    if (_tx_length > 0)
+    {
+        device->i2cWrite(_tx, _tx_length);
+    }
+
+    _tx_length = 0;
+    return 0;
+}
+
+size_t TwoWire::write(uint8_t value)
+{
+    if (_tx_length >= I2C_BUFFER_LENGTH)
+    {
+        return 0;
+    }
+
+    _tx[_tx_length++] = value;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t length)
+{
+    size_t written = 0;
+    while (written < length && write(data[written]))
+    {
+        written++;
+    }
+
+    return written;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t length, bool stop)
+{
+    _rx_index = 0;
+    _rx_length = 0;
+
+    DomDomSimI2CDevice *device = DomDomSimBoard.device(address);
+    if (device == NULL)
+    {
+        return 0;
+    }
+
+    length = length > I2C_BUFFER_LENGTH ? I2C_BUFFER_LENGTH : length;
+    _rx_length = device->i2cRead(_rx, length);
+
+    return _rx_length;
+}
+
+int TwoWire::read()
+{
+    return available() > 0 ? _rx[_rx_index++] : -1;
+}
+
+TwoWire Wire;
@@ -0,0 +1,65 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_NATIVE_WIRE_h
+#define DOMDOM_NATIVE_WIRE_h
+
+#include "Arduino.h"
+
+#define I2C_BUFFER_LENGTH   128
+
+/**
+ * Bus I2C sobre los dispositivos de la placa simulada.
+ *
+ * endTransmission() devuelve 2 (NACK de direccion) si no hay ningun
+ * dispositivo en la direccion, como el bus real.
+ */
+class TwoWire
+{
+    private:
+        uint8_t _address;
+        uint8_t _tx[I2C_BUFFER_LENGTH];
+        size_t _tx_length;
+        uint8_t _rx[I2C_BUFFER_LENGTH];
+        size_t _rx_length;
+        size_t _rx_index;
+
+    public:
+        TwoWire();
+        bool begin() { return true; };
+        bool begin(int sda, int scl, uint32_t frequency = 0) { return true; };
+        void setClock(uint32_t frequency) {};
+        void beginTransmission(uint8_t address);
+        void beginTransmission(int address) { beginTransmission((uint8_t)address); };
+        uint8_t endTransmission(bool stop = true);
+        size_t write(uint8_t value);
+        size_t write(const uint8_t *data, size_t length);
+        uint8_t requestFrom(uint8_t address, uint8_t length, bool stop = true);
+        uint8_t requestFrom(int address, int length) { return requestFrom((uint8_t)address, (uint8_t)length); };
+        int available() { return _rx_length - _rx_index; };
+        int read();
+        int peek() { return available() > 0 ? _rx[_rx_index] : -1; };
+};
+
+extern TwoWire Wire;
+
+#endif /* DOMDOM_NATIVE_WIRE_h */
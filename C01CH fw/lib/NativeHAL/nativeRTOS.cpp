@@ -0,0 +1,263 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "nativeRTOS.h"
+#include "simClock.h"
+#include <pthread.h>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+
+/**
+ * Tarea: un hilo con su contador de notificaciones
+ */
+struct DomDomNativeTask
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t notifications = 0;
+    TaskFunction_t function = NULL;
+    void *parameter = NULL;
+    std::string name;
+    pthread_t thread;
+};
+
+/**
+ * Semaforo contador con limite (1 para mutex y binarios)
+ */
+struct DomDomNativeSemaphore
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t count = 0;
+    uint32_t max = 1;
+};
+
+// Las secciones criticas se excluyen entre si como con las interrupciones desactivadas
+static std::recursive_mutex critical;
+
+// Tarea del hilo actual. Los hilos que no crea xTaskCreate (main) reciben una al pedirla
+static thread_local DomDomNativeTask *current_task = NULL;
+
+// Los hilos del host necesitan mas pila que las tareas del ESP32
+static const size_t MIN_STACK_SIZE = 256 * 1024;
+
+void portENTER_CRITICAL(portMUX_TYPE *mux)
+{
+    critical.lock();
+}
+
+void portEXIT_CRITICAL(portMUX_TYPE *mux)
+{
+    critical.unlock();
+}
+
+static void *taskEntry(void *parameter)
+{
+    DomDomNativeTask *task = (DomDomNativeTask *)parameter;
+    current_task = task;
+
+    task->function(task->parameter);
+
+    // Una tarea de FreeRTOS no debe volver, si lo hace la borramos
+    vTaskDelete(NULL);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack, void *parameter, UBaseType_t priority, TaskHandle_t *handle)
+{
+    DomDomNativeTask *task = new DomDomNativeTask();
+    task->function = function;
+    task->parameter = parameter;
+    task->name = name != NULL ? name : "";
+
+    // Como en FreeRTOS el handle esta disponible antes de que la tarea se ejecute
+    if (handle != NULL)
+    {
+        *handle = task;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, stack > MIN_STACK_SIZE ? stack : MIN_STACK_SIZE);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    int result = pthread_create(&task->thread, &attr, taskEntry, task);
+    pthread_attr_destroy(&attr);
+
+    if (result != 0)
+    {
+        if (handle != NULL)
+        {
+            *handle = NULL;
+        }
+        delete task;
+        return pdFAIL;
+    }
+
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack, void *parameter, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    return xTaskCreate(function, name, stack, parameter, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    // La estructura de la tarea no se libera para que una notificacion
+    // tardia no acceda a memoria liberada (FreeRTOS tambien la libera despues)
+    if (task == NULL || task == current_task)
+    {
+        pthread_exit(NULL);
+    }
+
+    pthread_cancel(task->thread);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    DomDomSimClock.sleep((uint64_t)ticks * 1000);
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return DomDomSimClock.millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    if (current_task == NULL)
+    {
+        current_task = new DomDomNativeTask();
+        current_task->name = "main";
+        current_task->thread = pthread_self();
+    }
+
+    return current_task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notifications++;
+    task->cv.notify_all();
+
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotifyGive(task);
+
+    if (woken != NULL)
+    {
+        *woken = pdTRUE;
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    DomDomNativeTask *task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->mutex);
+
+    if (ticks == portMAX_DELAY)
+    {
+        task->cv.wait(lock, [task] { return task->notifications > 0; });
+    }
+    else if (ticks > 0)
+    {
+        task->cv.wait_for(lock, DomDomSimClock.hostDuration((uint64_t)ticks * 1000), [task] { return task->notifications > 0; });
+    }
+
+    uint32_t value = task->notifications;
+    if (value > 0)
+    {
+        task->notifications = clear ? 0 : value - 1;
+    }
+
+    return value;
+}
+
+static SemaphoreHandle_t createSemaphore(uint32_t count)
+{
+    DomDomNativeSemaphore *semaphore = new DomDomNativeSemaphore();
+    semaphore->count = count;
+    semaphore->max = 1;
+
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return createSemaphore(1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return createSemaphore(0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+
+    if (ticks == portMAX_DELAY)
+    {
+        semaphore->cv.wait(lock, [semaphore] { return semaphore->count > 0; });
+    }
+    else if (!semaphore->cv.wait_for(lock, DomDomSimClock.hostDuration((uint64_t)ticks * 1000), [semaphore] { return semaphore->count > 0; }))
+    {
+        return pdFALSE;
+    }
+
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if (semaphore->count >= semaphore->max)
+    {
+        return pdFALSE;
+    }
+
+    semaphore->count++;
+    semaphore->cv.notify_one();
+
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken)
+{
+    if (woken != NULL)
+    {
+        *woken = pdTRUE;
+    }
+
+    return xSemaphoreGive(semaphore);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+    delete semaphore;
+}
@@ -0,0 +1,264 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "simBoard.h"
+#include "simINA226.h"
+#include "simClock.h"
+#include "Arduino.h"
+
+DomDomSimBoardClass::DomDomSimBoardClass()
+{
+    _running = false;
+    _last_step_us = 0;
+}
+
+DomDomSimBoardClass::~DomDomSimBoardClass()
+{
+    end();
+}
+
+void DomDomSimBoardClass::addDevice(DomDomSimI2CDevice *device)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _devices.push_back(device);
+}
+
+void DomDomSimBoardClass::addINA(DomDomSimINA226 *ina)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _devices.push_back(ina);
+    _inas.push_back(ina);
+}
+
+DomDomSimI2CDevice *DomDomSimBoardClass::device(uint8_t address)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    for (DomDomSimI2CDevice *device : _devices)
+    {
+        if (device->address() == address)
+        {
+            return device;
+        }
+    }
+
+    return NULL;
+}
+
+void DomDomSimBoardClass::begin()
+{
+    if (_running)
+    {
+        return;
+    }
+
+    _running = true;
+    _last_step_us = DomDomSimClock.micros();
+    _thread = std::thread([this]
+    {
+        while (_running)
+        {
+            step();
+            std::this_thread::sleep_for(std::chrono::microseconds(SIM_BOARD_STEP_US));
+        }
+    });
+}
+
+void DomDomSimBoardClass::end()
+{
+    _running = false;
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+float DomDomSimBoardClass::sampleDac(uint8_t pin, uint64_t now)
+{
+    Pin &p = _pins[pin];
+    uint64_t integral = p.dac_integral + (uint64_t)p.dac * (now - p.dac_changed_us);
+    uint64_t elapsed = now - p.dac_sampled_us;
+
+    float code = elapsed > 0 ? (float)(integral - p.dac_sampled_integral) / elapsed : p.dac;
+
+    p.dac_sampled_integral = integral;
+    p.dac_sampled_us = now;
+
+    return code;
+}
+
+void DomDomSimBoardClass::step()
+{
+    std::vector<uint8_t> edges;
+    uint64_t now;
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+        now = DomDomSimClock.micros();
+        float dt_s = (now - _last_step_us) / 1e6f;
+        _last_step_us = now;
+
+        for (DomDomSimINA226 *ina : _inas)
+        {
+            float dac_V = ina->dac_pin < SIM_BOARD_PINS ? sampleDac(ina->dac_pin, now) * SIM_BOARD_DAC_VOLTS / 255 : 0;
+            ina->step(now, dac_V, dt_s);
+
+            // El pin de alerta es de drenador abierto y activo a nivel bajo
+            if (ina->alert_pin >= 0 && ina->alert_pin < SIM_BOARD_PINS)
+            {
+                uint8_t level = ina->alert() ? LOW : HIGH;
+                if (level != _pins[ina->alert_pin].level)
+                {
+                    _pins[ina->alert_pin].level = level;
+                    edges.push_back(ina->alert_pin);
+                }
+            }
+        }
+    }
+
+    for (uint8_t pin : edges)
+    {
+        edge(pin, !_pins[pin].level, _pins[pin].level);
+    }
+}
+
+void DomDomSimBoardClass::edge(uint8_t pin, uint8_t from, uint8_t to)
+{
+    Interrupt interrupt;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        interrupt = _pins[pin].interrupt;
+    }
+
+    bool fire = (interrupt.mode == CHANGE && from != to) ||
+                (interrupt.mode == FALLING && from == HIGH && to == LOW) ||
+                (interrupt.mode == RISING && from == LOW && to == HIGH);
+    if (!fire)
+    {
+        return;
+    }
+
+    // Como en el ESP32 la interrupcion espera a que terminen las secciones criticas
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    portENTER_CRITICAL_ISR(&mux);
+    if (interrupt.isr_arg != NULL)
+    {
+        interrupt.isr_arg(interrupt.arg);
+    }
+    else if (interrupt.isr != NULL)
+    {
+        interrupt.isr();
+    }
+    portEXIT_CRITICAL_ISR(&mux);
+}
+
+void DomDomSimBoardClass::pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin >= SIM_BOARD_PINS)
+    {
+        return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _pins[pin].mode = mode;
+}
+
+void DomDomSimBoardClass::digitalWrite(uint8_t pin, uint8_t value)
+{
+    if (pin >= SIM_BOARD_PINS)
+    {
+        return;
+    }
+
+    uint8_t from;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        from = _pins[pin].level;
+        _pins[pin].level = value ? HIGH : LOW;
+    }
+
+    edge(pin, from, value ? HIGH : LOW);
+}
+
+int DomDomSimBoardClass::digitalRead(uint8_t pin)
+{
+    if (pin >= SIM_BOARD_PINS)
+    {
+        return LOW;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    return _pins[pin].level;
+}
+
+void DomDomSimBoardClass::dacWrite(uint8_t pin, uint8_t value)
+{
+    if (pin >= SIM_BOARD_PINS)
+    {
+        return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    uint64_t now = DomDomSimClock.micros();
+
+    Pin &p = _pins[pin];
+    p.dac_integral += (uint64_t)p.dac * (now - p.dac_changed_us);
+    p.dac_changed_us = now;
+    p.dac = value;
+}
+
+uint8_t DomDomSimBoardClass::dac(uint8_t pin)
+{
+    if (pin >= SIM_BOARD_PINS)
+    {
+        return 0;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    return _pins[pin].dac;
+}
+
+void DomDomSimBoardClass::attachInterrupt(uint8_t pin, void (*isr)(void), void (*isr_arg)(void *), void *arg, int mode)
+{
+    if (pin >= SIM_BOARD_PINS)
+    {
+        return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _pins[pin].interrupt.isr = isr;
+    _pins[pin].interrupt.isr_arg = isr_arg;
+    _pins[pin].interrupt.arg = arg;
+    _pins[pin].interrupt.mode = mode;
+}
+
+void DomDomSimBoardClass::detachInterrupt(uint8_t pin)
+{
+    if (pin >= SIM_BOARD_PINS)
+    {
+        return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    _pins[pin].interrupt = Interrupt();
+}
+
+DomDomSimBoardClass DomDomSimBoard;
@@ -0,0 +1,162 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_SIMBOARD_h
+#define DOMDOM_SIMBOARD_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+#define SIM_BOARD_PINS          40
+#define SIM_BOARD_DAC_VOLTS     3.3f
+// Cada cuanto (us del host) la placa actualiza las cargas y los INA
+#define SIM_BOARD_STEP_US       100
+
+class DomDomSimINA226;
+
+/**
+ * Dispositivo del bus I2C simulado.
+ */
+class DomDomSimI2CDevice
+{
+    public:
+        virtual ~DomDomSimI2CDevice() {};
+        /**
+         * Direccion I2C del dispositivo
+         */
+        virtual uint8_t address() const = 0;
+        /**
+         * Recibe una escritura completa (beginTransmission ... endTransmission).
+         */
+        virtual void i2cWrite(const uint8_t *data, size_t length) = 0;
+        /**
+         * Rellena @data con @length bytes para un requestFrom.
+         */
+        virtual size_t i2cRead(uint8_t *data, size_t length) = 0;
+};
+
+/**
+ * Placa simulada.
+ *
+ * Guarda el estado de los pines y del DAC, despacha las interrupciones
+ * y mantiene un hilo que hace avanzar las cargas de los canales y las
+ * conversiones de los INA conectados al bus I2C.
+ */
+class DomDomSimBoardClass
+{
+    private:
+        /**
+         * Interrupcion asociada a un pin
+         */
+        struct Interrupt
+        {
+            void (*isr)(void) = NULL;
+            void (*isr_arg)(void *) = NULL;
+            void *arg = NULL;
+            int mode = 0;
+        };
+        /**
+         * Estado de un pin. El DAC guarda la integral del codigo para
+         * poder promediar el tramado entre dos pasos de la placa.
+         * Hasta la primera escritura el DAC esta al maximo, como la
+         * entrada de los drivers con su resistencia de pull-up.
+         */
+        struct Pin
+        {
+            uint8_t mode = 0;
+            uint8_t level = 1;
+            uint8_t dac = 255;
+            uint64_t dac_integral = 0;
+            uint64_t dac_changed_us = 0;
+            uint64_t dac_sampled_integral = 0;
+            uint64_t dac_sampled_us = 0;
+            Interrupt interrupt;
+        };
+
+        std::recursive_mutex _mutex;
+        Pin _pins[SIM_BOARD_PINS];
+        std::vector<DomDomSimI2CDevice *> _devices;
+        std::vector<DomDomSimINA226 *> _inas;
+
+        std::thread _thread;
+        std::atomic<bool> _running;
+        uint64_t _last_step_us;
+
+        /**
+         * Codigo DAC medio de @pin desde la ultima muestra
+         */
+        float sampleDac(uint8_t pin, uint64_t now);
+        /**
+         * Ejecuta la interrupcion de @pin si @from -> @to coincide con su modo.
+         */
+        void edge(uint8_t pin, uint8_t from, uint8_t to);
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomSimBoardClass();
+        /**
+         * Destructor. Para el hilo de la placa.
+         */
+        ~DomDomSimBoardClass();
+        /**
+         * Conecta @device al bus I2C. La placa no toma su propiedad.
+         */
+        void addDevice(DomDomSimI2CDevice *device);
+        /**
+         * Conecta un INA al bus I2C y a su pin DAC y de alerta.
+         */
+        void addINA(DomDomSimINA226 *ina);
+        /**
+         * Dispositivo con la direccion @address o NULL
+         */
+        DomDomSimI2CDevice *device(uint8_t address);
+        /**
+         * Inicia y para el hilo que hace avanzar la simulacion.
+         */
+        void begin();
+        void end();
+        /**
+         * Un paso de la simulacion. Lo llama el hilo de la placa.
+         */
+        void step();
+
+        void pinMode(uint8_t pin, uint8_t mode);
+        void digitalWrite(uint8_t pin, uint8_t value);
+        int digitalRead(uint8_t pin);
+        void dacWrite(uint8_t pin, uint8_t value);
+        /**
+         * Ultimo codigo escrito en el DAC de @pin
+         */
+        uint8_t dac(uint8_t pin);
+        void attachInterrupt(uint8_t pin, void (*isr)(void), void (*isr_arg)(void *), void *arg, int mode);
+        void detachInterrupt(uint8_t pin);
+};
+
+extern DomDomSimBoardClass DomDomSimBoard;
+
+#endif /* DOMDOM_SIMBOARD_h */
@@ -0,0 +1,71 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "simClock.h"
+#include <thread>
+
+DomDomSimClockClass::DomDomSimClockClass()
+{
+    _base = host_clock::now();
+    _base_us = 0;
+    _scale = 1;
+}
+
+uint64_t DomDomSimClockClass::micros() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    double elapsed = std::chrono::duration<double, std::micro>(host_clock::now() - _base).count();
+    return _base_us + (uint64_t)(elapsed * _scale);
+}
+
+void DomDomSimClockClass::setScale(double scale)
+{
+    uint64_t now = micros();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _base = host_clock::now();
+    _base_us = now;
+    _scale = scale > 0 ? scale : 1;
+}
+
+double DomDomSimClockClass::scale() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _scale;
+}
+
+void DomDomSimClockClass::advance(uint64_t us)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _base_us += us;
+}
+
+std::chrono::microseconds DomDomSimClockClass::hostDuration(uint64_t us) const
+{
+    return std::chrono::microseconds((uint64_t)(us / scale()));
+}
+
+void DomDomSimClockClass::sleep(uint64_t us) const
+{
+    std::this_thread::sleep_for(hostDuration(us));
+}
+
+DomDomSimClockClass DomDomSimClock;
@@ -0,0 +1,92 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_SIMCLOCK_h
+#define DOMDOM_SIMCLOCK_h
+
+#include <stdint.h>
+#include <mutex>
+#include <chrono>
+
+/**
+ * Reloj simulado del que salen millis(), micros() y los ticks.
+ *
+ * Avanza con el reloj del host multiplicado por la velocidad, y se
+ * puede adelantar a saltos. Las esperas (delay, timeouts de las
+ * tareas) duran el tiempo simulado dividido por la velocidad.
+ */
+class DomDomSimClockClass
+{
+    private:
+        typedef std::chrono::steady_clock host_clock;
+        /**
+         * Protege el cambio de velocidad y los saltos
+         */
+        mutable std::mutex _mutex;
+        /**
+         * Instante del host y tiempo simulado (us) desde el ultimo cambio
+         */
+        host_clock::time_point _base;
+        uint64_t _base_us;
+        /**
+         * Velocidad del reloj simulado respecto al del host
+         */
+        double _scale;
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomSimClockClass();
+        /**
+         * Microsegundos simulados desde el arranque
+         */
+        uint64_t micros() const;
+        /**
+         * Milisegundos simulados desde el arranque
+         */
+        uint32_t millis() const { return micros() / 1000; };
+        /**
+         * Cambia la velocidad del reloj (1 = tiempo real).
+         */
+        void setScale(double scale);
+        /**
+         * Velocidad del reloj
+         */
+        double scale() const;
+        /**
+         * Adelanta el reloj @us microsegundos.
+         */
+        void advance(uint64_t us);
+        /**
+         * Duracion en el host de una espera de @us microsegundos simulados
+         */
+        std::chrono::microseconds hostDuration(uint64_t us) const;
+        /**
+         * Duerme el hilo actual @us microsegundos simulados.
+         */
+        void sleep(uint64_t us) const;
+};
+
+extern DomDomSimClockClass DomDomSimClock;
+
+#endif /* DOMDOM_SIMCLOCK_h */
@@ -0,0 +1,327 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "simINA226.h"
+#include <math.h>
+
+static const uint16_t AVERAGES[8] = { 1, 4, 16, 64, 128, 256, 512, 1024 };
+static const uint16_t CONVERSION_US[8] = { 140, 204, 332, 588, 1100, 2116, 4156, 8244 };
+
+static const uint16_t CONFIG_RESET          = 0x8000;
+static const uint16_t CONFIG_DEFAULT        = 0x4127;
+static const uint16_t MASK_FUNCTIONS        = 0xFC00;
+static const uint16_t MASK_LIMITS           = 0xF800;
+static const uint16_t MASK_CONVERSION       = 1 << 10;
+static const uint16_t MASK_ALERT_FLAG       = 1 << 4;
+static const uint16_t MASK_CONVERSION_READY = 1 << 3;
+static const uint16_t MASK_LATCH            = 1 << 0;
+static const uint16_t MANUFACTURER_ID       = 0x5449;
+static const uint16_t DIE_ID                = 0x2260;
+
+// LSB del registro de shunt (2.5 uV) y de bus (1.25 mV)
+static const float SHUNT_LSB_V  = 2.5e-6f;
+static const float BUS_LSB_V    = 1.25e-3f;
+
+void DomDomSimLedLoad::update(float dac_V, float dt_s, uint32_t &seed)
+{
+    float alpha = tau_ms > 0 ? 1 - expf(-dt_s * 1000 / tau_ms) : 1;
+    input_V += (dac_V - input_V) * alpha;
+
+    float drive = cutoff_V > 0 ? 1 - input_V / cutoff_V : 0;
+    drive = drive < 0 ? 0 : (drive > 1 ? 1 : drive);
+    float target_mA = full_mA * powf(drive, gamma);
+
+    // Generador congruencial para que dos simulaciones iguales den lo mismo
+    seed = seed * 1664525UL + 1013904223UL;
+    float noise = ((seed >> 8) / 16777216.0f * 2 - 1) * noise_mA;
+
+    current_mA = target_mA > 0 ? target_mA + noise : 0;
+    current_mA = current_mA < 0 ? 0 : current_mA;
+
+    // Sin corriente los leds quedan por debajo de su tension de codo
+    bus_V = leds * (current_mA > 0 ? forward_V + resistance_ohm * current_mA / 1000 : forward_V * 0.9f);
+}
+
+DomDomSimINA226::DomDomSimINA226(uint8_t address, uint32_t shunt_micro_ohm, uint8_t dac_pin, int alert_pin)
+{
+    _address = address;
+    _shunt_micro_ohm = shunt_micro_ohm;
+    _seed = address;
+    this->dac_pin = dac_pin;
+    this->alert_pin = alert_pin;
+
+    _conversion_start_us = 0;
+    reset();
+}
+
+void DomDomSimINA226::reset()
+{
+    _pointer = 0;
+    _config = CONFIG_DEFAULT;
+    _calibration = 0;
+    _mask = 0;
+    _limit = 0;
+    _shunt = 0;
+    _bus = 0;
+    _alert = false;
+    _idle = false;
+    _sum_mA = 0;
+    _sum_V = 0;
+    _sum_s = 0;
+}
+
+uint32_t DomDomSimINA226::conversionTime() const
+{
+    uint32_t averages = AVERAGES[(_config >> 9) & 7];
+    uint32_t bus_us = CONVERSION_US[(_config >> 6) & 7];
+    uint32_t shunt_us = CONVERSION_US[(_config >> 3) & 7];
+
+    switch (_config & 7)
+    {
+        case 1:
+        case 5:
+            return averages * shunt_us;
+        case 2:
+        case 6:
+            return averages * bus_us;
+        case 3:
+        case 7:
+            return averages * (bus_us + shunt_us);
+        default:
+            return 0;
+    }
+}
+
+void DomDomSimINA226::convert()
+{
+    float mA = _sum_s > 0 ? _sum_mA / _sum_s : load.current_mA;
+    float volts = _sum_s > 0 ? _sum_V / _sum_s : load.bus_V;
+    _sum_mA = 0;
+    _sum_V = 0;
+    _sum_s = 0;
+
+    if (_config & 1)
+    {
+        float raw = roundf(mA / 1000 * (_shunt_micro_ohm / 1e6f) / SHUNT_LSB_V);
+        _shunt = raw > INT16_MAX ? INT16_MAX : (raw < INT16_MIN ? INT16_MIN : (int16_t)raw);
+    }
+
+    if (_config & 2)
+    {
+        float raw = roundf(volts / BUS_LSB_V);
+        _bus = raw > 0x7FFF ? 0x7FFF : (raw < 0 ? 0 : (uint16_t)raw);
+    }
+
+    _mask |= MASK_CONVERSION_READY;
+
+    // Solo el limite de mayor prioridad esta activo. El fin de conversion se puede
+    // combinar con el y el flag de cada uno dice cual ha activado el pin
+    uint16_t function = 0;
+    for (uint8_t bit = 15; bit >= 11 && function == 0; bit--)
+    {
+        function = _mask & (1 << bit);
+    }
+
+    if (function == 0)
+    {
+        updateAlert();
+        return;
+    }
+
+    int32_t current = (int32_t)_shunt * _calibration / 2048;
+    int32_t power = current * _bus / 20000;
+
+    bool fault;
+    switch (function)
+    {
+        case 1 << 15: fault = _shunt > (int16_t)_limit; break;
+        case 1 << 14: fault = _shunt < (int16_t)_limit; break;
+        case 1 << 13: fault = _bus > _limit; break;
+        case 1 << 12: fault = _bus < _limit; break;
+        case 1 << 11: fault = power > _limit; break;
+        default: fault = true; break;
+    }
+
+    if (fault)
+    {
+        _mask |= MASK_ALERT_FLAG;
+    }
+    else if (!(_mask & MASK_LATCH))
+    {
+        // Sin enclavar la alerta de un limite sigue a la condicion
+        _mask &= ~MASK_ALERT_FLAG;
+    }
+
+    updateAlert();
+}
+
+void DomDomSimINA226::updateAlert()
+{
+    bool conversion = (_mask & MASK_CONVERSION) && (_mask & MASK_CONVERSION_READY);
+    bool limit = (_mask & MASK_LIMITS) && (_mask & MASK_ALERT_FLAG);
+    _alert = conversion || limit;
+}
+
+uint16_t DomDomSimINA226::readRegister(uint8_t reg)
+{
+    switch (reg)
+    {
+        case 0x00:
+            return _config;
+        case 0x01:
+            return (uint16_t)_shunt;
+        case 0x02:
+            return _bus;
+        case 0x03:
+            return (uint16_t)((int32_t)_shunt * _calibration / 2048 * _bus / 20000);
+        case 0x04:
+            return (uint16_t)(int16_t)((int32_t)_shunt * _calibration / 2048);
+        case 0x05:
+            return _calibration;
+        case 0x06:
+        {
+            // Leer la mascara borra el flag de conversion, y el del limite si esta enclavado
+            uint16_t value = _mask;
+            _mask &= ~MASK_CONVERSION_READY;
+            if (_mask & MASK_LATCH)
+            {
+                _mask &= ~MASK_ALERT_FLAG;
+            }
+            updateAlert();
+            return value;
+        }
+        case 0x07:
+            return _limit;
+        case 0xFE:
+            return MANUFACTURER_ID;
+        case 0xFF:
+            return DIE_ID;
+        default:
+            return 0xFFFF;
+    }
+}
+
+void DomDomSimINA226::writeRegister(uint8_t reg, uint16_t value)
+{
+    switch (reg)
+    {
+        case 0x00:
+            if (value & CONFIG_RESET)
+            {
+                reset();
+            }
+            else
+            {
+                // Escribir la configuracion reinicia la conversion
+                _config = (value & 0x7FFF) | 0x4000;
+                _mask &= ~MASK_CONVERSION_READY;
+                _sum_mA = 0;
+                _sum_V = 0;
+                _sum_s = 0;
+                _conversion_start_us = 0;
+                _idle = false;
+            }
+            break;
+        case 0x05:
+            _calibration = value & 0x7FFF;
+            break;
+        case 0x06:
+            _mask = (value & (MASK_FUNCTIONS | 0x0003)) | (_mask & 0x001C);
+            updateAlert();
+            break;
+        case 0x07:
+            _limit = value;
+            break;
+        default:
+            break;
+    }
+}
+
+void DomDomSimINA226::i2cWrite(const uint8_t *data, size_t length)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (length >= 1)
+    {
+        _pointer = data[0];
+    }
+
+    if (length >= 3)
+    {
+        writeRegister(_pointer, ((uint16_t)data[1] << 8) | data[2]);
+    }
+}
+
+size_t DomDomSimINA226::i2cRead(uint8_t *data, size_t length)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint16_t value = readRegister(_pointer);
+    for (size_t i = 0; i < length; i++)
+    {
+        data[i] = i % 2 == 0 ? value >> 8 : value & 0xFF;
+    }
+
+    return length;
+}
+
+void DomDomSimINA226::step(uint64_t now_us, float dac_V, float dt_s)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    load.update(dac_V, dt_s, _seed);
+
+    uint32_t duration = conversionTime();
+    if (duration == 0 || _idle)
+    {
+        return;
+    }
+
+    if (_conversion_start_us == 0)
+    {
+        _conversion_start_us = now_us;
+    }
+
+    _sum_mA += load.current_mA * dt_s;
+    _sum_V += load.bus_V * dt_s;
+    _sum_s += dt_s;
+
+    if (now_us - _conversion_start_us >= duration)
+    {
+        convert();
+
+        // Si la placa se ha retrasado no acumulamos conversiones pendientes
+        _conversion_start_us += duration;
+        if (now_us - _conversion_start_us >= duration)
+        {
+            _conversion_start_us = now_us;
+        }
+
+        // En modo disparado solo se hace una conversion por escritura de la configuracion
+        _idle = !(_config & 4);
+    }
+}
+
+bool DomDomSimINA226::alert()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _alert;
+}
@@ -0,0 +1,162 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_SIMINA226_h
+#define DOMDOM_SIMINA226_h
+
+#include <stdint.h>
+#include <mutex>
+#include "simBoard.h"
+
+/**
+ * Carga de un canal: driver de corriente controlado por la tension
+ * del DAC y una tira de leds.
+ *
+ * La salida esta invertida como en la placa, la corriente baja al
+ * subir el codigo DAC hasta cortarse en @cutoff_V. La entrada del
+ * driver tiene un filtro RC que promedia el tramado del DAC.
+ */
+struct DomDomSimLedLoad
+{
+    /**
+     * Corriente con el DAC a 0 V
+     */
+    float full_mA = 700;
+    /**
+     * Tension del DAC a partir de la cual el driver no conduce
+     */
+    float cutoff_V = 2.5f;
+    /**
+     * Curvatura de la respuesta del driver (1 lineal)
+     */
+    float gamma = 1.3f;
+    /**
+     * Numero de leds en serie, caida de cada uno sin corriente y resistencia dinamica
+     */
+    uint8_t leds = 3;
+    float forward_V = 2.8f;
+    float resistance_ohm = 1.0f;
+    /**
+     * Constante de tiempo del filtro de entrada
+     */
+    float tau_ms = 1.0f;
+    /**
+     * Ruido de la corriente (pico)
+     */
+    float noise_mA = 0.3f;
+
+    /**
+     * Estado: tension filtrada a la entrada, corriente y tension en los leds
+     */
+    float input_V = SIM_BOARD_DAC_VOLTS;
+    float current_mA = 0;
+    float bus_V = 0;
+
+    /**
+     * Avanza @dt_s segundos con el DAC a @dac_V.
+     */
+    void update(float dac_V, float dt_s, uint32_t &seed);
+};
+
+/**
+ * INA226 simulado a nivel de registros.
+ *
+ * Responde en el bus I2C como el integrado: identificacion, reset,
+ * calibracion, promedio y tiempos de conversion, registro de
+ * mascara con el flag de conversion lista y el pin de alerta para
+ * la conversion y los limites.
+ */
+class DomDomSimINA226 : public DomDomSimI2CDevice
+{
+    private:
+        uint8_t _address;
+        uint32_t _shunt_micro_ohm;
+        uint8_t _pointer;
+
+        uint16_t _config;
+        uint16_t _calibration;
+        uint16_t _mask;
+        uint16_t _limit;
+        int16_t _shunt;
+        uint16_t _bus;
+
+        /**
+         * Acumuladores de la conversion en curso
+         */
+        double _sum_mA, _sum_V, _sum_s;
+        uint64_t _conversion_start_us;
+        bool _alert;
+        /**
+         * En modo disparado, la conversion ya se ha hecho
+         */
+        bool _idle;
+        uint32_t _seed;
+
+        std::mutex _mutex;
+
+        void reset();
+        /**
+         * Duracion (us) de una conversion con la configuracion actual, 0 si esta parado
+         */
+        uint32_t conversionTime() const;
+        /**
+         * Termina la conversion en curso y actualiza los flags y el pin de alerta.
+         */
+        void convert();
+        /**
+         * Pone el pin de alerta segun las funciones activas y sus flags.
+         */
+        void updateAlert();
+        uint16_t readRegister(uint8_t reg);
+        void writeRegister(uint8_t reg, uint16_t value);
+
+    public:
+        /**
+         * Pines del DAC que controla la carga y de la alerta (-1 sin conectar)
+         */
+        uint8_t dac_pin;
+        int alert_pin;
+        /**
+         * Carga del canal
+         */
+        DomDomSimLedLoad load;
+
+        /**
+         * Constructor
+         */
+        DomDomSimINA226(uint8_t address, uint32_t shunt_micro_ohm, uint8_t dac_pin, int alert_pin);
+
+        uint8_t address() const override { return _address; };
+        void i2cWrite(const uint8_t *data, size_t length) override;
+        size_t i2cRead(uint8_t *data, size_t length) override;
+
+        /**
+         * Avanza la carga y las conversiones hasta @now_us con el DAC a @dac_V.
+         */
+        void step(uint64_t now_us, float dac_V, float dt_s);
+        /**
+         * Indica si el pin de alerta esta activo (a nivel bajo)
+         */
+        bool alert();
+};
+
+#endif /* DOMDOM_SIMINA226_h */
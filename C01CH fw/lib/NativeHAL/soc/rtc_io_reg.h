@@ -0,0 +1,41 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_NATIVE_RTC_IO_REG_h
+#define DOMDOM_NATIVE_RTC_IO_REG_h
+
+#include "../Arduino.h"
+
+/**
+ * Registros del DAC. En el host cada registro es el pin de su DAC
+ * y escribirlo equivale a dacWrite.
+ */
+#define RTC_IO_PAD_DAC1_REG     25
+#define RTC_IO_PAD_DAC2_REG     26
+#define RTC_IO_PDAC1_DAC        0xFF
+#define RTC_IO_PDAC2_DAC        0xFF
+#define RTC_IO_PDAC1_DAC_S      19
+#define RTC_IO_PDAC2_DAC_S      19
+
+#define SET_PERI_REG_BITS(reg, bits, value, shift)  dacWrite((reg), (value) & (bits))
+
+#endif /* DOMDOM_NATIVE_RTC_IO_REG_h */
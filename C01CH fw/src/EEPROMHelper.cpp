@@ -74,6 +74,86 @@ void EEPROMInit()
     EEPROM.writeString(EEPROM_NTP_TIMEZONEPOSIX_ADDRESS, NTP_POSIX_TIMEZONE);
     /************************************************************/
 
+    /** BLOQUES AÑADIDOS DESPUES DE LA PRIMERA VERSION */
+    EEPROMUpgrade();
+}
+
+void EEPROMUpgrade()
+{
+    /** DIRECCIONES EEPROM DEL CANAL */
+    // GANANCIAS DEL CONTROLADOR Y TABLA DE CALIBRACION DE CADA CANAL
+    for (int i = 0; i < CHANNEL_SIZE; i++)
+    {
+        int address = EEPROM_CHANNEL_CONTROL_ADDRESS + i * EEPROM_CHANNEL_CONTROL_BLOCK_SIZE;
+        EEPROM.writeFloat(address, CHANNEL_CONTROL_KP);
+        address += 4;
+        EEPROM.writeFloat(address, CHANNEL_CONTROL_KI);
+        address += 4;
+        EEPROM.write(address, CHANNEL_BRIGHTNESS_CURVE);
+        address += 1;
+        EEPROM.writeFloat(address, CHANNEL_RAMP_MAX_SLEW);
+        address += 4;
+        EEPROM.writeBool(address, false);
+    }
+
+    // RESTO DE CANALES
+    for (int i = 1; i < CHANNEL_SIZE; i++)
+    {
+        EEPROM.write(EEPROM_CHANNEL_EXTRA_ADDRESS + (i - 1) * EEPROM_CHANNEL_SLOT_SIZE, 0);
+    }
+
+    // CONTADORES DE ENERGIA
+    for (int i = 0; i < CHANNEL_SIZE; i++)
+    {
+        EEPROM.writeBool(EEPROM_CHANNEL_ENERGY_ADDRESS + i * EEPROM_CHANNEL_ENERGY_SIZE, false);
+    }
+    /************************************************************/
+
+    /** DIRECCION EEPROM DE LA AGENDA */
+    // PROGRAMACION SOLAR
+    int address = EEPROM_SCHEDULE_SOLAR_ADDRESS;
+    EEPROM.writeBool(address, false);
+    address += 1;
+    EEPROM.writeFloat(address, SCHEDULE_SOLAR_LATITUDE);
+    address += 4;
+    EEPROM.writeFloat(address, SCHEDULE_SOLAR_LONGITUDE);
+    address += 4;
+    for (int i = 0; i < CHANNEL_SIZE; i++)
+    {
+        EEPROM.write(address++, 100);
+    }
+    // LUZ DE LUNA
+    address = EEPROM_SCHEDULE_MOON_ADDRESS;
+    EEPROM.writeBool(address, false);
+    address += 1;
+    for (int i = 0; i < CHANNEL_SIZE; i++)
+    {
+        EEPROM.write(address++, SCHEDULE_MOON_PERCENT);
+    }
+    /************************************************************/
+
+    /** EFECTO DE NUBES Y RAYOS */
+    address = EEPROM_WEATHER_ADDRESS;
+    EEPROM.writeBool(address, false);
+    address += 1;
+    EEPROM.writeULong(address, WEATHER_SEED);
+    address += 4;
+    EEPROM.writeUShort(address, WEATHER_CLOUDS_PER_HOUR);
+    address += 2;
+    EEPROM.write(address, WEATHER_CLOUD_DEPTH);
+    address += 1;
+    EEPROM.writeUShort(address, WEATHER_CLOUD_MIN_S);
+    address += 2;
+    EEPROM.writeUShort(address, WEATHER_CLOUD_MAX_S);
+    address += 2;
+    EEPROM.writeUShort(address, WEATHER_FLASHES_PER_HOUR);
+    address += 2;
+    EEPROM.write(address, WEATHER_FLASH_INTENSITY);
+    /************************************************************/
+
+    /** VERSION DE LA DISTRIBUCION */
+    EEPROM.write(EEPROM_LAYOUT_VERSION_ADDRESS, EEPROM_LAYOUT_VERSION);
+
     /** Confirmamos cambios */
     EEPROM.commit();
 }
@@ -85,4 +165,9 @@ void EEPROMCheck()
         Serial.print("Detectado primer arranque. Inicializando EEPROM\n");
         EEPROMInit();
     }
+    else if (EEPROM.read(EEPROM_LAYOUT_VERSION_ADDRESS) != EEPROM_LAYOUT_VERSION)
+    {
+        Serial.print("Detectada EEPROM de una version anterior. Inicializando los bloques nuevos\n");
+        EEPROMUpgrade();
+    }
 }
@@ -30,7 +30,14 @@
 void EEPROMInit();
 
 /**
- * Comprueba si es el primer arranque y en caso de serlo inicializa la EEPROM.
+ * Inicializa a los valores por defecto los bloques añadidos a la EEPROM despues
+ * de la primera version y guarda la version actual de la distribucion.
+ */
+void EEPROMUpgrade();
+
+/**
+ * Comprueba si es el primer arranque y en caso de serlo inicializa la EEPROM. Si la EEPROM
+ * es de una version anterior inicializa solo los bloques nuevos.
  */
 void EEPROMCheck();
 
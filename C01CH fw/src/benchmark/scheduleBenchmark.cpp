@@ -0,0 +1,349 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Medida en el host (env:benchmark) de la programacion.
+ *
+ * Compara el recorrido lineal que construia un DateTime por punto con la
+ * busqueda binaria en la linea de tiempo ordenada, para todos los minutos
+ * de un dia. Que devuelven lo mismo lo comprueba test/test_timeline.
+ *
+ * Cuenta ademas las reservas de memoria al subir muchas veces una
+ * programacion completa, las lecturas que hacen otros hilos mientras se
+ * publican programaciones y el tiempo de cada consulta al efecto de nubes
+ * y rayos. Que no haya reservas ni lecturas mezcladas lo comprueban
+ * test/test_points y test/test_publish.
+ *
+ * Uso: program [-p puntos] [-n repeticiones]
+ */
+
+#include <Arduino.h>
+#include <chrono>
+#include <new>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <RTClib.h>
+#include "configuration.h"
+#include "channel/schedulePoint.h"
+#include "channel/scheduleTimeline.h"
+#include "channel/compiledSchedule.h"
+#include "channel/weather.h"
+
+/**
+ * Reservas de memoria hechas con new desde el inicio del programa
+ */
+static uint32_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *memory = malloc(size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+/**
+ * Busqueda lineal anterior a la linea de tiempo.
+ */
+static int linearSchedulePoint(const DomDomSchedulePointList &points, DateTime now, DateTime &dt, bool previous)
+{
+    now = now - TimeSpan(now.second());
+
+    DateTime ultimaHora;
+    int punto = -1;
+
+    for (int i = 0; i < points.size(); i++)
+    {
+        DateTime scheduleDT(now.year(), now.month(), now.day(), points[i].hour, points[i].minute, 0);
+        TimeSpan day(1, 0, 0, 0);
+
+        if (previous && scheduleDT > now)
+        {
+            scheduleDT = scheduleDT - day;
+        }
+
+        if (!previous && scheduleDT <= now)
+        {
+            scheduleDT = scheduleDT + day;
+        }
+
+        bool candidate = previous ? scheduleDT <= now : scheduleDT > now;
+        bool better = previous ? scheduleDT > ultimaHora : scheduleDT < ultimaHora;
+        if (candidate && (punto == -1 || better))
+        {
+            ultimaHora = scheduleDT;
+            punto = i;
+        }
+    }
+
+    dt = ultimaHora;
+    return punto;
+}
+
+/**
+ * Busqueda en la linea de tiempo, igual que DomDomScheduleMgtClass::getShedulePoint.
+ */
+static int timelineSchedulePoint(const DomDomScheduleTimeline &timeline, const DateTime &now, DateTime &dt, bool previous)
+{
+    uint16_t minute = now.hour() * 60 + now.minute();
+    const DomDomTimelineEntry *entry;
+    int32_t at;
+
+    uint8_t weekday = now.dayOfTheWeek();
+    if (!(previous ? timeline.previous(weekday, minute, entry, at) : timeline.next(weekday, minute, entry, at)))
+    {
+        return -1;
+    }
+
+    DateTime today(now.year(), now.month(), now.day(), 0, 0, 0);
+    dt = today + TimeSpan(at * 60);
+
+    return entry->point;
+}
+
+/**
+ * Mide el tiempo de cada consulta al efecto de nubes y rayos durante @hours horas a 100 Hz.
+ */
+static double measureWeather(uint32_t hours)
+{
+    DomDomWeatherSettings settings;
+    settings.enabled = true;
+    settings.seed = 42;
+    settings.flashes_per_hour = 60;
+
+    uint32_t start = UINT32_MAX - 60000;
+    DomDomWeather weather;
+    weather.configure(settings, start);
+
+    volatile uint32_t sink = 0;
+    uint32_t ticks = hours * 360000;
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t t = 0; t < ticks; t++)
+    {
+        sink += weather.sample(start + t * 10).dim;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - begin).count() / ticks;
+}
+
+/**
+ * Sube @uploads veces una programacion de @size puntos como hace el servidor web:
+ * borra los puntos y la linea de tiempo y añade los nuevos. Devuelve en @before y
+ * @after las reservas por subida con el vector de punteros anterior y con la lista
+ * actual.
+ */
+static void measureUploads(int size, uint32_t uploads, double &before, double &after)
+{
+    static DomDomSchedulePointList points;
+    static DomDomScheduleTimeline timeline;
+    uint8_t values[CHANNEL_SIZE] = {};
+
+    // Como antes, con un vector de punteros que reserva y libera cada punto
+    std::vector<DomDomSchedulePoint *> pointers;
+    uint32_t start = allocations;
+    for (uint32_t u = 0; u < uploads; u++)
+    {
+        for (size_t i = 0; i < pointers.size(); i++)
+        {
+            delete pointers[i];
+        }
+
+        pointers.clear();
+        for (int i = 0; i < size; i++)
+        {
+            pointers.push_back(new DomDomSchedulePoint(ALL, i % 24, i % 60, values));
+        }
+    }
+    before = (allocations - start) / (double)uploads;
+
+    for (size_t i = 0; i < pointers.size(); i++)
+    {
+        delete pointers[i];
+    }
+
+    start = allocations;
+    for (uint32_t u = 0; u < uploads; u++)
+    {
+        points.clear();
+        timeline.clear();
+        for (int i = 0; i < size; i++)
+        {
+            values[0] = u + i;
+            points.add(DomDomSchedulePoint(ALL, i % 24, i % 60, values));
+            timeline.add((i % 24) * 60 + i % 60, ALL, points.size() - 1);
+        }
+    }
+    after = (allocations - start) / (double)uploads;
+}
+
+/**
+ * Publica @publications programaciones de @size puntos mientras @readers hilos las leen.
+ * Devuelve las lecturas hechas.
+ */
+static uint32_t measurePublish(int size, uint32_t publications, int readers)
+{
+    static DomDomDoubleBuffer<DomDomCompiledSchedule> buffer;
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> total(0);
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; r++)
+    {
+        threads.push_back(std::thread([&]()
+        {
+            uint32_t count = 0;
+            volatile uint32_t sink = 0;
+            while (!done.load())
+            {
+                DomDomScheduleReader schedule(buffer);
+                sink += schedule->points.size();
+
+                // Dejamos avanzar al escritor aunque haya un solo nucleo
+                if (++count % 64 == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            total += count;
+        }));
+    }
+
+    uint8_t values[CHANNEL_SIZE];
+    for (uint32_t p = 1; p <= publications; p++)
+    {
+        DomDomCompiledSchedule *schedule;
+        while ((schedule = buffer.back()) == nullptr)
+        {
+            std::this_thread::yield();
+        }
+
+        schedule->clear();
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            values[c] = p;
+        }
+        for (int i = 0; i < size; i++)
+        {
+            schedule->add(DomDomSchedulePoint(ALL, (i + p) % 24, i % 60, values));
+        }
+        schedule->compile();
+        buffer.publish();
+    }
+
+    done = true;
+    for (int r = 0; r < readers; r++)
+    {
+        threads[r].join();
+    }
+
+    return total;
+}
+
+int main(int argc, char **argv)
+{
+    int size = EEPROM_MAX_SCHEDULE_POINTS;
+    int repetitions = 20;
+
+    for (int i = 1; i < argc; i++)
+    {
+        String option = argv[i];
+        if (option == "-p" && i + 1 < argc)         size = atoi(argv[++i]);
+        else if (option == "-n" && i + 1 < argc)    repetitions = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Uso: %s [-p puntos] [-n repeticiones]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    size = size < 1 ? 1 : (size > EEPROM_MAX_SCHEDULE_POINTS ? EEPROM_MAX_SCHEDULE_POINTS : size);
+
+    // Puntos repetibles en cualquier orden, con algun minuto repetido
+    DomDomSchedulePointList points;
+    DomDomScheduleTimeline timeline;
+    uint32_t seed = 12345;
+    for (int i = 0; i < size; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        uint16_t minute = (seed >> 8) % (SCHEDULE_MINUTES_PER_DAY / 10) * 10;
+
+        points.add(DomDomSchedulePoint(ALL, minute / 60, minute % 60));
+        timeline.add(minute, ALL, i);
+    }
+
+    // Las dos busquedas en todos los minutos de un dia
+    DateTime day(2020, 3, 1, 0, 0, 30);
+    volatile int sink = 0;
+    DateTime dt;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; r++)
+    {
+        for (int m = 0; m < SCHEDULE_MINUTES_PER_DAY; m++)
+        {
+            DateTime now = day + TimeSpan(m * 60);
+            sink += linearSchedulePoint(points, now, dt, true);
+            sink += linearSchedulePoint(points, now, dt, false);
+        }
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; r++)
+    {
+        for (int m = 0; m < SCHEDULE_MINUTES_PER_DAY; m++)
+        {
+            DateTime now = day + TimeSpan(m * 60);
+            sink += timelineSchedulePoint(timeline, now, dt, true);
+            sink += timelineSchedulePoint(timeline, now, dt, false);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double lookups = 2.0 * repetitions * SCHEDULE_MINUTES_PER_DAY;
+    double linear_ns = std::chrono::duration<double, std::nano>(middle - start).count() / lookups;
+    double timeline_ns = std::chrono::duration<double, std::nano>(end - middle).count() / lookups;
+
+    printf("%d puntos, %.0f busquedas\n", size, lookups);
+    printf("lineal\t%8.1f ns/busqueda\n", linear_ns);
+    printf("binaria\t%8.1f ns/busqueda\t(x%.1f)\n", timeline_ns, linear_ns / timeline_ns);
+
+    double before, after;
+    measureUploads(EEPROM_MAX_SCHEDULE_POINTS, 1000, before, after);
+    printf("subida de la programacion\t%.1f reservas antes\t%.1f ahora\n", before, after);
+
+    uint32_t reads = measurePublish(EEPROM_MAX_SCHEDULE_POINTS, 5000, 3);
+    printf("publicacion de la programacion\t%u lecturas durante 5000 publicaciones\n", reads);
+
+    double weather_ns = measureWeather(24);
+    printf("nubes y rayos\t%8.1f ns/consulta\n", weather_ns);
+
+    return 0;
+}
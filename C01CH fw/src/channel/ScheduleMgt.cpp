@@ -21,123 +21,87 @@
 #include "ScheduleMgt.h"
 #include <EEPROM.h>
 #include "configuration.h"
-#include "channel.h"
+#include "channelMgt.h"
 #include "../log/logger.h"
 
 DomDomScheduleMgtClass::DomDomScheduleMgtClass(/* args */)
 {
+    _edit_mutex = xSemaphoreCreateMutex();
 }
 
 DomDomScheduleMgtClass::~DomDomScheduleMgtClass()
 {
 }
 
-int roundUp(int numToRound, int multiple)
-{
-    if (multiple == 0)
-        return numToRound;
-
-    int remainder = abs(numToRound) % multiple;
-    if (remainder == 0)
-        return numToRound;
 
-    if (numToRound < 0)
-        return -(abs(numToRound) - remainder);
-    else
-        return numToRound + multiple - remainder;
+bool DomDomScheduleMgtClass::getShedulePoint(DateTime &dt, DomDomSchedulePoint &point, bool previous)
+{
+    return getShedulePoint(DomDomRTC.now(), dt, point, previous);
 }
 
-bool DomDomScheduleMgtClass::getShedulePoint(DateTime &dt, DomDomSchedulePoint *&point, bool previous)
+bool DomDomScheduleMgtClass::getShedulePoint(const DateTime &now, DateTime &dt, DomDomSchedulePoint &point, bool previous)
 {
-    DateTime now = DomDomRTC.now();
-    now = now - TimeSpan(now.second());
-
-    DateTime ultimaHora;
-    int puntoAnterior = -1;
-
-    for(int i = 0; i < schedulePoints.size(); i++)
-    {
-        // Buscamos la hora mayor del dia anterior;
-        DateTime scheduleDT (now.year(), now.month(), now.day(), schedulePoints[i]->hour, schedulePoints[i]->minute, 0);
-        TimeSpan day (1,0,0,0);
-
-        // Si buscamos la fecha anterior y no es menor que la fecha actual, restamos un dia
-        if (previous && scheduleDT >= now)
-        {
-            scheduleDT = scheduleDT - day;
-        }
-
-        // Si buscamos la fecha siiguiente y es menor que la actual sumamos un dia
-        if (!previous && scheduleDT < now)
-        {
-            scheduleDT = scheduleDT + day;
-        }
-
-        // Si buscamos la fecha anterior
-        if (previous)
-        {
-            if (scheduleDT < now)
-            {
-                if (puntoAnterior == -1)
-                {
-                    ultimaHora = scheduleDT;
-                    puntoAnterior = i;
-                }
-                else if (scheduleDT > ultimaHora)
-                {
-                    ultimaHora = scheduleDT;
-                    puntoAnterior = i;
-                }
-            }
-        }
-
-        // Si buscamos la fecha siguiente
-        if (!previous)
-        {
-            if (scheduleDT >= now)
-            {
-                if (puntoAnterior == -1)
-                {
-                    ultimaHora = scheduleDT;
-                    puntoAnterior = i;
-                }
-                else if (scheduleDT < ultimaHora)
-                {
-                    ultimaHora = scheduleDT;
-                    puntoAnterior = i;
-                }
-            }
-        }
-        
-    }
-
-    if (puntoAnterior == -1)
+    DomDomScheduleReader schedule(_schedule);
+    const DomDomTimelineEntry *entry;
+    if (!schedule->find(now, dt, entry, previous))
     {
         return false;
     }
 
-    dt = ultimaHora;
-    point = schedulePoints[puntoAnterior];
+    // Copiamos el punto, la programacion puede cambiar en cuanto la soltamos
+    point = schedule->points[entry->point];
 
     return true;
 }
 
 bool DomDomScheduleMgtClass::save()
 {
-    int address = EEPROM_SCHEDULE_FIRST_ADDRESS ;
-    EEPROM.write(address++, (uint8_t)schedulePoints.size());
     DomDomLogger.log(DomDomLoggerClass::LogLevel::info,"SCHEDULE", "Guardando programacion...");
 
-    for (int i = 0; i < schedulePoints.size(); i++)
+    // Solo leemos la programacion publicada mientras copiamos sus puntos
+    int address = EEPROM_SCHEDULE_FIRST_ADDRESS ;
     {
-        EEPROM.write(address++, schedulePoints[i]->dayOfWeek);
-        EEPROM.write(address++, schedulePoints[i]->hour);
-        EEPROM.write(address++, schedulePoints[i]->minute);
-        EEPROM.write(address++, schedulePoints[i]->fade);
-        EEPROM.write(address++, schedulePoints[i]->value);
-    };
+        DomDomScheduleReader schedule(_schedule);
+        const DomDomSchedulePointList &schedulePoints = schedule->points;
+
+        EEPROM.write(address++, (uint8_t)schedulePoints.size());
+        for (int i = 0; i < schedulePoints.size(); i++)
+        {
+            EEPROM.write(address++, schedulePoints[i].dayOfWeek);
+            EEPROM.write(address++, schedulePoints[i].hour);
+            EEPROM.write(address++, schedulePoints[i].minute);
+            // Sin fundido se guarda 0 y con fundido 1 + la forma, 1 sigue siendo lineal
+            EEPROM.write(address++, schedulePoints[i].fade ? 1 + schedulePoints[i].curve : 0);
+            for (int c = 0; c < CHANNEL_SIZE; c++)
+            {
+                EEPROM.write(address++, schedulePoints[i].value[c]);
+            }
+        };
+    }
     
-    EEPROM.writeBool(EEPROM_SCHEDULE_STATUS_ADDRESS, _started);
+    EEPROM.writeBool(EEPROM_SCHEDULE_STATUS_ADDRESS, isStarted());
+
+    DomDomSolarSettings sol = solar();
+    address = EEPROM_SCHEDULE_SOLAR_ADDRESS;
+    EEPROM.writeBool(address, sol.enabled);
+    address += 1;
+    EEPROM.writeFloat(address, sol.latitude);
+    address += 4;
+    EEPROM.writeFloat(address, sol.longitude);
+    address += 4;
+    for (int c = 0; c < CHANNEL_SIZE; c++)
+    {
+        EEPROM.write(address++, sol.value[c]);
+    }
+
+    DomDomMoonSettings luna = moon();
+    address = EEPROM_SCHEDULE_MOON_ADDRESS;
+    EEPROM.writeBool(address, luna.enabled);
+    address += 1;
+    for (int c = 0; c < CHANNEL_SIZE; c++)
+    {
+        EEPROM.write(address++, luna.value[c]);
+    }
 
     bool result = EEPROM.commit();
 
@@ -155,7 +119,7 @@ bool DomDomScheduleMgtClass::save()
 
 bool DomDomScheduleMgtClass::load()
 {
-    schedulePoints.clear();
+    beginEdit();
 
     DomDomLogger.log(DomDomLoggerClass::LogLevel::info,"SCHEDULE", "Cargando programacion...");
 
@@ -171,66 +135,145 @@ bool DomDomScheduleMgtClass::load()
             DomDomDayOfWeek day = (DomDomDayOfWeek)EEPROM.read(address++);
             uint8_t hour = EEPROM.read(address++);
             uint8_t minute = EEPROM.read(address++);
-            bool fade = EEPROM.read(address++);
-            uint8_t value = EEPROM.read(address++);
+            uint8_t fade = EEPROM.read(address++);
+            uint8_t values[CHANNEL_SIZE];
+            for (int c = 0; c < CHANNEL_SIZE; c++)
+            {
+                values[c] = EEPROM.read(address++);
+            }
 
-            addSchedulePoint(day, hour, minute, value, fade);
+            addSchedulePoint(day, hour, minute, values, fade != 0, fade > 0 ? fade - 1 : FADE_CURVE_LINEAR);
             
         };
 
     }
+    publish();
+
+    // Si la programacion solar no se ha guardado nunca nos quedamos con los valores por defecto
+    DomDomSolarSettings settings;
+    address = EEPROM_SCHEDULE_SOLAR_ADDRESS;
+    uint8_t enabled = EEPROM.read(address);
+    address += 1;
+    float latitude = EEPROM.readFloat(address);
+    address += 4;
+    float longitude = EEPROM.readFloat(address);
+    address += 4;
+    if (enabled <= 1 && fabsf(latitude) <= 90 && fabsf(longitude) <= 180)
+    {
+        settings.enabled = enabled;
+        settings.latitude = latitude;
+        settings.longitude = longitude;
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            uint8_t value = EEPROM.read(address++);
+            settings.value[c] = value <= 100 ? value : 100;
+        }
+    }
+    setSolar(settings);
+
+    DomDomMoonSettings luna;
+    address = EEPROM_SCHEDULE_MOON_ADDRESS;
+    enabled = EEPROM.read(address++);
+    if (enabled <= 1)
+    {
+        luna.enabled = enabled;
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            uint8_t value = EEPROM.read(address++);
+            luna.value[c] = value <= SCHEDULE_MOON_MAX_PERCENT ? value : SCHEDULE_MOON_MAX_PERCENT;
+        }
+    }
+    setMoon(luna);
 
     DomDomLogger.log(DomDomLoggerClass::LogLevel::info,"SCHEDULE", "Cargando programacion...OK!");
     return true;
 }
 
-void DomDomScheduleMgtClass::addSchedulePoint(DomDomDayOfWeek day, uint8_t hour, uint8_t minute, bool fade)
+void DomDomScheduleMgtClass::clear()
+{
+    beginEdit();
+    publish();
+}
+
+void DomDomScheduleMgtClass::beginEdit()
+{
+    xSemaphoreTake(_edit_mutex, portMAX_DELAY);
+
+    // La copia sin publicar puede tener todavia lectores de antes de la ultima publicacion
+    while ((_editing = _schedule.back()) == nullptr)
+    {
+        delay(1);
+    }
+
+    _editing->clear();
+}
+
+void DomDomScheduleMgtClass::publish()
 {
-    if (schedulePoints.size() >= EEPROM_MAX_SCHEDULE_POINTS)
+    if (_editing == nullptr)
     {
-        DomDomLogger.log(DomDomLoggerClass::LogLevel::warn,"SCHEDULE", "Numero maximo de programaciones alcanzado. Se omitira esta inserccion");
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::warn,"SCHEDULE", "No hay ninguna programacion en preparacion");
         return;
     }
 
-    schedulePoints.push_back(new DomDomSchedulePoint(day, hour, minute, fade));
+    // Los lectores pasan a la nueva programacion de golpe, ya con las curvas calculadas
+    _editing->compile();
+    _editing = nullptr;
+    _schedule.publish();
+    xSemaphoreGive(_edit_mutex);
+
+    wake();
+}
+
+void DomDomScheduleMgtClass::addSchedulePoint(DomDomDayOfWeek day, uint8_t hour, uint8_t minute, bool fade)
+{
+    uint8_t values[CHANNEL_SIZE] = {};
+    addSchedulePoint(day, hour, minute, values, fade);
 }
 
-void DomDomScheduleMgtClass::addSchedulePoint(DomDomDayOfWeek day, uint8_t hour, uint8_t minute, uint8_t value, bool fade)
+void DomDomScheduleMgtClass::addSchedulePoint(DomDomDayOfWeek day, uint8_t hour, uint8_t minute, const uint8_t *values, bool fade, uint8_t curve)
 {
-    if (schedulePoints.size() >= EEPROM_MAX_SCHEDULE_POINTS)
+    if (_editing == nullptr)
+    {
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::warn,"SCHEDULE", "No hay ninguna programacion en preparacion. Se omitira esta inserccion");
+        return;
+    }
+
+    if (_editing->points.full())
     {
         DomDomLogger.log(DomDomLoggerClass::LogLevel::warn,"SCHEDULE", "Numero maximo de programaciones alcanzado. Se omitira esta inserccion");
         return;
     }
 
-    schedulePoints.push_back(new DomDomSchedulePoint(day, hour, minute, value, fade));
+    if (hour > 23 || minute > 59)
+    {
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::warn,"SCHEDULE", "Hora %d:%d no valida. Se omitira esta inserccion", hour, minute);
+        return;
+    }
+
+    _editing->add(DomDomSchedulePoint(day, hour, minute, values, fade, curve));
 }
 
 
 bool DomDomScheduleMgtClass::begin()
 {
     DomDomLogger.log(DomDomLoggerClass::LogLevel::info,"SCHEDULE", "Iniciando programación...");
-    if (!_started)
+    if (!isStarted())
     {
 
-        if (schedulePoints.size() > 0)
+        if (DomDomScheduleReader(_schedule)->points.size() > 0 || solar().enabled || moon().enabled)
         {
-            _started = true;
-
-            xTaskCreate(
-                this->scheduleTask,            /* Task function. */
-                "ScheduleInitTask",     /* String with name of task. */
-                10000,                  /* Stack size in bytes. */
-                NULL,                   /* Parameter passed as input of the task */
-                1,                      /* Priority of the task. */
-                taskHandle              /* Task handle. */
-            );
+            DomDomRTC.onAdjust(timeAdjusted, this);
+            _task.start(scheduleTask, "ScheduleInitTask", 10000, this);
         }
         else
         {
             // Si no hay puntos de programación ponemos el valor al 100%
             DomDomLogger.log(DomDomLoggerClass::LogLevel::debug,"SCHEDULE", "No hay puntos de programacion. Cambiado a modo manual.");
-            DomDomChannel.setTargetmA(DomDomChannel.maximum_mA);
+            for (int c = 0; c < CHANNEL_SIZE; c++)
+            {
+                DomDomChannelMgt.channels[c]->setTargetPercent(100);
+            }
         }
         
         DomDomLogger.log(DomDomLoggerClass::LogLevel::info,"SCHEDULE", "Iniciando programación...OK!");
@@ -241,153 +284,357 @@ bool DomDomScheduleMgtClass::begin()
 
 bool DomDomScheduleMgtClass::end()
 {
-    if (_started)
+    if (!_task.stop())
     {
-        _started = false;
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::error,"SCHEDULE", "La tarea del programador no ha terminado");
+        return false;
     }
 
     return true;
 }
 
-void DomDomScheduleMgtClass::update()
+uint32_t DomDomScheduleMgtClass::update()
 {
     DateTime now = DomDomRTC.now();
-    DomDomLogger.log(DomDomLoggerClass::LogLevel::debug,"SCHEDULE", "%d:%d Comprobando programacion", now.hour(), now.minute());
+    DomDomLogger.log(DomDomLoggerClass::LogLevel::debug,"SCHEDULE", "%d:%d:%d Comprobando programacion", now.hour(), now.minute(), now.second());
+
+    // La configuracion del sol y de la luna solo se toca desde esta tarea. Al cambiar
+    // la situacion hay que recalcular las tablas del sol y de la luna
+    portENTER_CRITICAL(&_settings_mux);
+    bool solar_pending = _solar_pending;
+    DomDomSolarSettings solar_settings = _solar_settings;
+    _solar_pending = false;
+    bool moon_pending = _moon_pending;
+    DomDomMoonSettings moon_settings = _moon_settings;
+    _moon_pending = false;
+    portEXIT_CRITICAL(&_settings_mux);
+
+    if (solar_pending)
+    {
+        _solar_active = solar_settings;
+        _solar.clear();
+        _moon.clear();
+    }
+
+    if (moon_pending)
+    {
+        _moon_active = moon_settings;
+        _moon.clear();
+    }
+
+    const DomDomSolarSettings &solar = _solar_active;
+    const DomDomMoonSettings &moon = _moon_active;
+
+    // Las tablas del sol y de la luna se calculan una vez al dia, despues solo se leen
+    DateTime today(now.year(), now.month(), now.day(), 0, 0, 0);
+    if ((solar.enabled && !_solar.isFor(today.unixtime())) || (moon.enabled && !_moon.isFor(today.unixtime())))
+    {
+        int32_t offset = DomDomRTC.utcOffset(now);
+        if (solar.enabled && !_solar.isFor(today.unixtime()))
+        {
+            _solar.compile(today.unixtime(), solar.latitude, solar.longitude, offset);
+            DomDomLogger.log(DomDomLoggerClass::LogLevel::info,"SCHEDULE", "Programacion solar: orto %d min, ocaso %d min", _solar.sunrise(), _solar.sunset());
+
+            portENTER_CRITICAL(&_settings_mux);
+            _sunrise = _solar.sunrise();
+            _sunset = _solar.sunset();
+            portEXIT_CRITICAL(&_settings_mux);
+        }
+
+        if (moon.enabled && !_moon.isFor(today.unixtime()))
+        {
+            _moon.compile(today.unixtime(), solar.latitude, solar.longitude, offset);
+            DomDomLogger.log(DomDomLoggerClass::LogLevel::info,"SCHEDULE", "Luz de luna: orto %d min, ocaso %d min", _moon.moonrise(), _moon.moonset());
+
+            portENTER_CRITICAL(&_settings_mux);
+            _moonrise = _moon.moonrise();
+            _moonset = _moon.moonset();
+            portEXIT_CRITICAL(&_settings_mux);
+        }
+    }
+
+    // La luz de luna tambien marca cuando hay que volver a despertar
+    DateTime proximo = now + TimeSpan(SCHEDULE_MAX_SLEEP / 1000);
+    if (moon.enabled)
+    {
+        DateTime luna = today + TimeSpan(_moon.nextStep((now - today).totalseconds()));
+        proximo = luna < proximo ? luna : proximo;
+    }
+
+    uint32_t porcentaje[CHANNEL_SIZE];
+    bool fundido[CHANNEL_SIZE];
+    bool correct = solar.enabled ? planSolar(now, proximo, porcentaje, fundido) : planPoints(now, proximo, porcentaje, fundido);
+    if (!correct && !moon.enabled)
+    {
+        return SCHEDULE_MAX_SLEEP;
+    }
+
+    // Sin programacion la luz de luna parte de cero
+    for (int c = 0; c < CHANNEL_SIZE && !correct; c++)
+    {
+        porcentaje[c] = 0;
+        fundido[c] = false;
+    }
+
+    // Por la noche la luz de luna sustituye a la programacion cuando es mayor
+    if (moon.enabled)
+    {
+        uint16_t intensidad = _moon.intensityAt((proximo - today).totalseconds());
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            uint32_t luna = DomDomIntensityTable::percent(intensidad, moon.value[c]);
+            if (luna > porcentaje[c])
+            {
+                porcentaje[c] = luna;
+                fundido[c] = true;
+            }
+        }
+    }
+
+    int32_t duracion_ms = (proximo - now).totalseconds() * 1000;
+    duracion_ms = duracion_ms < 1000 ? 1000 : duracion_ms;
+
+    // La rampa de cada canal llega al valor del proximo cambio y la tarea
+    // de control interpola entre medias
+    for (int c = 0; c < CHANNEL_SIZE; c++)
+    {
+        DomDomChannelClass *channel = DomDomChannelMgt.channels[c];
+
+        // Las fracciones de porcentaje llegan hasta la corriente
+        float mA = channel->fixedPercentTomA(porcentaje[c]);
 
+        if (mA != channel->target_mA)
+        {
+            channel->setTargetmA(mA, fundido[c] ? duracion_ms : 0);
+        }
+    }
+
+    return duracion_ms < SCHEDULE_MAX_SLEEP ? duracion_ms : SCHEDULE_MAX_SLEEP;
+}
+
+bool DomDomScheduleMgtClass::planPoints(DateTime now, DateTime &proximo, uint32_t *porcentaje, bool *fundido)
+{
     DateTime horaAnterior;
     DateTime horaSiguiente;
-    DomDomSchedulePoint *puntoAnterior = nullptr;
-    DomDomSchedulePoint *puntoSiguiente = nullptr;
+    const DomDomTimelineEntry *entradaAnterior = nullptr;
+    const DomDomTimelineEntry *entradaSiguiente = nullptr;
+
+    // La misma programacion durante todo el calculo aunque se publique otra
+    DomDomScheduleReader schedule(_schedule);
 
     bool correct;
-    correct = getShedulePoint(horaAnterior, puntoAnterior, true);
+    correct = schedule->find(now, horaAnterior, entradaAnterior, true);
     if (!correct)
     {
         DomDomLogger.log(DomDomLoggerClass::LogLevel::error,"SCHEDULE", "No se encontra una programacion previa.");
-        return;
+        return false;
     }
 
-    correct = getShedulePoint(horaSiguiente, puntoSiguiente, false);
+    correct = schedule->find(now, horaSiguiente, entradaSiguiente, false);
     if (!correct)
     {
         DomDomLogger.log(DomDomLoggerClass::LogLevel::error,"SCHEDULE", "No se encontra la programacion siguiente.");
-        return;
+        return false;
     }
 
-    DomDomLogger.log(DomDomLoggerClass::LogLevel::debug,"SCHEDULE", "intervalo obtenido: %d:%d - %d:%d", puntoAnterior->hour, puntoAnterior->minute, puntoSiguiente->hour, puntoSiguiente->minute);
+    const DomDomSchedulePoint *puntoAnterior = &schedule->points[entradaAnterior->point];
+    const DomDomSchedulePoint *puntoSiguiente = &schedule->points[entradaSiguiente->point];
 
-    int mA = 0;
-    int porcentaje = 0;
+    DomDomLogger.log(DomDomLoggerClass::LogLevel::debug,"SCHEDULE", "intervalo obtenido: %d:%d - %d:%d", puntoAnterior->hour, puntoAnterior->minute, puntoSiguiente->hour, puntoSiguiente->minute);
 
-    if (!puntoSiguiente->fade || puntoAnterior->value == puntoSiguiente->value)
+    // Tramo de cada canal con la forma del punto siguiente
+    DomDomFadeSegment tramos[CHANNEL_SIZE];
+    int32_t total = (horaSiguiente - horaAnterior).totalseconds();
+    int32_t elapsed = (now - horaAnterior).totalseconds();
+    for (int c = 0; c < CHANNEL_SIZE; c++)
     {
-        porcentaje = puntoSiguiente->value;
+        tramos[c].from = puntoAnterior->value[c];
+        tramos[c].to = puntoSiguiente->value[c];
+        tramos[c].curve = puntoSiguiente->curve;
+        tramos[c].total = total > 0 ? total : 0;
+        tramos[c].slope_from = entradaAnterior->slope[c];
+        tramos[c].slope_to = entradaSiguiente->slope[c];
     }
-    else
+
+    // Sin fundido la salida no cambia hasta el punto siguiente. Con fundido cambia
+    // cada vez que algun canal avanza SCHEDULE_FADE_STEP
+    proximo = horaSiguiente < proximo ? horaSiguiente : proximo;
+
+    if (puntoSiguiente->fade && total > 0)
     {
-        porcentaje = calcFadeValue(puntoAnterior->value, 
-                                puntoSiguiente->value,
-                                DomDomChannel.minimum_mA,
-                                DomDomChannel.maximum_mA,
-                                horaAnterior,
-                                horaSiguiente);
-        porcentaje = roundUp(porcentaje, CHANNEL_PERCENTAGE_MIN_STEP);
-    }
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            // Primer segundo en el que se alcanza el siguiente escalon
+            uint32_t seconds = tramos[c].nextStep(elapsed, SCHEDULE_FADE_STEP * FADE_PERCENT_ONE);
 
-    mA = DomDomChannel.minimum_mA + ((DomDomChannel.maximum_mA - DomDomChannel.minimum_mA) * (double)(porcentaje/100.0f));
+            DateTime paso = horaAnterior + TimeSpan(seconds);
+            proximo = paso < proximo ? paso : proximo;
+        }
+    }
 
-    if (mA != DomDomChannel.target_mA)
+    int32_t hasta = (proximo - horaAnterior).totalseconds();
+    for (int c = 0; c < CHANNEL_SIZE; c++)
     {
-        DomDomChannel.setTargetmA(mA);
+        fundido[c] = false;
+
+        if (!puntoSiguiente->fade)
+        {
+            porcentaje[c] = puntoAnterior->value[c] * FADE_PERCENT_ONE;
+        }
+        else if (puntoAnterior->value[c] == puntoSiguiente->value[c])
+        {
+            porcentaje[c] = puntoSiguiente->value[c] * FADE_PERCENT_ONE;
+        }
+        else
+        {
+            // Si la hora es la misma el tramo no tiene duracion y vale el valor final
+            if (total <= 0)
+            {
+                DomDomLogger.log(DomDomLoggerClass::LogLevel::warn,"SCHEDULE", "Misma hora de inicio y de final. ¿Error en programacion?");
+            }
+
+            porcentaje[c] = tramos[c].value(hasta < 0 ? 0 : hasta);
+            fundido[c] = true;
+        }
     }
+
+    return true;
 }
 
-void DomDomScheduleMgtClass::scheduleTask(void *parameter)
+bool DomDomScheduleMgtClass::planSolar(DateTime now, DateTime &proximo, uint32_t *porcentaje, bool *fundido)
 {
-    int offset = 5;
-    while(DomDomScheduleMgt.isStarted())
+    // Entre dos minutos la rampa interpola la tabla. Mientras la intensidad no
+    // cambia dormimos hasta el minuto anterior al siguiente cambio
+    DateTime today(now.year(), now.month(), now.day(), 0, 0, 0);
+    DateTime siguiente = today + TimeSpan(_solar.nextStep((now - today).totalseconds()));
+    proximo = siguiente < proximo ? siguiente : proximo;
+
+    uint16_t intensidad = _solar.intensityAt((proximo - today).totalseconds());
+    for (int c = 0; c < CHANNEL_SIZE; c++)
     {
-        DomDomScheduleMgt.update();
-        const int next_ms = (60 - DomDomRTC.now().second() + offset) * 1000;
-        vTaskDelay(next_ms / portTICK_PERIOD_MS);
+        porcentaje[c] = DomDomIntensityTable::percent(intensidad, _solar_active.value[c]);
+        fundido[c] = true;
     }
 
-    vTaskDelete(NULL);
+    return true;
 }
 
-int DomDomScheduleMgtClass::calcFadeValue(int prevValue, int nextValue, int min_value, int max_value, DateTime anterior, DateTime siguiente)
+void DomDomScheduleMgtClass::setSolar(const DomDomSolarSettings &settings)
 {
-    int porcentaje_result = 0;
-    int minutes_total = (siguiente - anterior).totalseconds() / 60;
+    portENTER_CRITICAL(&_settings_mux);
+    _solar_settings = settings;
+    _solar_pending = true;
+    portEXIT_CRITICAL(&_settings_mux);
 
-    // Si la hora es la misma ajustamos directamente el valor.
-    if (minutes_total == 0)
-    {
-        DomDomLogger.log(DomDomLoggerClass::LogLevel::warn,"SCHEDULE", "Misma hora de inicio y de final. ¿Error en programacion?");
-        
-        porcentaje_result = nextValue;
-    }
-    else
-    {
-        DateTime now = DomDomRTC.now();
-        DateTime now_noseconds (now.year(),now.month(),now.day(),now.hour(), now.minute(), 0);
+    wake();
+}
 
-        int minutes = (now_noseconds - anterior).totalseconds() / 60;
-        double minutes_porcentaje = (minutes * 100) / minutes_total / double(100);
+DomDomSolarSettings DomDomScheduleMgtClass::solar()
+{
+    portENTER_CRITICAL(&_settings_mux);
+    DomDomSolarSettings settings = _solar_settings;
+    portEXIT_CRITICAL(&_settings_mux);
 
-        int porcentaje_valor = (nextValue - prevValue) * minutes_porcentaje;
+    return settings;
+}
 
-        porcentaje_result = prevValue + porcentaje_valor;
-        //int new_pwm = min_value + (max_value - min_value) * ((prevValue + porcentaje_valor) / double(100));
-    }   
+void DomDomScheduleMgtClass::sunTimes(int16_t &sunrise, int16_t &sunset)
+{
+    portENTER_CRITICAL(&_settings_mux);
+    sunrise = _sunrise;
+    sunset = _sunset;
+    portEXIT_CRITICAL(&_settings_mux);
+}
 
-    return porcentaje_result;
+void DomDomScheduleMgtClass::setMoon(const DomDomMoonSettings &settings)
+{
+    portENTER_CRITICAL(&_settings_mux);
+    _moon_settings = settings;
+    _moon_pending = true;
+    portEXIT_CRITICAL(&_settings_mux);
+
+    wake();
+}
+
+DomDomMoonSettings DomDomScheduleMgtClass::moon()
+{
+    portENTER_CRITICAL(&_settings_mux);
+    DomDomMoonSettings settings = _moon_settings;
+    portEXIT_CRITICAL(&_settings_mux);
+
+    return settings;
+}
+
+void DomDomScheduleMgtClass::moonTimes(int16_t &moonrise, int16_t &moonset)
+{
+    portENTER_CRITICAL(&_settings_mux);
+    moonrise = _moonrise;
+    moonset = _moonset;
+    portEXIT_CRITICAL(&_settings_mux);
 }
 
-void DomDomScheduleMgtClass::startTest(uint16_t value)
+void DomDomScheduleMgtClass::scheduleTask(void *parameter)
 {
-    if (_testInProgress)
+    DomDomScheduleMgtClass *schedule = (DomDomScheduleMgtClass *)parameter;
+
+    // Dormimos hasta el siguiente cambio de la salida o hasta que nos despierten
+    while(schedule->_task.running())
     {
-        _testInProgress = false;
-        delay(500);
+        uint32_t next_ms = schedule->update();
+        schedule->_task.sleep(next_ms);
     }
 
+    schedule->_task.finish();
+}
+
+void DomDomScheduleMgtClass::timeAdjusted(void *parameter)
+{
+    DomDomScheduleMgtClass *schedule = (DomDomScheduleMgtClass *)parameter;
+    schedule->wake();
+}
+
+void DomDomScheduleMgtClass::startTest(const float *values)
+{
+    // Un test anterior termina sin volver a iniciar el programador
+    _testTask.stop();
+
     _testInProgress = true;
     end();
 
-    DomDomChannel.setTargetmA(value);
-
-    xTaskCreate(
-        this->testTask,     /* Task function. */
-        "testTask",         /* String with name of task. */
-        10000,              /* Stack size in bytes. */
-        NULL,               /* Parameter passed as input of the task */
-        1,                  /* Priority of the task. */
-        NULL                /* Task handle. */
-    );
+    for (int c = 0; c < CHANNEL_SIZE; c++)
+    {
+        DomDomChannelMgt.channels[c]->setTargetmA(values[c]);
+    }
 
+    _testTask.start(testTask, "testTask", 10000, this);
 }
 
 void DomDomScheduleMgtClass::testTask(void *parameter)
 {
-    for(int i = 0; i < 300; i++)
+    DomDomScheduleMgtClass *schedule = (DomDomScheduleMgtClass *)parameter;
+
+    for(int i = 0; i < 300 && schedule->testInProgress(); i++)
     {
-        if (!DomDomScheduleMgt.testInProgress())
+        if (!schedule->_testTask.sleep(100))
         {
             break;
         }
-        vTaskDelay(100 / portTICK_PERIOD_MS);
     }
 
-    DomDomScheduleMgt.stopTest();
-    DomDomScheduleMgt.begin();
+    // Si el test no se ha sustituido por otro volvemos a la programacion
+    if (schedule->_testTask.running())
+    {
+        schedule->stopTest();
+        schedule->begin();
+    }
 
-    vTaskDelete(NULL);
+    schedule->_testTask.finish();
 }
 
 void DomDomScheduleMgtClass::stopTest()
 {
     _testInProgress = false;
+    _testTask.wake();
 }
 
 #if !defined(NO_GLOBAL_INSTANCES)
@@ -24,7 +24,13 @@
 
 #include <Arduino.h>
 #include "schedulePoint.h"
+#include "scheduleTimeline.h"
+#include "compiledSchedule.h"
+#include "scheduleFade.h"
+#include "solarTable.h"
+#include "moonTable.h"
 #include "../rtc/rtc.h"
+#include "../task/managedTask.h"
 
 /**
  * Clase encargada de la programacion.
@@ -41,25 +47,83 @@ class DomDomScheduleMgtClass
          */
         bool _testInProgress = false;
         /**
-         * Indica si el proceso está activado.
+         * Tarea del programador. Mientras esta en marcha el proceso está activado.
          */
-        bool _started = false;
+        DomDomManagedTask _task;
         /**
-         * Puntero a la tarea del programador.
+         * Tarea que da por terminado el test.
          */
-        TaskHandle_t *taskHandle;
+        DomDomManagedTask _testTask;
         /**
-         * Tarea del programador.
+         * Programacion publicada y la copia sobre la que se prepara la siguiente
+         */
+        DomDomDoubleBuffer<DomDomCompiledSchedule> _schedule;
+        /**
+         * Copia en preparacion entre beginEdit() y publish(), nullptr fuera de ellas
+         */
+        DomDomCompiledSchedule *_editing = nullptr;
+        /**
+         * Deja preparar la programacion a una sola tarea a la vez
+         */
+        SemaphoreHandle_t _edit_mutex;
+        /**
+         * Intensidad solar de cada minuto del dia en curso para la programacion solar.
+         */
+        DomDomSolarTable _solar;
+        /**
+         * Intensidad de la luz de luna de cada minuto del dia en curso.
+         */
+        DomDomMoonTable _moon;
+        /**
+         * Configuracion de la programacion solar que usa la tarea del programador
+         */
+        DomDomSolarSettings _solar_active;
+        /**
+         * Ultima configuracion solar recibida y si la tarea aun no la ha aplicado
+         */
+        DomDomSolarSettings _solar_settings;
+        bool _solar_pending = false;
+        /**
+         * Configuracion de la luz de luna que usa la tarea del programador
+         */
+        DomDomMoonSettings _moon_active;
+        /**
+         * Ultima configuracion de la luz de luna recibida y si la tarea aun no la ha aplicado
+         */
+        DomDomMoonSettings _moon_settings;
+        bool _moon_pending = false;
+        /**
+         * Orto y ocaso del sol y de la luna del dia en curso calculados por la tarea del programador
+         */
+        int16_t _sunrise = -1, _sunset = -1;
+        int16_t _moonrise = -1, _moonset = -1;
+        /**
+         * Protege la configuracion pendiente y los resultados entre la tarea del programador y el resto
+         */
+        portMUX_TYPE _settings_mux = portMUX_INITIALIZER_UNLOCKED;
+        /**
+         * Tarea del programador. Recibe el objeto como parametro.
          */
         static void scheduleTask(void * parameter);
         /**
-         * Tarea del programador.
+         * Tarea del test. Recibe el objeto como parametro.
          */
         static void testTask(void * parameter);
         /**
-         * Devuelve el valor proporcional entre @prevValue y @nextValue en base a @anterior y @siguiente.
+         * Aviso del RTC al ajustar la hora. Recibe el objeto como parametro.
+         */
+        static void timeAdjusted(void * parameter);
+        /**
+         * Calcula con los puntos de programacion el instante @proximo del siguiente cambio de
+         * la salida, sin pasar de su valor de entrada, y en @porcentaje el valor (Q16) de cada
+         * canal en ese instante. @fundido indica si se llega con una rampa o de golpe.
+         * Devuelve falso si no hay programacion.
          */
-        int calcFadeValue(int prevValue, int nextValue, int min_value, int max_value, DateTime anterior, DateTime siguiente);
+        bool planPoints(DateTime now, DateTime &proximo, uint32_t *porcentaje, bool *fundido);
+        /**
+         * Igual que planPoints() pero siguiendo al sol con la configuracion de @_solar_active.
+         */
+        bool planSolar(DateTime now, DateTime &proximo, uint32_t *porcentaje, bool *fundido);
 
     public:
         /**
@@ -75,9 +139,49 @@ class DomDomScheduleMgtClass
          */
         bool testInProgress() const { return _testInProgress; };
         /**
-         * Puntos de programacion cargados.
+         * Programacion publicada. Se lee con un DomDomScheduleReader, que nunca espera y
+         * mantiene la misma programacion mientras existe, y solo cambia con publish().
+         */
+        const DomDomDoubleBuffer<DomDomCompiledSchedule> &schedule() const { return _schedule; };
+        /**
+         * Deja pendiente la configuracion de la programacion solar. La tarea del programador
+         * la aplica y recalcula la tabla del dia.
+         */
+        void setSolar(const DomDomSolarSettings &settings);
+        /**
+         * Copia de la ultima configuracion de la programacion solar
+         */
+        DomDomSolarSettings solar();
+        /**
+         * Orto y ocaso del dia en curso en minutos, -1 si hoy no sale o no se pone el sol
+         */
+        void sunTimes(int16_t &sunrise, int16_t &sunset);
+        /**
+         * Deja pendiente la configuracion de la luz de luna, que usa la situacion de solar().
+         * La tarea del programador la aplica y recalcula la tabla del dia.
+         */
+        void setMoon(const DomDomMoonSettings &settings);
+        /**
+         * Copia de la ultima configuracion de la luz de luna
          */
-        std::vector<DomDomSchedulePoint *> schedulePoints;
+        DomDomMoonSettings moon();
+        /**
+         * Orto y ocaso de la luna del dia en curso en minutos, -1 si hoy no sale o no se pone
+         */
+        void moonTimes(int16_t &moonrise, int16_t &moonset);
+        /**
+         * Borra todos los puntos de programacion.
+         */
+        void clear();
+        /**
+         * Empieza a preparar una programacion vacia sin tocar la publicada. Espera a
+         * que termine otra preparacion y a que nadie lea la copia que se va a usar.
+         */
+        void beginEdit();
+        /**
+         * Publica la programacion preparada desde beginEdit() y despierta al programador.
+         */
+        void publish();
         /**
          * Guarda los puntos de programacion cargados en la memoria y el estado
          */
@@ -92,37 +196,49 @@ class DomDomScheduleMgtClass
          * */
         bool begin();
         /**
-         * Comprueba la programacion.
+         * Comprueba la programacion y mueve los canales hacia su valor en el
+         * siguiente cambio de la salida. Devuelve los ms hasta ese cambio.
+         */
+        uint32_t update();
+        /**
+         * Despierta al programador para que vuelva a comprobar la programacion
+         * tras un cambio de los puntos, de la hora o de los canales.
          */
-        void update();
+        void wake() { _task.wake(); };
         /**
-         * Para el programador.
+         * Para el programador y espera a que termine su tarea.
          */
         bool end();
         /**
          * Indica si el programador esta en marcha o no.
          */
-        bool isStarted() const { return _started; };
+        bool isStarted() const { return _task.running(); };
         /**
-         * Añade un nuevo punto de programacion con los valores pasados por parametro.
+         * Añade un nuevo punto de programacion a la programacion en preparacion.
          */
         void addSchedulePoint(DomDomDayOfWeek day, uint8_t hour, uint8_t minute, bool fade);
         /**
-         * Añade un nuevo punto de programacion con los valores pasados por parametro.
+         * Añade un nuevo punto de programacion a la programacion en preparacion.
          */
-        void addSchedulePoint(DomDomDayOfWeek day, uint8_t hour, uint8_t minute, uint8_t value, bool fade);
+        void addSchedulePoint(DomDomDayOfWeek day, uint8_t hour, uint8_t minute, const uint8_t *values, bool fade, uint8_t curve = FADE_CURVE_LINEAR);
         /**
          * Devuelve un punto de programacion.
          * 
-         * Si @previous es verdadero rellena @point con el punto anterior mas cercano al parametro @dt,
-         * Si @previous es falso rellena @point con el punto siguiente mas cercano al parametro @dt
+         * Si @previous es verdadero copia en @point el punto anterior mas cercano al parametro @dt,
+         * Si @previous es falso copia en @point el punto siguiente mas cercano al parametro @dt
+         * Solo se tienen en cuenta los puntos de cada dia de la semana, por lo que el punto puede
+         * ser de otro dia si hoy no hay ninguno antes o despues.
          * Devuelve un booleano indicando si se ha encontrado un punto de programacion o no.
          */
-        bool getShedulePoint(DateTime &dt, DomDomSchedulePoint *&point, bool previous);
+        bool getShedulePoint(DateTime &dt, DomDomSchedulePoint &point, bool previous);
+        /**
+         * Igual que getShedulePoint(dt, point, previous) pero respecto al instante @now.
+         */
+        bool getShedulePoint(const DateTime &now, DateTime &dt, DomDomSchedulePoint &point, bool previous);
         /**
-         * Realiza un test con los valores pasados por parametros
+         * Realiza un test con los valores (mA) de cada canal pasados por parametros
          */
-        void startTest(uint16_t pwm);
+        void startTest(const float *values);
         /**
          * Para el test
          */
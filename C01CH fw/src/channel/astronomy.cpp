@@ -0,0 +1,121 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "astronomy.h"
+#include <math.h>
+
+static const double DEG = 3.14159265358979324 / 180;
+
+/**
+ * Angulo @degrees llevado a (-180, 180]
+ */
+static double wrap180(double degrees)
+{
+    degrees = fmod(degrees, 360);
+    degrees = degrees > 180 ? degrees - 360 : degrees;
+    return degrees <= -180 ? degrees + 360 : degrees;
+}
+
+double DomDomAstronomy::daysSinceJ2000(uint32_t utc)
+{
+    return utc / 86400.0 - 10957.5;
+}
+
+/**
+ * Devuelve en @longitude la longitud ecliptica del sol, en @obliquity la oblicuidad de la
+ * ecliptica y en @mean la longitud media del sol (grados) el dia @days desde J2000.0
+ */
+static void sunEcliptic(double days, double &longitude, double &obliquity, double &mean)
+{
+    // Anomalia media, longitud media y longitud ecliptica
+    double g = (357.529 + 0.98560028 * days) * DEG;
+    mean = 280.459 + 0.98564736 * days;
+    longitude = mean + 1.915 * sin(g) + 0.020 * sin(2 * g);
+    obliquity = 23.439 - 0.00000036 * days;
+}
+
+void DomDomAstronomy::sun(double days, float &declination, float &equation)
+{
+    double L, e, q;
+    sunEcliptic(days, L, e, q);
+    L *= DEG;
+    e *= DEG;
+
+    double ra = atan2(cos(e) * sin(L), cos(L)) / DEG;
+
+    declination = asin(sin(e) * sin(L)) / DEG;
+    equation = 4 * wrap180(q - ra);
+}
+
+float DomDomAstronomy::sunHourAngle(float utcMinutes, float longitude, float equation)
+{
+    // Tiempo solar verdadero, a mediodia el angulo es cero
+    float solar = utcMinutes + 4 * longitude + equation;
+    return solar / 4 - 180;
+}
+
+double DomDomAstronomy::siderealTime(double days)
+{
+    return fmod(280.46061837 + 360.98564736629 * days, 360);
+}
+
+void DomDomAstronomy::moon(double days, float &rightAscension, float &declination, float &phase, float &illumination)
+{
+    // Terminos principales de la longitud y latitud eclipticas en siglos desde J2000.0
+    double T = days / 36525;
+    double lambda = 218.32 + 481267.881 * T
+        + 6.29 * sin((135.0 + 477198.87 * T) * DEG)
+        - 1.27 * sin((259.3 - 413335.36 * T) * DEG)
+        + 0.66 * sin((235.7 + 890534.22 * T) * DEG)
+        + 0.21 * sin((269.9 + 954397.74 * T) * DEG)
+        - 0.19 * sin((357.5 + 35999.05 * T) * DEG)
+        - 0.11 * sin((186.5 + 966404.03 * T) * DEG);
+    double beta = 5.13 * sin((93.3 + 483202.02 * T) * DEG)
+        + 0.28 * sin((228.2 + 960400.89 * T) * DEG)
+        - 0.28 * sin((318.3 + 6003.15 * T) * DEG)
+        - 0.17 * sin((217.6 - 407332.21 * T) * DEG);
+
+    double sunLongitude, obliquity, mean;
+    sunEcliptic(days, sunLongitude, obliquity, mean);
+
+    double l = cos(beta * DEG) * cos(lambda * DEG);
+    double m = cos(obliquity * DEG) * cos(beta * DEG) * sin(lambda * DEG) - sin(obliquity * DEG) * sin(beta * DEG);
+    double n = sin(obliquity * DEG) * cos(beta * DEG) * sin(lambda * DEG) + cos(obliquity * DEG) * sin(beta * DEG);
+
+    rightAscension = atan2(m, l) / DEG;
+    declination = asin(n) / DEG;
+
+    // La elongacion da el angulo de fase, el sol esta tan lejos que sus rayos llegan paralelos
+    double elongation = wrap180(lambda - sunLongitude);
+    phase = elongation < 0 ? elongation + 360 : elongation;
+    illumination = (1 - cos(beta * DEG) * cos(elongation * DEG)) / 2;
+}
+
+float DomDomAstronomy::elevation(float latitude, float declination, float hourAngle)
+{
+    float phi = latitude * (float)DEG;
+    float delta = declination * (float)DEG;
+    float sine = sinf(phi) * sinf(delta) + cosf(phi) * cosf(delta) * cosf(hourAngle * (float)DEG);
+
+    sine = sine > 1 ? 1 : (sine < -1 ? -1 : sine);
+
+    return asinf(sine) / (float)DEG;
+}
@@ -0,0 +1,80 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_ASTRONOMY_h
+#define DOMDOM_ASTRONOMY_h
+
+#include <stdint.h>
+
+/**
+ * Calculos astronomicos para la programacion automatica.
+ *
+ * Usa las formulas de baja precision del Astronomical Almanac, con un
+ * error de centesimas de grado, de sobra para la iluminacion. Se usan
+ * una vez al dia, por lo que trabajan en double sin prisa.
+ *
+ * No depende del framework de Arduino para poder compilarse en el host.
+ */
+namespace DomDomAstronomy
+{
+    /**
+     * Altura aparente del centro del sol (grados) en el orto y el ocaso
+     */
+    const float SUNRISE_ELEVATION = -0.833f;
+    /**
+     * Altura aparente del centro de la luna (grados) en su orto y su ocaso con una
+     * paralaje media. Ya tiene en cuenta la refraccion y el semidiametro.
+     */
+    const float MOONRISE_ELEVATION = 0.125f;
+
+    /**
+     * Dias desde J2000.0 (1 de enero de 2000 a las 12:00 UTC) en el instante unix @utc
+     */
+    double daysSinceJ2000(uint32_t utc);
+    /**
+     * Devuelve en @declination la declinacion del sol (grados) y en @equation la
+     * ecuacion del tiempo (minutos) el dia @days desde J2000.0.
+     */
+    void sun(double days, float &declination, float &equation);
+    /**
+     * Angulo horario (grados) del sol a los @utcMinutes minutos UTC del dia en la longitud
+     * @longitude (grados, este positivo) con la ecuacion del tiempo @equation (minutos).
+     */
+    float sunHourAngle(float utcMinutes, float longitude, float equation);
+    /**
+     * Tiempo sidereo medio de Greenwich (grados) el dia @days desde J2000.0
+     */
+    double siderealTime(double days);
+    /**
+     * Devuelve la posicion de la luna el dia @days desde J2000.0: ascension recta y
+     * declinacion (grados), fase (elongacion en longitud desde el sol en grados, 0 es
+     * luna nueva y 180 luna llena) y fraccion iluminada del disco (0 - 1).
+     */
+    void moon(double days, float &rightAscension, float &declination, float &phase, float &illumination);
+    /**
+     * Altura (grados) sobre el horizonte de un astro de declinacion @declination
+     * visto desde la latitud @latitude con el angulo horario @hourAngle (grados).
+     */
+    float elevation(float latitude, float declination, float hourAngle);
+}
+
+#endif /* DOMDOM_ASTRONOMY_h */
@@ -0,0 +1,87 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "brightnessCurve.h"
+
+float DomDomBrightness::apply(uint8_t curve, float percent)
+{
+    percent = percent < 0 ? 0 : (percent > 100 ? 100 : percent);
+
+    const uint16_t *table;
+    switch (curve)
+    {
+        case CURVE_CIE1931:
+            table = Cie1931Table::values;
+            break;
+        case CURVE_GAMMA:
+            table = GammaTable::values;
+            break;
+        case CURVE_CUSTOM:
+            table = CustomTable::values;
+            break;
+        default:
+            return percent / 100.0f;
+    }
+
+    // Interpolamos entre los dos porcentajes enteros vecinos
+    int index = (int)percent;
+    if (index >= BRIGHTNESS_TABLE_SIZE - 1)
+    {
+        return table[BRIGHTNESS_TABLE_SIZE - 1] / (float)UINT16_MAX;
+    }
+
+    float value = table[index] + (table[index + 1] - table[index]) * (percent - index);
+    return value / UINT16_MAX;
+}
+
+uint16_t DomDomBrightness::applyFixed(uint8_t curve, uint32_t percent)
+{
+    const uint32_t one = 1UL << 16;
+    percent = percent > 100 * one ? 100 * one : percent;
+
+    const uint16_t *table;
+    switch (curve)
+    {
+        case CURVE_CIE1931:
+            table = Cie1931Table::values;
+            break;
+        case CURVE_GAMMA:
+            table = GammaTable::values;
+            break;
+        case CURVE_CUSTOM:
+            table = CustomTable::values;
+            break;
+        default:
+            return ((uint64_t)percent * UINT16_MAX + 50 * one) / (100 * one);
+    }
+
+    // Interpolamos entre los dos porcentajes enteros vecinos con la fraccion en 16 bits
+    uint32_t index = percent >> 16;
+    if (index >= BRIGHTNESS_TABLE_SIZE - 1)
+    {
+        return table[BRIGHTNESS_TABLE_SIZE - 1];
+    }
+
+    int32_t delta = (int32_t)table[index + 1] - table[index];
+    int32_t fraction = percent & (one - 1);
+
+    return table[index] + (int32_t)(((int64_t)delta * fraction + (one / 2)) >> 16);
+}
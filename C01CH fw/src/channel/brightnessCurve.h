@@ -0,0 +1,156 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_BRIGHTNESSCURVE_h
+#define DOMDOM_BRIGHTNESSCURVE_h
+
+#include <stdint.h>
+#include "configuration.h"
+
+/**
+ * Un valor por cada porcentaje, de 0 a 100
+ */
+#define BRIGHTNESS_TABLE_SIZE   101
+
+/**
+ * Curvas disponibles para convertir el porcentaje de un canal en corriente
+ */
+enum DomDomBrightnessCurve
+{
+    CURVE_LINEAR = 0,
+    CURVE_CIE1931 = 1,
+    CURVE_GAMMA = 2,
+    CURVE_CUSTOM = 3,
+    CURVE_COUNT
+};
+
+/**
+ * Tablas de brillo perceptual.
+ *
+ * Las tablas se calculan al compilar (constexpr compatible con C++11),
+ * por lo que en tiempo de ejecucion solo cuesta una interpolacion.
+ * Cada tabla guarda la fraccion de corriente (0 - 65535) para cada
+ * porcentaje de brillo percibido.
+ */
+namespace DomDomBrightness
+{
+    constexpr double LN2 = 0.693147180559945309;
+
+    constexpr double square(double x) { return x * x; }
+
+    constexpr double cube(double x) { return x * x * x; }
+
+    /**
+     * Serie de ln(x) = 2 * atanh(z) con z = (x-1)/(x+1)
+     */
+    constexpr double lnSeries(double z2, double term, int n)
+    {
+        return n > 41 ? 0 : term / n + lnSeries(z2, term * z2, n + 2);
+    }
+
+    constexpr double lnReduced(double x)
+    {
+        return 2 * lnSeries(square((x - 1) / (x + 1)), (x - 1) / (x + 1), 1);
+    }
+
+    /**
+     * Logaritmo natural para 0 < x <= 1. Se lleva x a [0.5, 1] para que la serie converja rapido
+     */
+    constexpr double ln(double x)
+    {
+        return x < 0.5 ? ln(x * 2) - LN2 : lnReduced(x);
+    }
+
+    constexpr double expSeries(double y, double term, int n)
+    {
+        return n > 24 ? term : term + expSeries(y, term * y / n, n + 1);
+    }
+
+    /**
+     * Exponencial para y <= 0. Se divide y hasta [-0.5, 0] y se eleva al cuadrado
+     */
+    constexpr double exp(double y)
+    {
+        return y < -0.5 ? square(exp(y / 2)) : expSeries(y, 1, 1);
+    }
+
+    constexpr double pow(double x, double exponent)
+    {
+        return x <= 0 ? 0 : (x >= 1 ? 1 : exp(exponent * ln(x)));
+    }
+
+    /**
+     * Luminancia relativa para una luminosidad L* (CIE 1931) de @percent
+     */
+    constexpr double cie1931(double percent)
+    {
+        return percent > 8 ? cube((percent + 16) / 116) : percent / 903.3;
+    }
+
+    constexpr double CUSTOM_POINTS[] = CHANNEL_BRIGHTNESS_CUSTOM_POINTS;
+
+    /**
+     * Interpolacion lineal entre los puntos de la curva personalizada (uno cada 10%)
+     */
+    constexpr double custom(double percent)
+    {
+        return percent >= 100 ? CUSTOM_POINTS[10] / 100 :
+            (CUSTOM_POINTS[(int)percent / 10] + (CUSTOM_POINTS[(int)percent / 10 + 1] - CUSTOM_POINTS[(int)percent / 10]) * (percent - ((int)percent / 10) * 10) / 10) / 100;
+    }
+
+    constexpr uint16_t toTable(double fraction)
+    {
+        return fraction <= 0 ? 0 : (fraction >= 1 ? UINT16_MAX : (uint16_t)(fraction * UINT16_MAX + 0.5));
+    }
+
+    struct Cie1931Curve { static constexpr double value(double percent) { return cie1931(percent); } };
+    struct GammaCurve { static constexpr double value(double percent) { return pow(percent / 100, CHANNEL_BRIGHTNESS_GAMMA); } };
+    struct CustomCurve { static constexpr double value(double percent) { return custom(percent); } };
+
+    template <int... I> struct Indices {};
+    template <int N, int... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+    template <int... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+    template <typename Curve, typename Index> struct Table;
+    template <typename Curve, int... I> struct Table<Curve, Indices<I...>>
+    {
+        static constexpr uint16_t values[sizeof...(I)] = { toTable(Curve::value(I))... };
+    };
+    template <typename Curve, int... I> constexpr uint16_t Table<Curve, Indices<I...>>::values[sizeof...(I)];
+
+    typedef MakeIndices<BRIGHTNESS_TABLE_SIZE>::type TableIndices;
+    typedef Table<Cie1931Curve, TableIndices> Cie1931Table;
+    typedef Table<GammaCurve, TableIndices> GammaTable;
+    typedef Table<CustomCurve, TableIndices> CustomTable;
+
+    /**
+     * Devuelve la fraccion de corriente (0 - 1) para el porcentaje @percent con la curva @curve.
+     */
+    float apply(uint8_t curve, float percent);
+    /**
+     * Igual que apply() sin coma flotante. Recibe el porcentaje en coma fija Q16
+     * (1% = 65536) y devuelve la fraccion de corriente entre 0 y UINT16_MAX.
+     */
+    uint16_t applyFixed(uint8_t curve, uint32_t percent);
+}
+
+#endif /* DOMDOM_BRIGHTNESSCURVE_h */
@@ -0,0 +1,160 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "calibrationTable.h"
+
+// Peso de cada nueva lectura al refinar la tabla (1/2^n)
+const uint8_t REFINE_SHIFT = 3;
+
+uint16_t toUShort(float value)
+{
+    if (value <= 0)
+    {
+        return 0;
+    }
+
+    return value >= UINT16_MAX ? UINT16_MAX : (uint16_t)(value + 0.5f);
+}
+
+DomDomCalibrationTable::DomDomCalibrationTable()
+{
+    clear();
+}
+
+void DomDomCalibrationTable::clear()
+{
+    for (int i = 0; i < CALIBRATION_TABLE_SIZE; i++)
+    {
+        mA[i] = 0;
+        mV[i] = 0;
+    }
+
+    _valid = false;
+    _dirty = false;
+    _last_dac = 0;
+}
+
+void DomDomCalibrationTable::set(uint8_t dac, float current, float volts)
+{
+    mA[dac] = toUShort(current);
+    mV[dac] = toUShort(volts * 1000.0f);
+    _dirty = true;
+}
+
+void DomDomCalibrationTable::finish(uint8_t last_dac)
+{
+    // El barrido va desde el codigo maximo hacia abajo, lo que no se midio
+    // queda saturado con la ultima lectura
+    for (int i = last_dac - 1; i >= 0; i--)
+    {
+        mA[i] = mA[last_dac];
+        mV[i] = mV[last_dac];
+    }
+
+    for (int i = CALIBRATION_TABLE_SIZE - 2; i >= 0; i--)
+    {
+        if (mA[i] < mA[i+1])
+        {
+            mA[i] = mA[i+1];
+        }
+    }
+
+    _last_dac = last_dac;
+    _valid = true;
+    _dirty = true;
+}
+
+void DomDomCalibrationTable::refine(uint8_t dac, float current, float volts)
+{
+    if (!_valid)
+    {
+        return;
+    }
+
+    int32_t measured = toUShort(current);
+    int32_t delta = (measured - mA[dac]) / (1 << REFINE_SHIFT);
+    if (delta == 0)
+    {
+        return;
+    }
+
+    mA[dac] += delta;
+    mV[dac] += ((int32_t)toUShort(volts * 1000.0f) - mV[dac]) / (1 << REFINE_SHIFT);
+
+    enforceMonotonic(dac);
+    _dirty = true;
+}
+
+void DomDomCalibrationTable::enforceMonotonic(uint8_t dac)
+{
+    for (int i = dac - 1; i >= 0 && mA[i] < mA[dac]; i--)
+    {
+        mA[i] = mA[dac];
+    }
+
+    for (int i = dac + 1; i < CALIBRATION_TABLE_SIZE && mA[i] > mA[dac]; i++)
+    {
+        mA[i] = mA[dac];
+    }
+}
+
+bool DomDomCalibrationTable::lookup(float target_mA, float &dac) const
+{
+    if (!_valid)
+    {
+        return false;
+    }
+
+    // Los codigos por debajo del ultimo medido no se llegaron a probar, nos quedamos
+    // en el de mayor corriente medida
+    if (target_mA >= mA[_last_dac])
+    {
+        dac = _last_dac;
+        return true;
+    }
+
+    if (target_mA <= mA[CALIBRATION_TABLE_SIZE - 1])
+    {
+        dac = CALIBRATION_TABLE_SIZE - 1;
+        return true;
+    }
+
+    // Buscamos el ultimo codigo con una corriente mayor o igual al objetivo
+    int low = _last_dac;
+    int high = CALIBRATION_TABLE_SIZE - 1;
+    while (high - low > 1)
+    {
+        int mid = (low + high) / 2;
+        if (mA[mid] >= target_mA)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    // Interpolamos entre los dos codigos vecinos
+    float span = mA[low] - mA[high];
+    dac = low + (span > 0 ? (mA[low] - target_mA) / span : 0);
+
+    return true;
+}
@@ -0,0 +1,119 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+#ifndef DOMDOM_CALIBRATIONTABLE_h
+#define DOMDOM_CALIBRATIONTABLE_h
+
+#include <stdint.h>
+
+#define CALIBRATION_TABLE_SIZE  256
+
+/**
+ * Tabla de calibracion DAC -> mA / V.
+ *
+ * Guarda para cada codigo DAC la corriente y el voltaje medidos.
+ * Como la salida esta invertida la corriente nunca aumenta al
+ * aumentar el codigo DAC, y la tabla se mantiene siempre monotona
+ * para poder buscar en ella de forma binaria.
+ *
+ * No depende del framework de Arduino para poder compilarse en el host.
+ */
+class DomDomCalibrationTable
+{
+    private:
+        /**
+         * Indica si la tabla contiene una calibracion completa
+         */
+        bool _valid;
+        /**
+         * Indica si hay cambios sin guardar
+         */
+        bool _dirty;
+        /**
+         * Ultimo codigo medido en el barrido, el de mayor corriente. Los codigos
+         * inferiores no se midieron y copian su lectura.
+         */
+        uint8_t _last_dac;
+        /**
+         * Fuerza la monotonia de la tabla alrededor de @dac
+         */
+        void enforceMonotonic(uint8_t dac);
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomCalibrationTable();
+        /**
+         * Corriente medida para cada codigo DAC
+         */
+        uint16_t mA[CALIBRATION_TABLE_SIZE];
+        /**
+         * Voltaje medido (mV) para cada codigo DAC
+         */
+        uint16_t mV[CALIBRATION_TABLE_SIZE];
+        /**
+         * Borra la tabla.
+         */
+        void clear();
+        /**
+         * Guarda una medida tomada durante el barrido de calibracion.
+         */
+        void set(uint8_t dac, float mA, float volts);
+        /**
+         * Rellena los codigos que no se midieron durante el barrido a partir de @last_dac
+         * y marca la tabla como valida.
+         */
+        void finish(uint8_t last_dac);
+        /**
+         * Refina la tabla con una lectura estable.
+         */
+        void refine(uint8_t dac, float mA, float volts);
+        /**
+         * Devuelve en @dac el codigo (con decimales) para obtener @target_mA. Por encima
+         * de la corriente medida devuelve el ultimo codigo medido, nunca uno sin medir.
+         * Devuelve falso si la tabla no es valida.
+         */
+        bool lookup(float target_mA, float &dac) const;
+        /**
+         * Indica si la tabla contiene una calibracion completa
+         */
+        bool isValid() const { return _valid; };
+        /**
+         * Indica si hay cambios sin guardar
+         */
+        bool isDirty() const { return _dirty; };
+        /**
+         * Ultimo codigo medido en el barrido
+         */
+        uint8_t lastDac() const { return _last_dac; };
+        /**
+         * Marca la tabla como valida y sin cambios tras cargarla de memoria, con
+         * @last_dac como ultimo codigo medido.
+         */
+        void setLoaded(bool valid, uint8_t last_dac) { _valid = valid; _last_dac = last_dac; _dirty = false; };
+        /**
+         * Marca la tabla como guardada.
+         */
+        void setSaved() { _dirty = false; };
+};
+
+#endif /* DOMDOM_CALIBRATIONTABLE_h */
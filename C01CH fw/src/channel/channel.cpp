@@ -19,16 +19,12 @@
  */
 
 #include "channel.h"
+#include <time.h>
 #include <EEPROM.h>
 #include "configuration.h"
 #include "../log/logger.h"
 
-const uint32_t SHUNT_MICRO_OHM      = 100000;  ///< Shunt resistance in Micro-Ohm, e.g. 100000 is 0.1 Ohm
-const uint16_t MAXIMUM_AMPS         = 3;       ///< Max expected amps, values are 1 - clamped to max 1022
-const uint16_t INA_AVERAGING        = 64;
-const uint16_t INA_CONVERSION_TIME  = 8244;
-
-DomDomChannelClass::DomDomChannelClass(uint8_t INA_address = 0x40, uint8_t channel)
+DomDomChannelClass::DomDomChannelClass(uint8_t INA_address, uint8_t channel)
 {
     _channel_num = channel;
     tag = String("CHANNEL ");
@@ -36,15 +32,52 @@ DomDomChannelClass::DomDomChannelClass(uint8_t INA_address = 0x40, uint8_t chann
 
     _enabled = true;
     _iniciado = false;
+    _calibrating = false;
+    _alert_enabled = false;
+    _trip_enabled = false;
+    _trip_limit_mA = 0;
+    _trip = TRIP_NONE;
+    _trip_reset = false;
+    _conversion_ready = false;
+    _end_pending = false;
+    _task_handle = NULL;
+    _INA = NULL;
+    _INA_devices = 0;
+    _reset_peaks = false;
+    _reset_timing = false;
+    _fast_mode = true;
+    _stable_samples = 0;
+
+    int alert_pins[CHANNEL_SIZE] = CHANNEL_INA_ALERT_PIN;
+    _alert_pin = alert_pins[_channel_num];
+
+    int channels_pin[CHANNEL_SIZE] = CHANNEL_CURRENT_PIN;
+    dac_pwm_pin = channels_pin[_channel_num];
 
     maximum_mA = 100.0f;
     minimum_mA = 0.0f;
     maximum_V = 0.0f;
+    brightness_curve = CHANNEL_BRIGHTNESS_CURVE;
+    max_slew_mA_s = CHANNEL_RAMP_MAX_SLEW;
+    target_mA = 0;
+    _setpoint_mA = 0;
+    _goal_mA = 0;
+    _ramp_from_mA = 0;
+    _ramp_start_ms = 0;
+    _ramp_duration_ms = 0;
 
     INA_device_index = UINT8_MAX;
     _INA_address = INA_address;
 }
 
+bool DomDomChannelClass::begin(INA_Class &ina, uint8_t devicesFound)
+{
+    _INA = &ina;
+    _INA_devices = devicesFound;
+
+    return begin();
+}
+
 bool DomDomChannelClass::begin()
 {
     DomDomLogger.log(DomDomLoggerClass::LogLevel::info, tag.c_str(), "Iniciando canal...");
@@ -55,27 +88,15 @@ bool DomDomChannelClass::begin()
         return false;
     }
 
-    // Iniciamos el INA
-    INA._EEPROM_offset = EEPROM_SIZE;
-    INA._EEPROM_size = EEPROM_INA_SIZE;
-    uint8_t devicesFound = 0;
-    uint8_t max_retries = 3;
-    uint8_t retry = 0;
-
-    do
+    // Buscamos nuestro INA entre los encontrados en el bus
+    INA_device_index = UINT8_MAX;
+    for (uint8_t i = 0; _INA != NULL && i < _INA_devices; i++)
     {
-        devicesFound = INA.begin(MAXIMUM_AMPS, SHUNT_MICRO_OHM);
-        for (uint8_t i = 0; i < devicesFound; i++)  // Loop through all devices
+        if (_INA->getDeviceAddress(i) == _INA_address )
         {
-            if (INA.getDeviceAddress(i) == _INA_address )
-            {
-                INA_device_index = i;
-            }
-        } 
-
-        retry++;
-
-    }while (INA_device_index == UINT8_MAX && retry < max_retries);
+            INA_device_index = i;
+        }
+    }
 
     if (INA_device_index == UINT8_MAX)
     {
@@ -87,20 +108,15 @@ bool DomDomChannelClass::begin()
         return false;
     }
 
-    INA.setAveraging(INA_AVERAGING, INA_device_index);                         // Average each reading n-times
-    INA.setBusConversion(INA_CONVERSION_TIME,INA_device_index);                // Maximum conversion time 8.244ms
-    INA.setShuntConversion(INA_CONVERSION_TIME,INA_device_index);              // Maximum conversion time 8.244ms
-    INA.setMode(INA_MODE_CONTINUOUS_BOTH,INA_device_index);                    // Bus/shunt measured continuously
+    setFastMode(true);                                                          // Conversiones rapidas hasta estabilizar
+    _INA->setMode(INA_MODE_CONTINUOUS_BOTH,INA_device_index);                    // Bus/shunt measured continuously
+    beginAlert();
 
+    // Solo con el INA configurado la tarea de control empieza a usar el canal, y
+    // reinicia su estado en la siguiente vuelta
+    _end_pending = false;
+    _control_reset = true;
     _iniciado = true;
-    xTaskCreate(
-        this->limitCurrentTask, /* Task function. */
-        "Current_Task",         /* String with name of task. */
-        10000,                  /* Stack size in bytes. */
-        NULL,                   /* Parameter passed as input of the task */
-        1,                      /* Priority of the task. */
-        NULL                    /* Task handle. */
-    );
 
     DomDomLogger.log(DomDomLoggerClass::LogLevel::info, tag.c_str(), "Iniciando canal...OK!");
     return true;
@@ -109,109 +125,726 @@ bool DomDomChannelClass::begin()
 bool DomDomChannelClass::end()
 {
     _iniciado = false;
+
+    if (_alert_enabled || _trip_enabled)
+    {
+        detachInterrupt(_alert_pin);
+        _INA->alertOnConversion(false, INA_device_index);
+        _alert_enabled = false;
+        _trip_enabled = false;
+    }
+
     return true;
 }
 
+void DomDomChannelClass::setFastMode(bool fast)
+{
+    _fast_mode = fast;
+    _stable_samples = 0;
+
+    uint16_t averaging = fast ? CHANNEL_INA_FAST_AVERAGING : CHANNEL_INA_AVERAGING;
+    uint32_t conversion = fast ? CHANNEL_INA_FAST_CONVERSION_TIME : CHANNEL_INA_CONVERSION_TIME;
+
+    _INA->setAveraging(averaging, INA_device_index);
+    _INA->setBusConversion(conversion, INA_device_index);
+    _INA->setShuntConversion(conversion, INA_device_index);
+}
 
-void DomDomChannelClass::limitCurrentTask(void *parameter)
+void DomDomChannelClass::beginAlert()
 {
-    uint8_t max_dac_pwm = 255;
-    uint8_t min_dac_pwm = 0;
-    uint8_t curr_pwm = max_dac_pwm;
+    _alert_enabled = false;
+    _trip_enabled = false;
 
-    int channels_pin[CHANNEL_SIZE] = CHANNEL_CURRENT_PIN;
-    int channel = channels_pin[DomDomChannel.getNum()];
+    if (_alert_pin < 0)
+    {
+        return;
+    }
+
+#if CHANNEL_TRIP_HARDWARE
+    // El pin sigue al limite mientras se supera, asi la interrupcion corta el canal en
+    // cuanto termina la conversion que lo supera y el fin de conversion se consulta por I2C
+    if (setTripLimit())
+    {
+        pinMode(_alert_pin, INPUT_PULLUP);
+        attachInterruptArg(_alert_pin, tripAlertISR, this, FALLING);
+
+        _trip_enabled = true;
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, tag.c_str(), "Proteccion por sobrecorriente en el pin %d", _alert_pin);
+        return;
+    }
+#endif
+
+    // Solo los INA226/230/231/260 tienen pin de alerta, el resto seguira consultando por I2C
+    if (!_INA->alertOnConversion(true, INA_device_index))
+    {
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::info, tag.c_str(), "INA sin pin de alerta. Se consultara por I2C");
+        return;
+    }
+
+    pinMode(_alert_pin, INPUT_PULLUP);
+    attachInterruptArg(_alert_pin, conversionAlertISR, this, FALLING);
+
+    // Leer el registro de mascara libera el pin si habia una conversion pendiente
+    _INA->conversionFinished(INA_device_index);
+
+    _alert_enabled = true;
+    DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, tag.c_str(), "Alerta de conversion en el pin %d", _alert_pin);
+}
 
-    dacWrite(channel, curr_pwm);
+bool DomDomChannelClass::setTripLimit()
+{
+    // Tension en el shunt (mV) para la corriente maxima mas el margen
+    float limit_mV = maximum_mA * (1 + CHANNEL_TRIP_MARGIN) * CHANNEL_SHUNT_MICRO_OHM / 1000000.0f;
 
-    float prev_maxV = -1;
-    float prev_targetmA = -999;
+    // La libreria divide entre el LSB del shunt expresado en decimas de uV,
+    // por lo que el limite se le pasa en decimas de mV
+    int32_t tenthsMilliVolts = (int32_t)ceilf(limit_mV * 10);
+    tenthsMilliVolts = tenthsMilliVolts < 1 ? 1 : tenthsMilliVolts;
 
-    DomDomChannel.is_current_stable = false;
-    int8_t pwm_dir = 0;
+    _trip_limit_mA = maximum_mA;
+    return _INA->alertOnShuntOverVoltage(true, tenthsMilliVolts, INA_device_index);
+}
 
-    while(DomDomChannel.started())
+void IRAM_ATTR DomDomChannelClass::tripAlertISR(void *arg)
+{
+    DomDomChannelClass *channel = (DomDomChannelClass *)arg;
+
+    // La salida esta invertida, el codigo maximo da la corriente minima
+    DomDomDacOutput.writeNow(channel->dac_pwm_pin, UINT8_MAX);
+    channel->_trip = TRIP_OVERCURRENT;
+}
+
+void DomDomChannelClass::trip(DomDomChannelTrip reason)
+{
+    DomDomDacOutput.writeNow(dac_pwm_pin, UINT8_MAX);
+    _trip = reason;
+}
+
+void IRAM_ATTR DomDomChannelClass::conversionAlertISR(void *arg)
+{
+    DomDomChannelClass *channel = (DomDomChannelClass *)arg;
+    channel->_conversion_ready = true;
+
+    if (channel->_task_handle == NULL)
+    {
+        return;
+    }
+
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(channel->_task_handle, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+void DomDomChannelClass::waitForConversion()
+{
+    if (_alert_enabled)
     {
-        DomDomChannel.INA.waitForConversion(DomDomChannel.INA_device_index);
-            
-        // Si los voltios o los miliamperios objetivos varían una vez estabilizado volvemos a estabilizar
-        if (DomDomChannel.maximum_V != prev_maxV || DomDomChannel.target_mA != prev_targetmA)
+        // Esperamos a la interrupcion sin ocupar el bus I2C. La tarea es compartida
+        // por todos los canales, asi que la notificacion puede ser de otro canal.
+        // Cada espera es solo por el tiempo que queda hasta el limite
+        TickType_t start = xTaskGetTickCount();
+        TickType_t timeout = pdMS_TO_TICKS(CHANNEL_INA_ALERT_TIMEOUT);
+        TickType_t elapsed;
+        while (!_conversion_ready && (elapsed = xTaskGetTickCount() - start) < timeout)
+        {
+            ulTaskNotifyTake(pdTRUE, timeout - elapsed);
+        }
+
+        if (_conversion_ready)
         {
-            prev_maxV = DomDomChannel.maximum_V;
-            prev_targetmA = DomDomChannel.target_mA;
-            DomDomChannel.is_current_stable = false;
-            pwm_dir = 0;
-        } 
+            _conversion_ready = false;
 
-        float volts = DomDomChannel.INA.getBusMilliVolts(DomDomChannel.INA_device_index) / 1000.0f;
-        float amps = DomDomChannel.INA.getBusMicroAmps(DomDomChannel.INA_device_index) / 1000.0f;
-        float power = amps * volts;
-        power = power < 0 ? 0 : power;
+            // Leer el registro de mascara libera el pin para la siguiente conversion
+            _INA->conversionFinished(INA_device_index);
+            return;
+        }
 
-        DomDomChannel.lastBusCurrent_mA = amps;
-        DomDomChannel.lastBusVoltaje_V = volts;
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::warn, tag.c_str(), "Sin alerta de conversion del INA. Se consulta por I2C");
+    }
 
-        // Guardamos los maximos
-        DomDomChannel.busPowerPeak_W = DomDomChannel.busPowerPeak_W > power ? DomDomChannel.busPowerPeak_W : power;
-        DomDomChannel.busCurrentPeak_mA = DomDomChannel.busCurrentPeak_mA > amps ? DomDomChannel.busCurrentPeak_mA : amps;
-        DomDomChannel.busVoltagePeak_V = DomDomChannel.busVoltagePeak_V > volts ? DomDomChannel.busVoltagePeak_V : volts;
+    _INA->waitForConversion(INA_device_index);
+}
 
-        
-        // Calculamos la histeresis en funcion del valor maximo para la corriente
-        // Establecemos un minimo de 5mA
-        float mA_histeresis = (DomDomChannel.maximum_mA * 0.5);
-        mA_histeresis = mA_histeresis < 5 ? 5 : mA_histeresis;
-        // Comprobamos si la corriente esta en el rango establecido
-        bool mAInRange = (amps < (DomDomChannel.target_mA + mA_histeresis) && amps > (DomDomChannel.target_mA - mA_histeresis));
-        if (DomDomChannel.is_current_stable && !mAInRange)
+
+void DomDomChannelClass::controlReset()
+{
+    _control_reset = false;
+
+    controller.reset(controller.output_max);
+
+    _curr_dac = controller.output_max;
+    _prev_dac = _curr_dac;
+    DomDomDacOutput.write(dac_pwm_pin, _curr_dac);
+
+    _prev_targetmA = -999;
+    _last_ms = millis();
+    _last_calibration_save_ms = millis();
+
+    // La pausa hasta este arranque no cuenta como periodo del bucle
+    _timing.restart();
+
+    // Con la salida al minimo la rampa arranca desde cero
+    _setpoint_mA = 0;
+    _goal_mA = 0;
+
+    is_current_stable = false;
+}
+
+bool DomDomChannelClass::rampStep(unsigned long now_ms, float dt_s)
+{
+    portENTER_CRITICAL(&_ramp_mux);
+    float target = target_mA;
+    float from = _ramp_from_mA;
+    unsigned long start = _ramp_start_ms;
+    uint32_t duration = _ramp_duration_ms;
+    portEXIT_CRITICAL(&_ramp_mux);
+
+    // Punto del tramo en este instante, el tiempo se mide en ms enteros
+    uint32_t elapsed = now_ms - start;
+    float goal = elapsed >= duration ? target : from + (target - from) * ((float)elapsed / duration);
+
+    // Limitamos la pendiente de la consigna
+    float step = goal - _setpoint_mA;
+    if (max_slew_mA_s > 0)
+    {
+        float max_step = max_slew_mA_s * dt_s;
+        step = step > max_step ? max_step : (step < -max_step ? -max_step : step);
+    }
+
+    _setpoint_mA += step;
+
+    return _setpoint_mA != target;
+}
+
+void DomDomChannelClass::controlStep(const DomDomWeatherSample &weather)
+{
+    if (_end_pending)
+    {
+        _end_pending = false;
+        end();
+        return;
+    }
+
+    if (_control_reset)
+    {
+        controlReset();
+    }
+
+    if (_trip_reset)
+    {
+        _trip_reset = false;
+        _trip = TRIP_NONE;
+        controlReset();
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::info, tag.c_str(), "Proteccion rearmada");
+    }
+
+    _timing.startIteration();
+
+    // El limite del INA sigue a la corriente maxima configurada
+    if (_trip_enabled && _trip_limit_mA != maximum_mA)
+    {
+        setTripLimit();
+    }
+
+    if (_calibrating)
+    {
+        // Mientras dura el barrido el resto de canales mantienen su ultimo codigo
+        calibrationSweep(dac_pwm_pin);
+
+        // Volvemos a calcular el codigo para el objetivo actual
+        _prev_dac = _curr_dac;
+        controller.reset(_curr_dac);
+        _prev_targetmA = -999;
+        _last_ms = millis();
+
+        // El barrido no cuenta en los tiempos del bucle
+        _timing.restart();
+        _timing.startIteration();
+    }
+
+    _timing.mark(LOOP_PHASE_COMPUTE);
+    waitForConversion();
+    _timing.mark(LOOP_PHASE_WAIT);
+
+    unsigned long now_ms = millis();
+    float dt_s = (now_ms - _last_ms) / 1000.0f;
+
+    // Tiempo de la conversion que acabamos de leer en cada modo
+    if (_fast_mode)
+    {
+        _reading.fast_mode_ms += now_ms - _last_ms;
+    }
+    else
+    {
+        _reading.slow_mode_ms += now_ms - _last_ms;
+    }
+    _last_ms = now_ms;
+
+    if (target_mA != _prev_targetmA)
+    {
+        _prev_targetmA = target_mA;
+        is_current_stable = false;
+    }
+
+    // La rampa mueve la consigna hacia el objetivo en cada conversion, y las nubes y
+    // rayos se aplican sobre ella sin tocar la rampa
+    float prev_goal = _goal_mA;
+    bool ramping = rampStep(now_ms, dt_s);
+    _goal_mA = DomDomWeather::apply(weather, _setpoint_mA, minimum_mA, maximum_mA);
+    bool changing = ramping || weather.active();
+
+    // Mientras hay rampa o efecto usamos conversiones rapidas para seguirlos a decenas de Hz
+    if (changing && !_fast_mode)
+    {
+        setFastMode(true);
+        _reading.mode_switches++;
+    }
+
+    // Llevamos la prealimentacion al codigo estimado para la nueva consigna. La tabla de
+    // calibracion tiene preferencia sobre la recta aprendida
+    if (_goal_mA != prev_goal)
+    {
+        float dac;
+        if (calibration.lookup(_goal_mA, dac) || controller.feedForward(_goal_mA, dac))
+        {
+            controller.track(dac);
+        }
+    }
+
+    _timing.mark(LOOP_PHASE_COMPUTE);
+    float volts = _INA->getBusMilliVolts(INA_device_index) / 1000.0f;
+    float amps = _INA->getBusMicroAmps(INA_device_index) / 1000.0f;
+    _timing.mark(LOOP_PHASE_I2C);
+
+    float power = amps * volts;
+    power = power < 0 ? 0 : power;
+
+    if (_reset_peaks)
+    {
+        _reset_peaks = false;
+        _reading.busPowerPeak_W = 0;
+        _reading.busCurrentPeak_mA = 0;
+        _reading.busVoltagePeak_V = 0;
+    }
+
+    _reading.busCurrent_mA = amps;
+    _reading.busVoltage_V = volts;
+    _reading.busPower_W = power;
+    _reading.setpoint_mA = _goal_mA;
+    _reading.time_ms = now_ms;
+
+    // Proteccion por software, para los INA sin pin de alerta y para el voltaje. El pin se
+    // comprueba tambien por si ya estaba activo al configurar la interrupcion por flanco
+    if (_trip == TRIP_NONE)
+    {
+        if (amps > maximum_mA * (1 + CHANNEL_TRIP_MARGIN) || (_trip_enabled && digitalRead(_alert_pin) == LOW))
+        {
+            trip(TRIP_OVERCURRENT);
+        }
+        else if (maximum_V > 0 && volts > maximum_V * (1 + CHANNEL_TRIP_MARGIN))
+        {
+            trip(TRIP_OVERVOLTAGE);
+        }
+    }
+
+    if (_reading.trip != _trip)
+    {
+        _reading.trip = _trip;
+        if (_trip != TRIP_NONE)
+        {
+            DomDomLogger.log(DomDomLoggerClass::LogLevel::error, tag.c_str(), _trip == TRIP_OVERVOLTAGE ? "Sobretension! Canal cortado (%.2f V)" : "Sobrecorriente! Canal cortado (%.1f mA)", _trip == TRIP_OVERVOLTAGE ? volts : amps);
+        }
+    }
+
+    // Guardamos los maximos
+    _reading.busPowerPeak_W = _reading.busPowerPeak_W > power ? _reading.busPowerPeak_W : power;
+    _reading.busCurrentPeak_mA = _reading.busCurrentPeak_mA > amps ? _reading.busCurrentPeak_mA : amps;
+    _reading.busVoltagePeak_V = _reading.busVoltagePeak_V > volts ? _reading.busVoltagePeak_V : volts;
+
+    // La conversion promedia el codigo anterior y el actual, aprendemos con su media
+    if (amps > CHANNEL_CONTROL_LEARN_MIN_MA)
+    {
+        controller.learn((_prev_dac + _curr_dac) / 2.0f, amps);
+    }
+
+    float error = _goal_mA - amps;
+
+    // Si superamos el voltaje maximo nunca aumentamos la corriente
+    if (volts > maximum_V)
+    {
+        error = (error < 0 ? error : 0) - CHANNEL_CONTROL_VOLTAGE_BACKOFF_MA;
+    }
+
+    // Calculamos la tolerancia en funcion del valor maximo para la corriente
+    float mA_tolerance = maximum_mA * CHANNEL_CONTROL_TOLERANCE;
+    mA_tolerance = mA_tolerance < CHANNEL_CONTROL_MIN_TOLERANCE_MA ? CHANNEL_CONTROL_MIN_TOLERANCE_MA : mA_tolerance;
+    bool mAInRange = error < mA_tolerance && error > -mA_tolerance;
+
+    if (is_current_stable != mAInRange)
+    {
+        is_current_stable = mAInRange;
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, tag.c_str(), mAInRange ? "DAC Estabilizado (%.2f)" : "DAC fuera de rango (%.2f)", _curr_dac);
+    }
+
+    // Con la corriente estable filtramos mas, y si se aleja volvemos al modo rapido.
+    // El factor de error evita cambiar de modo por el ruido alrededor de la tolerancia
+    _stable_samples = is_current_stable ? _stable_samples + 1 : 0;
+    if (_fast_mode && _stable_samples >= CHANNEL_INA_SLOW_AFTER_STABLE && !changing)
+    {
+        setFastMode(false);
+        _reading.mode_switches++;
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, tag.c_str(), "INA en modo lento");
+    }
+    else if (!_fast_mode && fabsf(error) > mA_tolerance * CHANNEL_INA_FAST_ERROR_FACTOR)
+    {
+        setFastMode(true);
+        _reading.mode_switches++;
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, tag.c_str(), "INA en modo rapido");
+    }
+
+    // Refinamos la tabla solo con lecturas estables de un codigo entero que no ha cambiado
+    long code = lroundf(_curr_dac);
+    if (is_current_stable && _curr_dac == _prev_dac && fabsf(_curr_dac - code) < 0.125f)
+    {
+        calibration.refine(code, amps, volts);
+    }
+
+    if (calibration.isDirty() && now_ms - _last_calibration_save_ms >= CHANNEL_CALIBRATION_SAVE_INTERVAL)
+    {
+        _last_calibration_save_ms = now_ms;
+        saveCalibration();
+    }
+
+    _prev_dac = _curr_dac;
+    if (_trip != TRIP_NONE)
+    {
+        // El disparo queda enclavado con la salida en el extremo seguro hasta rearmarlo
+        controller.reset(controller.output_max);
+        _curr_dac = controller.output_max;
+        _timing.mark(LOOP_PHASE_COMPUTE);
+        DomDomDacOutput.writeNow(dac_pwm_pin, UINT8_MAX);
+    }
+    else
+    {
+        // La salida admite decimales, no redondeamos la salida del controlador
+        _curr_dac = controller.update(error, dt_s);
+        _timing.mark(LOOP_PHASE_COMPUTE);
+        DomDomDacOutput.write(dac_pwm_pin, _curr_dac);
+
+        // Si la interrupcion ha cortado el canal mientras tanto no pisamos su codigo
+        if (_trip != TRIP_NONE)
         {
-            DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, DomDomChannel.tag.c_str(), "DAC fuera de rango! Se vuelve a calcular");
-            DomDomChannel.is_current_stable = false;
-            pwm_dir = 0;
+            DomDomDacOutput.writeNow(dac_pwm_pin, UINT8_MAX);
         }
+    }
+    _timing.mark(LOOP_PHASE_DAC);
+
+    _reading.dac_pwm = lroundf(_curr_dac);
+    _reading.dac_code = _curr_dac;
+    _reading.stable = is_current_stable;
+    _reading.fast_mode = _fast_mode;
+    publishReading();
+
+    time_t now = time(nullptr);
+
+    portENTER_CRITICAL(&_history_mux);
+    _history.add(now, now_ms, power);
+    portEXIT_CRITICAL(&_history_mux);
+
+    // La hora local toma un bloqueo de la libreria, la calculamos antes de la seccion critica
+    if (now != _energy_time)
+    {
+        _energy_time = now;
+        _energy_period = DomDomEnergyMeter::period(now);
+    }
+
+    portENTER_CRITICAL(&_energy_mux);
+    _energy.add(power, dt_s, _energy_period);
+    portEXIT_CRITICAL(&_energy_mux);
+
+    portENTER_CRITICAL(&_timing_mux);
+    if (_reset_timing)
+    {
+        _reset_timing = false;
+        _timing.clear();
+    }
+    _timing.endIteration();
+    portEXIT_CRITICAL(&_timing_mux);
+}
+
+void DomDomChannelClass::publishReading()
+{
+    _reading.sample++;
+    _telemetry.write(_reading);
+}
 
-        if (!DomDomChannel.is_current_stable)
+void DomDomChannelClass::calibrationSweep(int pin)
+{
+    DomDomLogger.log(DomDomLoggerClass::LogLevel::info, tag.c_str(), "Calibrando DAC...");
+
+    // Durante el barrido usamos conversiones rapidas
+    _INA->setAveraging(CHANNEL_CALIBRATION_AVERAGING, INA_device_index);
+
+    calibration.clear();
+    int last_dac = UINT8_MAX;
+    for (int dac = UINT8_MAX; dac >= 0 && _calibrating && _iniciado && _trip == TRIP_NONE; dac--)
+    {
+        DomDomDacOutput.write(pin, dac);
+        _curr_dac = dac;
+
+        // La primera conversion mezcla el codigo anterior y el actual, la descartamos
+        waitForConversion();
+        waitForConversion();
+
+        float volts = _INA->getBusMilliVolts(INA_device_index) / 1000.0f;
+        float amps = _INA->getBusMicroAmps(INA_device_index) / 1000.0f;
+        _reading.busCurrent_mA = amps;
+        _reading.busVoltage_V = volts;
+        _reading.busPower_W = amps * volts;
+        _reading.time_ms = millis();
+        _reading.dac_pwm = dac;
+        _reading.dac_code = dac;
+        _reading.stable = false;
+        publishReading();
+
+        calibration.set(dac, amps, volts);
+        last_dac = dac;
+
+        // No sobrepasamos los limites del canal
+        if (amps > maximum_mA || volts > maximum_V)
         {
-            // Si no hay direccion establecida la establecemos ahora
-            if (pwm_dir == 0)
-            {
-                pwm_dir = (amps < DomDomChannel.target_mA && volts < DomDomChannel.maximum_V) ? -1 : 1;
-                DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, DomDomChannel.tag.c_str(), "Direccion establecida (%d)", pwm_dir);
-            }
-
-            // Si estamos aumentando la potencia (pwm_dir == -1), aumentamos hasta que el valor actual sea mayor que el objetivo mas histeresis
-            if (pwm_dir == -1 && (amps <= DomDomChannel.target_mA && volts <= DomDomChannel.maximum_V) &&  curr_pwm > min_dac_pwm)
-            {
-                dacWrite(channel, --curr_pwm);
-            }
-
-            // Si estamos aumentando la potencia y nos hemos pasado usamos el valor antiguo
-            if (pwm_dir == -1 && (amps > DomDomChannel.target_mA || volts > DomDomChannel.maximum_V || curr_pwm == min_dac_pwm))
-            {
-                DomDomChannel.is_current_stable = true;
-                pwm_dir = 0;
-                DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, DomDomChannel.tag.c_str(), "DAC Estabilizado (%d)", curr_pwm);
-            }
-            
-            // Si estamos disminuyendo la potencia (pwm_dir == 1), disminuimos hasta que el valor actual sea menor que el objetivo menos histeresis
-            if ((pwm_dir == 1) && (amps > DomDomChannel.target_mA || volts > DomDomChannel.maximum_V) && curr_pwm < max_dac_pwm)
-            {
-                dacWrite(channel, ++curr_pwm);
-            }
-
-            //Si estamos dismnuyendo la potencia y nos hemos pasado usamos el valor actual
-            if ((pwm_dir == 1) && ((amps < DomDomChannel.target_mA && volts < DomDomChannel.maximum_V) || curr_pwm == max_dac_pwm))
-            {
-                DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, DomDomChannel.tag.c_str(), "DAC Estabilizado (%d)", curr_pwm);
-                pwm_dir = 0;
-                DomDomChannel.is_current_stable = true;
-            }
-
-            DomDomChannel.curr_dac_pwm = curr_pwm;
+            break;
         }
     }
 
-    vTaskDelete(NULL);
+    setFastMode(true);
+
+    if (_calibrating && _trip == TRIP_NONE)
+    {
+        calibration.finish(last_dac);
+        saveCalibration();
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::info, tag.c_str(), "Calibrando DAC...OK! (%d)", last_dac);
+    }
+    else
+    {
+        loadCalibration();
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::warn, tag.c_str(), "Calibrando DAC...CANCELADO!");
+    }
+
+    _calibrating = false;
+}
+
+uint16_t DomDomChannelClass::historyCount(DomDomHistoryTierType type)
+{
+    portENTER_CRITICAL(&_history_mux);
+    DomDomHistoryTier *tier = _history.tier(type);
+    uint16_t count = tier == nullptr ? _history.rawCount() : tier->count();
+    portEXIT_CRITICAL(&_history_mux);
+
+    return count;
+}
+
+uint16_t DomDomChannelClass::historyIndexOf(DomDomHistoryTierType type, uint32_t time)
+{
+    DomDomHistoryTier *tier = _history.tier(type);
+    if (tier == nullptr)
+    {
+        return 0;
+    }
+
+    portENTER_CRITICAL(&_history_mux);
+    uint16_t index = tier->indexOf(time);
+    portEXIT_CRITICAL(&_history_mux);
+
+    return index;
+}
+
+bool DomDomChannelClass::historyBucket(DomDomHistoryTierType type, uint16_t index, uint32_t &time, DomDomHistoryBucket &bucket)
+{
+    DomDomHistoryTier *tier = _history.tier(type);
+    if (tier == nullptr)
+    {
+        return false;
+    }
+
+    portENTER_CRITICAL(&_history_mux);
+    bool result = tier->get(index, time, bucket);
+    portEXIT_CRITICAL(&_history_mux);
+
+    return result;
+}
+
+bool DomDomChannelClass::historyRaw(uint16_t index, DomDomHistorySample &sample)
+{
+    portENTER_CRITICAL(&_history_mux);
+    bool result = _history.getRaw(index, sample);
+    portEXIT_CRITICAL(&_history_mux);
+
+    return result;
+}
+
+DomDomLoopStats DomDomChannelClass::timing()
+{
+    portENTER_CRITICAL(&_timing_mux);
+    DomDomLoopStats stats = _timing.stats();
+    portEXIT_CRITICAL(&_timing_mux);
+
+    return stats;
+}
+
+DomDomEnergyCounters DomDomChannelClass::energy()
+{
+    portENTER_CRITICAL(&_energy_mux);
+    DomDomEnergyCounters counters = _energy.counters();
+    portEXIT_CRITICAL(&_energy_mux);
+
+    return counters;
+}
+
+bool DomDomChannelClass::saveEnergy(bool commit)
+{
+    portENTER_CRITICAL(&_energy_mux);
+    bool dirty = _energy.isDirty();
+    DomDomEnergyCounters counters = _energy.counters();
+    _energy.setSaved();
+    portEXIT_CRITICAL(&_energy_mux);
+
+    if (!dirty)
+    {
+        return true;
+    }
+
+    int address = getEnergyEEPROMAddress();
+    EEPROM.writeBool(address, true);
+    address += 1;
+    EEPROM.writeDouble(address, counters.total_Wh);
+    address += 8;
+    EEPROM.writeDouble(address, counters.hour_Wh);
+    address += 8;
+    EEPROM.writeDouble(address, counters.day_Wh);
+    address += 8;
+    EEPROM.writeDouble(address, counters.month_Wh);
+    address += 8;
+    EEPROM.writeDouble(address, counters.last_hour_Wh);
+    address += 8;
+    EEPROM.writeDouble(address, counters.last_day_Wh);
+    address += 8;
+    EEPROM.writeDouble(address, counters.last_month_Wh);
+    address += 8;
+    EEPROM.writeInt(address, counters.hour_key);
+    address += 4;
+    EEPROM.writeInt(address, counters.day_key);
+    address += 4;
+    EEPROM.writeInt(address, counters.month_key);
+
+    return !commit || EEPROM.commit();
+}
+
+bool DomDomChannelClass::loadEnergy()
+{
+    int address = getEnergyEEPROMAddress();
+
+    // Cualquier valor distinto de 1 (p.e. una EEPROM sin inicializar) empieza de cero
+    if (EEPROM.read(address) != 1)
+    {
+        return false;
+    }
+    address += 1;
+
+    DomDomEnergyCounters counters;
+    counters.total_Wh = EEPROM.readDouble(address);
+    address += 8;
+    counters.hour_Wh = EEPROM.readDouble(address);
+    address += 8;
+    counters.day_Wh = EEPROM.readDouble(address);
+    address += 8;
+    counters.month_Wh = EEPROM.readDouble(address);
+    address += 8;
+    counters.last_hour_Wh = EEPROM.readDouble(address);
+    address += 8;
+    counters.last_day_Wh = EEPROM.readDouble(address);
+    address += 8;
+    counters.last_month_Wh = EEPROM.readDouble(address);
+    address += 8;
+    counters.hour_key = EEPROM.readInt(address);
+    address += 4;
+    counters.day_key = EEPROM.readInt(address);
+    address += 4;
+    counters.month_key = EEPROM.readInt(address);
+
+    portENTER_CRITICAL(&_energy_mux);
+    _energy.setLoaded(counters);
+    portEXIT_CRITICAL(&_energy_mux);
+
+    return true;
+}
+
+bool DomDomChannelClass::startCalibration()
+{
+    if (!_iniciado)
+    {
+        return false;
+    }
+
+    _calibrating = true;
+    return true;
+}
+
+void DomDomChannelClass::stopCalibration()
+{
+    _calibrating = false;
+}
+
+bool DomDomChannelClass::saveCalibration()
+{
+    int address = getControlEEPROMAddress() + EEPROM_CHANNEL_CONTROL_SIZE;
+    EEPROM.writeBool(address, calibration.isValid());
+    address += 1;
+    EEPROM.write(address, calibration.lastDac());
+    address += 1;
+
+    for (int i = 0; i < CALIBRATION_TABLE_SIZE; i++)
+    {
+        EEPROM.writeUShort(address, calibration.mA[i]);
+        address += 2;
+        EEPROM.writeUShort(address, calibration.mV[i]);
+        address += 2;
+    }
+
+    bool result = EEPROM.commit();
+    if (result)
+    {
+        calibration.setSaved();
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, tag.c_str(), "Calibracion guardada en EEPROM");
+    }
+
+    return result;
+}
+
+bool DomDomChannelClass::loadCalibration()
+{
+    int address = getControlEEPROMAddress() + EEPROM_CHANNEL_CONTROL_SIZE;
+
+    // Cualquier valor distinto de 1 (p.e. una EEPROM sin inicializar) invalida la tabla
+    if (EEPROM.read(address) != 1)
+    {
+        calibration.clear();
+        return false;
+    }
+    address += 1;
+    uint8_t last_dac = EEPROM.read(address);
+    address += 1;
+
+    for (int i = 0; i < CALIBRATION_TABLE_SIZE; i++)
+    {
+        calibration.mA[i] = EEPROM.readUShort(address);
+        address += 2;
+        calibration.mV[i] = EEPROM.readUShort(address);
+        address += 2;
+    }
+
+    calibration.setLoaded(true, last_dac);
+    return true;
 }
 
 bool DomDomChannelClass::setEnabled(bool enabled)
@@ -220,16 +853,17 @@ bool DomDomChannelClass::setEnabled(bool enabled)
     {
         _enabled = enabled;
 
+        // El INA comparte el bus con el resto de canales, lo para la tarea de control
         if (_iniciado && !enabled)
         {
-            end();
+            _end_pending = true;
         }
     }
 
     return true;
 }
 
-bool DomDomChannelClass::setTargetmA(float value)
+bool DomDomChannelClass::setTargetmA(float value, uint32_t duration_ms)
 {
     if (!_enabled && value != 0)
     {
@@ -248,13 +882,33 @@ bool DomDomChannelClass::setTargetmA(float value)
         DomDomLogger.log(DomDomLoggerClass::LogLevel::warn, tag.c_str(), "El valor PWM es mayor que el maximo. Valor cambiado a %f", value);
     }
 
+    portENTER_CRITICAL(&_ramp_mux);
+    _ramp_from_mA = _setpoint_mA;
+    _ramp_start_ms = millis();
+    _ramp_duration_ms = duration_ms;
     target_mA = value;
+    portEXIT_CRITICAL(&_ramp_mux);
 
-    DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, tag.c_str(), "Target mA: %f", value);
+    DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, tag.c_str(), "Target mA: %f (%u ms)", value, duration_ms);
 
     return true;
 }
 
+float DomDomChannelClass::percentTomA(float percent) const
+{
+    return minimum_mA + (maximum_mA - minimum_mA) * DomDomBrightness::apply(brightness_curve, percent);
+}
+
+float DomDomChannelClass::fixedPercentTomA(uint32_t percent) const
+{
+    return minimum_mA + (maximum_mA - minimum_mA) * DomDomBrightness::applyFixed(brightness_curve, percent) / UINT16_MAX;
+}
+
+bool DomDomChannelClass::setTargetPercent(float percent, uint32_t duration_ms)
+{
+    return setTargetmA(percentTomA(percent), duration_ms);
+}
+
 bool DomDomChannelClass::started()
 {
     return _iniciado;
@@ -284,7 +938,7 @@ bool DomDomChannelClass::save()
         EEPROM.write(address, leds.size());
         address++;
 
-        for (int i = 0; i < leds.size(); i++)
+        for (size_t i = 0; i < leds.size(); i++)
         {
             EEPROM.writeUShort(address, leds[i]->K);
             address += 2;
@@ -296,6 +950,15 @@ bool DomDomChannelClass::save()
         }
     }
 
+    address = getControlEEPROMAddress();
+    EEPROM.writeFloat(address, controller.kp);
+    address += 4;
+    EEPROM.writeFloat(address, controller.ki);
+    address += 4;
+    EEPROM.write(address, brightness_curve);
+    address += 1;
+    EEPROM.writeFloat(address, max_slew_mA_s);
+
     bool result = EEPROM.commit();
 
     if (result)
@@ -308,12 +971,15 @@ bool DomDomChannelClass::save()
 
 bool DomDomChannelClass::loadFromEEPROM()
 {
-    bool started = DomDomChannel.started();
+    bool started = this->started();
     if (started)
     {
         end();
     }
 
+    // Los contadores de energia no dependen de la configuracion del canal
+    loadEnergy();
+
     int address = getFirstEEPROMAddress();
 
     if (EEPROM.read(address) == (_channel_num+1))
@@ -350,6 +1016,27 @@ bool DomDomChannelClass::loadFromEEPROM()
             leds.push_back(led);
         }
 
+        address = getControlEEPROMAddress();
+        float kp = EEPROM.readFloat(address);
+        address += 4;
+        float ki = EEPROM.readFloat(address);
+        address += 4;
+        uint8_t curve = EEPROM.read(address);
+        address += 1;
+        float slew = EEPROM.readFloat(address);
+
+        // Las versiones anteriores no guardaban las ganancias
+        if (DomDomCurrentController::validGains(kp, ki))
+        {
+            controller.kp = kp;
+            controller.ki = ki;
+        }
+
+        brightness_curve = curve < CURVE_COUNT ? curve : CHANNEL_BRIGHTNESS_CURVE;
+        max_slew_mA_s = !isnan(slew) && slew >= 0 && slew <= CHANNEL_RAMP_MAX_SLEW_LIMIT ? slew : CHANNEL_RAMP_MAX_SLEW;
+
+        loadCalibration();
+
         DomDomLogger.log(DomDomLoggerClass::LogLevel::info, tag.c_str(), "Cargando configuracion desde EEPROM...OK!");
         
     } else {
@@ -368,9 +1055,21 @@ bool DomDomChannelClass::loadFromEEPROM()
 
 int DomDomChannelClass::getFirstEEPROMAddress()
 {
-    return EEPROM_CHANNEL_FIRST_ADDRESS;
+    // El primer canal mantiene su posicion original, el resto van al final de la memoria
+    if (_channel_num == 0)
+    {
+        return EEPROM_CHANNEL_FIRST_ADDRESS;
+    }
+
+    return EEPROM_CHANNEL_EXTRA_ADDRESS + (_channel_num - 1) * EEPROM_CHANNEL_SLOT_SIZE;
 }
 
-#if !defined(NO_GLOBAL_INSTANCES)
-DomDomChannelClass DomDomChannel;
-#endif
\ No newline at end of file
+int DomDomChannelClass::getControlEEPROMAddress()
+{
+    return EEPROM_CHANNEL_CONTROL_ADDRESS + _channel_num * EEPROM_CHANNEL_CONTROL_BLOCK_SIZE;
+}
+
+int DomDomChannelClass::getEnergyEEPROMAddress()
+{
+    return EEPROM_CHANNEL_ENERGY_ADDRESS + _channel_num * EEPROM_CHANNEL_ENERGY_SIZE;
+}
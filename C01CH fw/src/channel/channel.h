@@ -24,6 +24,15 @@
 
 #include <Arduino.h>
 #include "channelLed.h"
+#include "currentController.h"
+#include "calibrationTable.h"
+#include "telemetry.h"
+#include "history.h"
+#include "energyMeter.h"
+#include "dacOutput.h"
+#include "brightnessCurve.h"
+#include "loopTiming.h"
+#include "weather.h"
 #include "../../lib/INA/INA.h"
 
 /**
@@ -49,10 +58,190 @@ class DomDomChannelClass
          * Indica si el canal se esta controlando
          */
         bool _iniciado;
+        /**
+         * Indica si hay un barrido de calibracion en curso
+         */
+        bool _calibrating;
         /**
          * Direccion I2C del dispositivo INA asociado a este canal
          */
         uint8_t _INA_address;
+        /**
+         * Pin conectado a la salida ALERT del INA (-1 si no esta conectado)
+         */
+        int8_t _alert_pin;
+        /**
+         * Indica si el INA avisa del fin de conversion por el pin de alerta
+         */
+        bool _alert_enabled;
+        /**
+         * Indica si el pin de alerta del INA avisa del limite de sobrecorriente. En ese caso el
+         * fin de conversion se consulta por I2C
+         */
+        bool _trip_enabled;
+        /**
+         * Corriente maxima para la que se programo el limite del INA
+         */
+        float _trip_limit_mA;
+        /**
+         * Causa del disparo de la proteccion. Queda enclavada hasta rearmar el canal
+         */
+        volatile uint8_t _trip;
+        /**
+         * Indica que hay que rearmar la proteccion en la siguiente iteracion
+         */
+        volatile bool _trip_reset;
+        /**
+         * Indica que la interrupcion ha marcado el fin de una conversion
+         */
+        volatile bool _conversion_ready;
+        /**
+         * Tarea de control de corriente, recibe las notificaciones de la interrupcion
+         */
+        TaskHandle_t _task_handle;
+        /**
+         * Sensores INA compartidos en el bus I2C
+         */
+        INA_Class *_INA;
+        /**
+         * Numero de dispositivos INA encontrados en el bus
+         */
+        uint8_t _INA_devices;
+        /**
+         * Indica que hay que reiniciar el estado del control en la siguiente iteracion
+         */
+        bool _control_reset;
+        /**
+         * Indica que la tarea de control debe parar el canal en la siguiente iteracion
+         */
+        volatile bool _end_pending;
+        /**
+         * Codigo DAC (con decimales) escrito en la iteracion actual y en la anterior
+         */
+        float _curr_dac, _prev_dac;
+        /**
+         * Objetivo para el que se calculo la salida actual
+         */
+        float _prev_targetmA;
+        /**
+         * Consigna actual de la rampa hacia target_mA
+         */
+        float _setpoint_mA;
+        /**
+         * Consigna del control: la de la rampa con el efecto de nubes y rayos
+         */
+        float _goal_mA;
+        /**
+         * Tramo de rampa en curso: parte de @_ramp_from_mA en @_ramp_start_ms
+         * y llega a target_mA tras @_ramp_duration_ms
+         */
+        float _ramp_from_mA;
+        unsigned long _ramp_start_ms;
+        uint32_t _ramp_duration_ms;
+        /**
+         * Protege el tramo de rampa entre la tarea de control y el resto
+         */
+        portMUX_TYPE _ramp_mux = portMUX_INITIALIZER_UNLOCKED;
+        /**
+         * Indica si el INA usa el promedio y la conversion rapidos
+         */
+        bool _fast_mode;
+        /**
+         * Lecturas estables seguidas
+         */
+        uint16_t _stable_samples;
+        /**
+         * Marca de tiempo de la ultima iteracion del control
+         */
+        unsigned long _last_ms;
+        /**
+         * Marca de tiempo del ultimo guardado de la tabla de calibracion
+         */
+        unsigned long _last_calibration_save_ms;
+        /**
+         * Lecturas de la iteracion actual, solo las modifica la tarea de control
+         */
+        DomDomChannelReading _reading;
+        /**
+         * Ultimas lecturas publicadas para el resto de tareas
+         */
+        DomDomSeqLock<DomDomChannelReading> _telemetry;
+        /**
+         * Indica que hay que poner a cero los maximos en la siguiente iteracion
+         */
+        volatile bool _reset_peaks;
+        /**
+         * Historico de potencia del canal
+         */
+        DomDomPowerHistory _history;
+        /**
+         * Protege el historico entre la tarea de control y las consultas
+         */
+        portMUX_TYPE _history_mux = portMUX_INITIALIZER_UNLOCKED;
+        /**
+         * Contador de energia del canal
+         */
+        DomDomEnergyMeter _energy;
+        /**
+         * Periodo (hora, dia y mes) del segundo @_energy_time. Se calcula fuera de la
+         * seccion critica y solo una vez por segundo
+         */
+        DomDomEnergyPeriod _energy_period;
+        time_t _energy_time = 0;
+        /**
+         * Protege los contadores de energia entre la tarea de control y las consultas
+         */
+        portMUX_TYPE _energy_mux = portMUX_INITIALIZER_UNLOCKED;
+        /**
+         * Tiempos de las iteraciones del control
+         */
+        DomDomLoopTiming _timing;
+        /**
+         * Protege los tiempos entre la tarea de control y las consultas
+         */
+        portMUX_TYPE _timing_mux = portMUX_INITIALIZER_UNLOCKED;
+        /**
+         * Indica que hay que borrar los tiempos en la siguiente iteracion
+         */
+        volatile bool _reset_timing;
+        /**
+         * Publica las lecturas de la iteracion actual
+         */
+        void publishReading();
+        /**
+         * Reinicia el estado del control y deja la salida al minimo
+         */
+        void controlReset();
+        /**
+         * Avanza la consigna de la rampa. Devuelve verdadero si todavia no ha llegado al objetivo.
+         */
+        bool rampStep(unsigned long now_ms, float dt_s);
+        /**
+         * Configura el promedio y el tiempo de conversion del INA en modo rapido o lento
+         */
+        void setFastMode(bool fast);
+        /**
+         * Configura el pin de alerta del INA para el limite de sobrecorriente si esta activa
+         * la proteccion, o si no para avisar del fin de conversion
+         */
+        void beginAlert();
+        /**
+         * Programa en el INA el limite de sobrecorriente a partir de maximum_mA
+         */
+        bool setTripLimit();
+        /**
+         * Interrupcion del pin de alerta del INA por el limite de sobrecorriente. Lleva la
+         * salida al extremo seguro y enclava el disparo sin esperar a la tarea de control
+         */
+        static void tripAlertISR(void *arg);
+        /**
+         * Interrupcion del pin de alerta del INA por fin de conversion
+         */
+        static void conversionAlertISR(void *arg);
+        /**
+         * Lleva la salida al extremo seguro y enclava el disparo con la causa @reason
+         */
+        void trip(DomDomChannelTrip reason);
         /**
          * Guarda el valor PWM actual en memoria.
          */
@@ -62,43 +251,82 @@ class DomDomChannelClass
          */
         int getFirstEEPROMAddress();
         /**
-         * Tarea para mantener la limitacion de corriente en el canal
+         * Devuelve la direccion de memoria de las ganancias y la calibracion de este canal
+         */
+        int getControlEEPROMAddress();
+        /**
+         * Devuelve la direccion de memoria de los contadores de energia de este canal
          */
-        static void limitCurrentTask(void * parameter);
+        int getEnergyEEPROMAddress();
+        /**
+         * Recorre todos los codigos DAC sobre el pin @pin y rellena la tabla de calibracion
+         */
+        void calibrationSweep(int pin);
 
     public:
         /**
          * Constructor
          */
-        DomDomChannelClass(uint8_t INA_address, uint8_t channel = 0);
-        /**
-         * Sensor de corriente
-         */
-        INA_Class INA;
+        DomDomChannelClass(uint8_t INA_address = 0x40, uint8_t channel = 0);
         /**
          * Indice de dispositivo INA correspondiente a este canal
          */
         uint8_t INA_device_index;
         /**
-         * Ultimo voltaje leido en el bus
+         * Devuelve una copia coherente de las ultimas lecturas del canal.
+         * Se puede llamar desde cualquier tarea.
          */
-        float lastBusVoltaje_V = 0;
+        DomDomChannelReading reading() const { return _telemetry.read(); };
         /**
-         * Voltaje maximo detectado en el bus
+         * Numero de intervalos guardados en el nivel @type del historico.
          */
-        float busVoltagePeak_V = 0;
+        uint16_t historyCount(DomDomHistoryTierType type);
         /**
-         * Ultima corriente leida en el bbus
+         * Posicion del primer intervalo del nivel @type que termina despues de @time.
          */
-        float lastBusCurrent_mA = 0;
+        uint16_t historyIndexOf(DomDomHistoryTierType type, uint32_t time);
         /**
-         * Corriente máxima detectada
+         * Copia el intervalo @index (0 es el mas antiguo) del nivel @type del historico.
          */
-        float busCurrentPeak_mA = 0;
+        bool historyBucket(DomDomHistoryTierType type, uint16_t index, uint32_t &time, DomDomHistoryBucket &bucket);
         /**
-         * Potencia máxima detectada
+         * Copia la muestra sin agrupar @index (0 es la mas antigua) del historico.
          */
-        float busPowerPeak_W = 0;
+        bool historyRaw(uint16_t index, DomDomHistorySample &sample);
+        /**
+         * Devuelve una copia de los contadores de energia del canal.
+         */
+        DomDomEnergyCounters energy();
+        /**
+         * Escribe los contadores de energia en memoria si han cambiado.
+         * Con @commit falso no se confirma la escritura, para agrupar
+         * la de todos los canales en un unico commit.
+         */
+        bool saveEnergy(bool commit = true);
+        /**
+         * Carga los contadores de energia guardados en memoria.
+         */
+        bool loadEnergy();
+        /**
+         * Devuelve la causa del disparo de la proteccion (TRIP_NONE si no ha saltado).
+         */
+        uint8_t tripped() const { return _trip; };
+        /**
+         * Rearma la proteccion en la siguiente iteracion del control.
+         */
+        void resetTrip() { _trip_reset = true; };
+        /**
+         * Pone a cero los valores maximos en la siguiente lectura.
+         */
+        void resetPeaks() { _reset_peaks = true; };
+        /**
+         * Devuelve una copia de los tiempos del bucle de control.
+         */
+        DomDomLoopStats timing();
+        /**
+         * Borra los tiempos del bucle de control en la siguiente iteracion.
+         */
+        void resetTiming() { _reset_timing = true; };
         /**
          * Indica si se esta controlando el canal
          */
@@ -116,21 +344,30 @@ class DomDomChannelClass
          */
         float minimum_mA;
         /**
-         * Voltaje maximo para el canal
+         * Voltaje maximo para el canal. La proteccion por sobretension es solo por software,
+         * se comprueba en la tarea de control tras cada conversion
          */
         float maximum_V;
         /**
          * Corriente objetivo
          */
         float target_mA;
+        /**
+         * Curva (DomDomBrightnessCurve) para convertir porcentajes en corriente
+         */
+        uint8_t brightness_curve;
         /**
          * Pin de salida de este canal
          */
         uint8_t dac_pwm_pin;
         /**
-         * PWM actual para la salida DAC
+         * Controlador de corriente que calcula el codigo DAC
          */
-        uint8_t curr_dac_pwm;
+        DomDomCurrentController controller;
+        /**
+         * Tabla de calibracion DAC -> mA del canal
+         */
+        DomDomCalibrationTable calibration;
         /**
          * Indica si la corriente de salida se encuentra estable
          */
@@ -144,21 +381,48 @@ class DomDomChannelClass
          */
         bool getEnabled() const {return _enabled; };
         /**
-         * Configura el canal.
+         * Configura el canal usando los INA encontrados en el bus. Debe llamarse sin la
+         * tarea de control en marcha, que es la unica que usa el bus despues.
+         */
+        bool begin(INA_Class &ina, uint8_t devicesFound);
+        /**
+         * Vuelve a configurar el canal con los ultimos INA recibidos.
          */
         bool begin();
+        /**
+         * Tarea de control que da servicio al canal y recibe los avisos de la interrupcion.
+         */
+        void setTask(TaskHandle_t task) { _task_handle = task; };
         /**
          * Quita la configuracion del canal.
          */
         bool end();
         /**
-         * Establece el estado actual del canal.
+         * Establece el estado actual del canal. Al deshabilitarlo la tarea de control
+         * lo para en su siguiente iteracion.
          */
         bool setEnabled(bool enabled);
         /**
-         * Establece los mA objetivo
+         * Pendiente maxima de la consigna en mA/s (0 sin limite)
+         */
+        float max_slew_mA_s;
+        /**
+         * Establece los mA objetivo. La consigna llega a @value de forma lineal
+         * en @duration_ms, y nunca mas rapido que max_slew_mA_s.
+         */
+        bool setTargetmA(float value, uint32_t duration_ms = 0);
+        /**
+         * Devuelve la corriente para el porcentaje de brillo @percent segun la curva del canal.
+         */
+        float percentTomA(float percent) const;
+        /**
+         * Igual que percentTomA() con el porcentaje en coma fija Q16 (1% = 65536).
          */
-        bool setTargetmA(float value);
+        float fixedPercentTomA(uint32_t percent) const;
+        /**
+         * Establece la corriente objetivo a partir del porcentaje de brillo @percent.
+         */
+        bool setTargetPercent(float percent, uint32_t duration_ms = 0);
         /**
          * Guarda la configuracion actual del canal en memoria.
          */
@@ -168,14 +432,40 @@ class DomDomChannelClass
          * almacenada en memoria para este canal.
          */
         bool loadFromEEPROM();
+        /**
+         * Inicia un barrido de calibracion de la tabla DAC -> mA.
+         */
+        bool startCalibration();
+        /**
+         * Cancela el barrido de calibracion en curso.
+         */
+        void stopCalibration();
+        /**
+         * Indica si hay un barrido de calibracion en curso.
+         */
+        bool calibrating() const { return _calibrating; };
+        /**
+         * Guarda la tabla de calibracion en memoria.
+         */
+        bool saveCalibration();
+        /**
+         * Carga la tabla de calibracion guardada en memoria.
+         */
+        bool loadCalibration();
+        /**
+         * Ejecuta una iteracion del control de corriente. La llama la tarea
+         * de control para cada canal iniciado con el efecto de nubes y rayos
+         * @weather del instante actual.
+         */
+        void controlStep(const DomDomWeatherSample &weather = DomDomWeatherSample());
+        /**
+         * Bloquea la tarea actual hasta que el INA termine la conversion en curso.
+         */
+        void waitForConversion();
         /**
          * Devuelve el tag para el log de este canal
          */
         String tag;
 };
 
-#if !defined(NO_GLOBAL_INSTANCES)
-extern DomDomChannelClass DomDomChannel;
-#endif
-
 #endif /* DOMDOM_CHANNEL_h */
\ No newline at end of file
@@ -0,0 +1,264 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "channelMgt.h"
+#include <EEPROM.h>
+#include "../log/logger.h"
+
+DomDomChannelMgtClass::DomDomChannelMgtClass()
+{
+    uint8_t INA_addresses[CHANNEL_SIZE] = CHANNEL_INA_ADDRESS;
+    for (uint8_t i = 0; i < CHANNEL_SIZE; i++)
+    {
+        channels[i] = new DomDomChannelClass(INA_addresses[i], i);
+    }
+}
+
+DomDomChannelClass *DomDomChannelMgtClass::getChannel(uint8_t num)
+{
+    return num < CHANNEL_SIZE ? channels[num] : nullptr;
+}
+
+bool DomDomChannelMgtClass::begin()
+{
+    DomDomLogger.log(DomDomLoggerClass::LogLevel::info, "CHANNELS", "Iniciando canales...");
+
+    // Iniciamos los INA
+    INA._EEPROM_offset = EEPROM_SIZE;
+    INA._EEPROM_size = EEPROM_INA_SIZE;
+    uint8_t devicesFound = 0;
+    uint8_t max_retries = 3;
+    uint8_t retry = 0;
+
+    do
+    {
+        devicesFound = INA.begin(CHANNEL_INA_MAXIMUM_AMPS, CHANNEL_SHUNT_MICRO_OHM);
+        retry++;
+
+    }while (devicesFound < CHANNEL_SIZE && retry < max_retries);
+
+    DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, "CHANNELS", "Encontrados %d INA", devicesFound);
+
+    // Salida DAC con decimales comun a todos los canales
+    DomDomDacOutput.begin();
+
+    // Configuramos todos los INA antes de arrancar la tarea de control, que despues
+    // es la unica que usa el bus
+    bool result = false;
+    for (uint8_t i = 0; i < CHANNEL_SIZE; i++)
+    {
+        // Basta con que un canal arranque para mantener la tarea
+        result = channels[i]->begin(INA, devicesFound) || result;
+    }
+
+    if (!_task.running())
+    {
+        _task.start(controlTask, "Current_Task", 10000, this);
+    }
+
+    DomDomLogger.log(DomDomLoggerClass::LogLevel::info, "CHANNELS", result ? "Iniciando canales...OK!" : "Iniciando canales...ERROR!");
+    return result;
+}
+
+bool DomDomChannelMgtClass::end()
+{
+    // Esperamos a que la tarea termine el paso en curso antes de tocar los canales
+    bool result = _task.stop();
+    if (!result)
+    {
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::error, "CHANNELS", "La tarea de control no ha terminado");
+    }
+
+    for (uint8_t i = 0; i < CHANNEL_SIZE; i++)
+    {
+        channels[i]->end();
+    }
+
+    // No perdemos la energia acumulada desde el ultimo guardado
+    saveEnergy();
+
+    return result;
+}
+
+bool DomDomChannelMgtClass::saveEnergy()
+{
+    for (uint8_t i = 0; i < CHANNEL_SIZE; i++)
+    {
+        channels[i]->saveEnergy(false);
+    }
+
+    // Si ningun canal ha cambiado el commit no llega a escribir la flash
+    _last_energy_save_ms = millis();
+    bool result = EEPROM.commit();
+
+    DomDomLogger.log(DomDomLoggerClass::LogLevel::debug, "CHANNELS", "Contadores de energia guardados en EEPROM");
+    return result;
+}
+
+bool DomDomChannelMgtClass::loadFromEEPROM()
+{
+    bool result = true;
+    for (uint8_t i = 0; i < CHANNEL_SIZE; i++)
+    {
+        result = channels[i]->loadFromEEPROM() && result;
+    }
+
+    // Si el efecto no se ha guardado nunca nos quedamos con los valores por defecto
+    DomDomWeatherSettings settings;
+    int address = EEPROM_WEATHER_ADDRESS;
+    uint8_t enabled = EEPROM.read(address);
+    address += 1;
+    uint32_t seed = EEPROM.readULong(address);
+    address += 4;
+    uint16_t clouds = EEPROM.readUShort(address);
+    address += 2;
+    uint8_t depth = EEPROM.read(address);
+    address += 1;
+    uint16_t cloud_min = EEPROM.readUShort(address);
+    address += 2;
+    uint16_t cloud_max = EEPROM.readUShort(address);
+    address += 2;
+    uint16_t flashes = EEPROM.readUShort(address);
+    address += 2;
+    uint8_t intensity = EEPROM.read(address);
+    if (enabled <= 1 && depth <= 100 && intensity <= 100 && cloud_min <= cloud_max && clouds <= 3600 && flashes <= 3600)
+    {
+        settings.enabled = enabled;
+        settings.seed = seed;
+        settings.clouds_per_hour = clouds;
+        settings.cloud_depth = depth;
+        settings.cloud_min_s = cloud_min;
+        settings.cloud_max_s = cloud_max;
+        settings.flashes_per_hour = flashes;
+        settings.flash_intensity = intensity;
+    }
+    setWeather(settings);
+
+    return result;
+}
+
+void DomDomChannelMgtClass::setWeather(const DomDomWeatherSettings &settings)
+{
+    portENTER_CRITICAL(&_weather_mux);
+    _weather_settings = settings;
+    _weather_pending = true;
+    portEXIT_CRITICAL(&_weather_mux);
+}
+
+DomDomWeatherSettings DomDomChannelMgtClass::weather()
+{
+    portENTER_CRITICAL(&_weather_mux);
+    DomDomWeatherSettings settings = _weather_settings;
+    portEXIT_CRITICAL(&_weather_mux);
+
+    return settings;
+}
+
+bool DomDomChannelMgtClass::saveWeather()
+{
+    DomDomWeatherSettings settings = weather();
+
+    int address = EEPROM_WEATHER_ADDRESS;
+    EEPROM.writeBool(address, settings.enabled);
+    address += 1;
+    EEPROM.writeULong(address, settings.seed);
+    address += 4;
+    EEPROM.writeUShort(address, settings.clouds_per_hour);
+    address += 2;
+    EEPROM.write(address, settings.cloud_depth);
+    address += 1;
+    EEPROM.writeUShort(address, settings.cloud_min_s);
+    address += 2;
+    EEPROM.writeUShort(address, settings.cloud_max_s);
+    address += 2;
+    EEPROM.writeUShort(address, settings.flashes_per_hour);
+    address += 2;
+    EEPROM.write(address, settings.flash_intensity);
+
+    bool result = EEPROM.commit();
+    if (result)
+    {
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::info, "CHANNELS", "Guardando efecto de nubes y rayos...OK!");
+    }
+    else
+    {
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::error, "CHANNELS", "Guardando efecto de nubes y rayos...ERROR!");
+    }
+
+    return result;
+}
+
+void DomDomChannelMgtClass::controlTask(void *parameter)
+{
+    DomDomChannelMgtClass *mgt = (DomDomChannelMgtClass *)parameter;
+
+    // Las interrupciones de los canales avisan a esta tarea
+    for (uint8_t i = 0; i < CHANNEL_SIZE; i++)
+    {
+        mgt->channels[i]->setTask(xTaskGetCurrentTaskHandle());
+    }
+
+    while(mgt->_task.running())
+    {
+        bool any = false;
+
+        // La configuracion del efecto solo se toca desde esta tarea
+        portENTER_CRITICAL(&mgt->_weather_mux);
+        bool pending = mgt->_weather_pending;
+        DomDomWeatherSettings settings = mgt->_weather_settings;
+        mgt->_weather_pending = false;
+        portEXIT_CRITICAL(&mgt->_weather_mux);
+
+        if (pending)
+        {
+            mgt->_weather.configure(settings, millis());
+        }
+
+        // Todos los canales ven la misma nube o el mismo rayo en cada vuelta
+        DomDomWeatherSample weather = mgt->_weather.sample(millis());
+
+        // Damos servicio por turnos a todos los canales iniciados
+        for (uint8_t i = 0; i < CHANNEL_SIZE; i++)
+        {
+            if (mgt->channels[i]->started())
+            {
+                mgt->channels[i]->controlStep(weather);
+                any = true;
+            }
+        }
+
+        if (!any)
+        {
+            mgt->_task.sleep(100);
+        }
+
+        // Agrupamos la escritura de todos los canales para no desgastar la flash
+        if (millis() - mgt->_last_energy_save_ms >= CHANNEL_ENERGY_SAVE_INTERVAL)
+        {
+            mgt->saveEnergy();
+        }
+    }
+
+    mgt->_task.finish();
+}
+
+#if !defined(NO_GLOBAL_INSTANCES)
+DomDomChannelMgtClass DomDomChannelMgt;
+#endif
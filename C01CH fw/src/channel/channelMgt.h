@@ -0,0 +1,126 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+#ifndef DOMDOM_CHANNELMGT_h
+#define DOMDOM_CHANNELMGT_h
+
+#include <Arduino.h>
+#include "configuration.h"
+#include "channel.h"
+#include "weather.h"
+#include "../task/managedTask.h"
+#include "../../lib/INA/INA.h"
+
+/**
+ * Clase encargada de los canales.
+ * 
+ * Contiene los CHANNEL_SIZE canales del equipo y los INA
+ * compartidos en el bus I2C. Una unica tarea de control
+ * recorre todos los canales iniciados por turnos, de forma
+ * que el uso de CPU y del bus crece de forma lineal con
+ * el numero de canales.
+ */
+class DomDomChannelMgtClass
+{
+    private:
+        /**
+         * Tarea de control comun a todos los canales.
+         */
+        DomDomManagedTask _task;
+        /**
+         * Marca de tiempo del ultimo guardado de los contadores de energia
+         */
+        unsigned long _last_energy_save_ms = 0;
+        /**
+         * Generador de nubes y rayos comun a todos los canales. Solo lo usa la tarea de control.
+         */
+        DomDomWeather _weather;
+        /**
+         * Configuracion del efecto pendiente de aplicar en la tarea de control
+         */
+        DomDomWeatherSettings _weather_settings;
+        bool _weather_pending = false;
+        /**
+         * Protege la configuracion pendiente entre la tarea de control y el resto
+         */
+        portMUX_TYPE _weather_mux = portMUX_INITIALIZER_UNLOCKED;
+        /**
+         * Tarea de control de corriente. Recibe el objeto como parametro.
+         */
+        static void controlTask(void * parameter);
+
+    public:
+        /**
+         * Constructor.
+         */
+        DomDomChannelMgtClass();
+        /**
+         * Sensores de corriente de todos los canales
+         */
+        INA_Class INA;
+        /**
+         * Canales del equipo
+         */
+        DomDomChannelClass *channels[CHANNEL_SIZE];
+        /**
+         * Busca los INA en el bus, configura los canales e inicia la tarea de control.
+         */
+        bool begin();
+        /**
+         * Para la tarea de control, esperando a que termine, y todos los canales.
+         */
+        bool end();
+        /**
+         * Indica si la tarea de control esta en marcha.
+         */
+        bool isStarted() const { return _task.running(); };
+        /**
+         * Guarda los contadores de energia de todos los canales con un unico commit.
+         */
+        bool saveEnergy();
+        /**
+         * Carga la configuracion de todos los canales desde la memoria.
+         */
+        bool loadFromEEPROM();
+        /**
+         * Cambia la configuracion del efecto de nubes y rayos. Se aplica en la
+         * siguiente vuelta de la tarea de control, empezando la secuencia de la semilla.
+         */
+        void setWeather(const DomDomWeatherSettings &settings);
+        /**
+         * Configuracion actual del efecto de nubes y rayos
+         */
+        DomDomWeatherSettings weather();
+        /**
+         * Guarda la configuracion del efecto de nubes y rayos en la memoria.
+         */
+        bool saveWeather();
+        /**
+         * Devuelve el canal @num o nullptr si no existe.
+         */
+        DomDomChannelClass *getChannel(uint8_t num);
+};
+
+#if !defined(NO_GLOBAL_INSTANCES)
+extern DomDomChannelMgtClass DomDomChannelMgt;
+#endif
+
+#endif /* DOMDOM_CHANNELMGT_h */
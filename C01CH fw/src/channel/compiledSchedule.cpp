@@ -0,0 +1,89 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "compiledSchedule.h"
+
+void DomDomCompiledSchedule::clear()
+{
+    points.clear();
+    timeline.clear();
+}
+
+bool DomDomCompiledSchedule::add(const DomDomSchedulePoint &point)
+{
+    if (points.full() || point.hour > 23 || point.minute > 59)
+    {
+        return false;
+    }
+
+    points.add(point);
+    timeline.add(point.hour * 60 + point.minute, point.dayOfWeek, points.size() - 1);
+
+    return true;
+}
+
+void DomDomCompiledSchedule::compile()
+{
+    for (uint8_t day = 0; day < SCHEDULE_DAYS_PER_WEEK; day++)
+    {
+        for (uint8_t position = 0; position < timeline.dayCount(day); position++)
+        {
+            DomDomTimelineEntry &entry = timeline.entry(day, position);
+            const DomDomTimelineEntry *before, *after;
+            int32_t at_before, at_after;
+
+            // El anterior es el ultimo punto estrictamente antes de este minuto
+            bool found = entry.minute > 0 ?
+                timeline.previous(day, entry.minute - 1, before, at_before) :
+                timeline.previous(day + SCHEDULE_DAYS_PER_WEEK - 1, SCHEDULE_MINUTES_PER_DAY - 1, before, at_before);
+            at_before -= entry.minute > 0 ? 0 : SCHEDULE_MINUTES_PER_DAY;
+
+            found = found && timeline.next(day, entry.minute, after, at_after);
+
+            for (int c = 0; c < CHANNEL_SIZE; c++)
+            {
+                entry.slope[c] = !found ? 0 : DomDomFade::monotoneSlope(
+                    points[before->point].value[c], entry.minute - at_before,
+                    points[entry.point].value[c],
+                    points[after->point].value[c], at_after - entry.minute);
+            }
+        }
+    }
+}
+
+bool DomDomCompiledSchedule::find(const DateTime &now, DateTime &dt, const DomDomTimelineEntry *&entry, bool previous) const
+{
+    uint16_t minute = now.hour() * 60 + now.minute();
+    int32_t at;
+
+    uint8_t day = now.dayOfTheWeek();
+    bool found = previous ? timeline.previous(day, minute, entry, at) : timeline.next(day, minute, entry, at);
+    if (!found || entry->point >= points.size())
+    {
+        return false;
+    }
+
+    // El minuto del punto se cuenta desde el inicio del dia de hoy
+    DateTime today(now.year(), now.month(), now.day(), 0, 0, 0);
+    dt = today + TimeSpan(at * 60);
+
+    return true;
+}
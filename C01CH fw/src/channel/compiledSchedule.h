@@ -0,0 +1,74 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_COMPILEDSCHEDULE_h
+#define DOMDOM_COMPILEDSCHEDULE_h
+
+#include <RTClib.h>
+#include "schedulePoint.h"
+#include "scheduleTimeline.h"
+#include "doubleBuffer.h"
+
+/**
+ * Programacion completa: los puntos y su linea de tiempo con las
+ * pendientes de los fundidos ya calculadas.
+ *
+ * El programador la prepara fuera de la que esta en uso y la publica
+ * de golpe, despues solo se lee.
+ */
+class DomDomCompiledSchedule
+{
+    public:
+        /**
+         * Puntos de programacion en el orden en el que se añadieron
+         */
+        DomDomSchedulePointList points;
+        /**
+         * Puntos ordenados por hora para cada dia de la semana
+         */
+        DomDomScheduleTimeline timeline;
+        /**
+         * Borra todos los puntos.
+         */
+        void clear();
+        /**
+         * Añade @point. Devuelve falso si no caben mas puntos o su hora no es valida.
+         */
+        bool add(const DomDomSchedulePoint &point);
+        /**
+         * Calcula las pendientes de los fundidos FADE_CURVE_SPLINE de cada punto
+         * de la linea de tiempo a partir de sus vecinos. Se llama antes de publicar.
+         */
+        void compile();
+        /**
+         * Busca en la linea de tiempo el punto anterior (@previous) o siguiente al
+         * instante @now y devuelve en @entry su entrada y en @dt su hora.
+         */
+        bool find(const DateTime &now, DateTime &dt, const DomDomTimelineEntry *&entry, bool previous) const;
+};
+
+/**
+ * Lectura de la programacion publicada
+ */
+typedef DomDomDoubleBuffer<DomDomCompiledSchedule>::Reader DomDomScheduleReader;
+
+#endif /* DOMDOM_COMPILEDSCHEDULE_h */
@@ -0,0 +1,169 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "configuration.h"
+#include "currentController.h"
+#include <math.h>
+
+// Peso minimo acumulado para considerar que el modelo es valido
+const float MIN_MODEL_WEIGHT    = 2.0f;
+// Varianza minima en los codigos DAC para poder calcular la pendiente
+const float MIN_MODEL_VARIANCE  = 4.0f;
+// Desviaciones de las lecturas aprendidas hasta las que extrapolamos la recta
+const float MAX_MODEL_REACH     = 2.0f;
+
+DomDomCurrentController::DomDomCurrentController()
+{
+    kp = CHANNEL_CONTROL_KP;
+    ki = CHANNEL_CONTROL_KI;
+    output_min = 0;
+    output_max = 255;
+    forgetting = 0.95f;
+
+    forget();
+    reset(output_max);
+}
+
+void DomDomCurrentController::reset(float output)
+{
+    _base = output;
+    _output = output;
+    _integral = 0;
+    _modeled = false;
+}
+
+void DomDomCurrentController::forget()
+{
+    _sx = _sy = _sxx = _syy = _sxy = _sw = 0;
+}
+
+bool DomDomCurrentController::feedForward(float target_mA, float &dac) const
+{
+    if (_sw < MIN_MODEL_WEIGHT)
+    {
+        return false;
+    }
+
+    float mean_x = _sx / _sw;
+    float mean_y = _sy / _sw;
+    float var_x = _sxx / _sw - mean_x * mean_x;
+
+    if (var_x < MIN_MODEL_VARIANCE)
+    {
+        return false;
+    }
+
+    float slope = (_sxy / _sw - mean_x * mean_y) / var_x;
+
+    // La salida esta invertida, una pendiente positiva indica un modelo erroneo
+    if (slope >= 0)
+    {
+        return false;
+    }
+
+    // La respuesta del driver no es lineal cerca del corte, lejos de las lecturas
+    // aprendidas la recta falla y el salto se pasaria del objetivo
+    float var_y = _syy / _sw - mean_y * mean_y;
+    float reach = MAX_MODEL_REACH * sqrtf(var_y > 0 ? var_y : 0);
+    float delta = target_mA - mean_y;
+    delta = delta > reach ? reach : (delta < -reach ? -reach : delta);
+
+    dac = mean_x + delta / slope;
+    dac = dac < output_min ? output_min : dac;
+    dac = dac > output_max ? output_max : dac;
+
+    return true;
+}
+
+float DomDomCurrentController::retarget(float target_mA)
+{
+    float dac;
+    _modeled = feedForward(target_mA, dac);
+    _base = _modeled ? dac : _output;
+
+    // El integral acumulado correspondia al objetivo anterior
+    _integral = 0;
+    _output = _base;
+
+    return _output;
+}
+
+void DomDomCurrentController::track(float base)
+{
+    // Hasta ahora el integral llevaba la salida desde el reinicio, por ejemplo cruzando la
+    // zona muerta del driver. Sumado a la prealimentacion la llevaria mucho mas alla
+    if (!_modeled)
+    {
+        _integral = 0;
+        _modeled = true;
+    }
+
+    _base = base;
+}
+
+float DomDomCurrentController::update(float error_mA, float dt_s)
+{
+    float integral = _integral + ki * error_mA * dt_s;
+
+    // Un codigo DAC mayor reduce la corriente, por eso restamos
+    float output = _base - kp * error_mA - integral;
+
+    // Anti-windup: no seguimos integrando si la salida esta saturada en la direccion del error
+    if (output < output_min)
+    {
+        output = output_min;
+        if (error_mA < 0)
+        {
+            _integral = integral;
+        }
+    }
+    else if (output > output_max)
+    {
+        output = output_max;
+        if (error_mA > 0)
+        {
+            _integral = integral;
+        }
+    }
+    else
+    {
+        _integral = integral;
+    }
+
+    _output = output;
+
+    return _output;
+}
+
+bool DomDomCurrentController::validGains(float kp, float ki)
+{
+    // Cualquier comparacion con NaN es falsa
+    return kp >= 0 && kp <= CHANNEL_CONTROL_KP_MAX && ki >= 0 && ki <= CHANNEL_CONTROL_KI_MAX;
+}
+
+void DomDomCurrentController::learn(float dac, float mA)
+{
+    _sx = _sx * forgetting + dac;
+    _sy = _sy * forgetting + mA;
+    _sxx = _sxx * forgetting + dac * dac;
+    _syy = _syy * forgetting + mA * mA;
+    _sxy = _sxy * forgetting + dac * mA;
+    _sw = _sw * forgetting + 1.0f;
+}
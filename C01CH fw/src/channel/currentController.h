@@ -0,0 +1,135 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+#ifndef DOMDOM_CURRENTCONTROLLER_h
+#define DOMDOM_CURRENTCONTROLLER_h
+
+#include <stdint.h>
+
+/**
+ * Controlador PI de corriente con prealimentacion (feed-forward).
+ *
+ * Trabaja directamente sobre el codigo DAC del canal. Hay que tener
+ * en cuenta que la salida esta invertida: un codigo DAC mayor
+ * supone menos corriente en el led.
+ *
+ * La prealimentacion se obtiene de una recta DAC->mA que se va
+ * aprendiendo con las lecturas del INA, de forma que ante un cambio
+ * de objetivo saltamos directamente cerca del codigo correcto y el
+ * PI solo tiene que corregir el error residual.
+ *
+ * No depende del framework de Arduino para poder compilarse en el host.
+ */
+class DomDomCurrentController
+{
+    private:
+        /**
+         * Termino integral acumulado (en codigos DAC)
+         */
+        float _integral;
+        /**
+         * Salida de partida obtenida de la prealimentacion (codigo DAC)
+         */
+        float _base;
+        /**
+         * Ultima salida calculada
+         */
+        float _output;
+        /**
+         * Indica si la salida de partida viene de la prealimentacion
+         */
+        bool _modeled;
+        /**
+         * Sumatorios para la regresion lineal DAC->mA con olvido exponencial
+         */
+        float _sx, _sy, _sxx, _syy, _sxy, _sw;
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomCurrentController();
+        /**
+         * Ganancia proporcional (codigos DAC por mA de error)
+         */
+        float kp;
+        /**
+         * Ganancia integral (codigos DAC por mA de error y segundo)
+         */
+        float ki;
+        /**
+         * Valor minimo de salida (codigo DAC)
+         */
+        float output_min;
+        /**
+         * Valor maximo de salida (codigo DAC)
+         */
+        float output_max;
+        /**
+         * Factor de olvido para el aprendizaje de la recta (0-1).
+         * Cuanto mas cerca de 1 mas peso tienen las lecturas antiguas.
+         */
+        float forgetting;
+        /**
+         * Reinicia el controlador dejando la salida en @output.
+         */
+        void reset(float output);
+        /**
+         * Recalcula la salida para un nuevo objetivo usando la prealimentacion.
+         * Si todavia no hay un modelo aprendido mantiene la salida actual.
+         */
+        float retarget(float target_mA);
+        /**
+         * Mueve la salida de partida a @base, obtenida de la prealimentacion, manteniendo
+         * el termino integral. Se usa mientras el objetivo cambia de forma continua (rampas).
+         * La primera vez tras un reinicio descarta el integral, que no corregia un modelo.
+         */
+        void track(float base);
+        /**
+         * Calcula la nueva salida a partir del error (objetivo - medida) en mA
+         * y del tiempo transcurrido desde la ultima llamada en segundos.
+         */
+        float update(float error_mA, float dt_s);
+        /**
+         * Incorpora una lectura estable (codigo DAC, mA medidos) al modelo.
+         */
+        void learn(float dac, float mA);
+        /**
+         * Borra el modelo aprendido.
+         */
+        void forget();
+        /**
+         * Devuelve en @dac el codigo estimado para obtener @target_mA.
+         * Devuelve falso si no hay suficiente informacion para estimarlo.
+         */
+        bool feedForward(float target_mA, float &dac) const;
+        /**
+         * Ultima salida calculada
+         */
+        float output() const { return _output; };
+        /**
+         * Indica si @kp y @ki son ganancias validas: no negativas y dentro de los maximos
+         * de la configuracion. Rechaza NaN e infinito.
+         */
+        static bool validGains(float kp, float ki);
+};
+
+#endif /* DOMDOM_CURRENTCONTROLLER_h */
@@ -0,0 +1,170 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "dacOutput.h"
+#include <soc/rtc_io_reg.h>
+
+const uint32_t STATE_ENABLED    = 1 << 16;
+const uint16_t FRACTION_STEPS   = 1 << CHANNEL_DITHER_BITS;
+
+DomDomDacOutputClass::DomDomDacOutputClass()
+{
+    for (uint8_t i = 0; i < DAC_OUTPUT_SIZE; i++)
+    {
+        _state[i] = 0;
+        _accumulator[i] = 0;
+        _written[i] = 0;
+    }
+}
+
+bool DomDomDacOutputClass::begin()
+{
+#if CHANNEL_DITHER_ENABLED
+    if (_timer != NULL)
+    {
+        return true;
+    }
+
+    // Temporizador a 1 MHz
+    _timer = timerBegin(CHANNEL_DITHER_TIMER, 80, true);
+    if (_timer == NULL)
+    {
+        return false;
+    }
+
+    timerAttachInterrupt(_timer, ditherISR, true);
+    timerAlarmWrite(_timer, 1000000 / CHANNEL_DITHER_FREQUENCY, true);
+    timerAlarmEnable(_timer);
+#endif
+
+    return true;
+}
+
+void DomDomDacOutputClass::end()
+{
+    if (_timer != NULL)
+    {
+        timerAlarmDisable(_timer);
+        timerDetachInterrupt(_timer);
+        timerEnd(_timer);
+        _timer = NULL;
+    }
+
+    for (uint8_t i = 0; i < DAC_OUTPUT_SIZE; i++)
+    {
+        if (_state[i] & STATE_ENABLED)
+        {
+            dacWrite(i + 25, (_state[i] >> 8) & 0xFF);
+        }
+    }
+}
+
+void DomDomDacOutputClass::write(uint8_t pin, float code)
+{
+    if (pin < 25 || pin >= 25 + DAC_OUTPUT_SIZE)
+    {
+        return;
+    }
+
+    uint8_t dac = pin - 25;
+    code = code < 0 ? 0 : (code > UINT8_MAX ? UINT8_MAX : code);
+
+    // Sin temporizador solo podemos redondear al codigo mas cercano
+    uint32_t steps = _timer != NULL ? lroundf(code * FRACTION_STEPS) : lroundf(code) * FRACTION_STEPS;
+    uint32_t base = steps / FRACTION_STEPS;
+    uint32_t fraction = steps % FRACTION_STEPS;
+
+    uint32_t state = STATE_ENABLED | (base << 8) | fraction;
+    if (state == _state[dac])
+    {
+        return;
+    }
+
+    // La primera escritura configura el pin como salida DAC
+    bool enabled = _state[dac] & STATE_ENABLED;
+    _state[dac] = state;
+
+    if (!enabled || fraction == 0)
+    {
+        dacWrite(pin, base);
+        _written[dac] = base;
+    }
+}
+
+void IRAM_ATTR DomDomDacOutputClass::writeNow(uint8_t pin, uint8_t code)
+{
+    if (pin < 25 || pin >= 25 + DAC_OUTPUT_SIZE)
+    {
+        return;
+    }
+
+    uint8_t dac = pin - 25;
+    _state[dac] = STATE_ENABLED | ((uint32_t)code << 8);
+    _written[dac] = code;
+    writeRegister(dac, code);
+}
+
+void IRAM_ATTR DomDomDacOutputClass::writeRegister(uint8_t dac, uint8_t value)
+{
+    // dacWrite no esta en IRAM, escribimos el registro directamente
+    if (dac == 0)
+    {
+        SET_PERI_REG_BITS(RTC_IO_PAD_DAC1_REG, RTC_IO_PDAC1_DAC, value, RTC_IO_PDAC1_DAC_S);
+    }
+    else
+    {
+        SET_PERI_REG_BITS(RTC_IO_PAD_DAC2_REG, RTC_IO_PDAC2_DAC, value, RTC_IO_PDAC2_DAC_S);
+    }
+}
+
+void IRAM_ATTR DomDomDacOutputClass::ditherISR()
+{
+    DomDomDacOutputClass &output = DomDomDacOutput;
+
+    for (uint8_t i = 0; i < DAC_OUTPUT_SIZE; i++)
+    {
+        uint32_t state = output._state[i];
+        uint16_t fraction = state & 0xFF;
+        if (!(state & STATE_ENABLED) || fraction == 0)
+        {
+            continue;
+        }
+
+        // Sigma-delta de primer orden: el desbordamiento del acumulador suma un codigo
+        uint8_t code = (state >> 8) & 0xFF;
+        output._accumulator[i] += fraction;
+        if (output._accumulator[i] >= FRACTION_STEPS)
+        {
+            output._accumulator[i] -= FRACTION_STEPS;
+            code = code < UINT8_MAX ? code + 1 : code;
+        }
+
+        if (code != output._written[i])
+        {
+            output._written[i] = code;
+            writeRegister(i, code);
+        }
+    }
+}
+
+#if !defined(NO_GLOBAL_INSTANCES)
+DomDomDacOutputClass DomDomDacOutput;
+#endif
@@ -0,0 +1,102 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_DACOUTPUT_h
+#define DOMDOM_DACOUTPUT_h
+
+#include <Arduino.h>
+#include "configuration.h"
+
+/**
+ * Numero de salidas DAC del ESP32 (pines 25 y 26)
+ */
+#define DAC_OUTPUT_SIZE     2
+
+/**
+ * Salida DAC con resolucion fraccionaria.
+ *
+ * El DAC solo tiene 256 codigos. Para valores con decimales un
+ * temporizador alterna entre los dos codigos vecinos con un
+ * modulador sigma-delta de primer orden, de forma que la media
+ * tiene CHANNEL_DITHER_BITS bits mas de resolucion. Con pocos
+ * bits de fraccion el patron se repite a mas de 1 kHz y no se
+ * aprecia parpadeo.
+ */
+class DomDomDacOutputClass
+{
+    private:
+        /**
+         * Temporizador de la modulacion
+         */
+        hw_timer_t *_timer = NULL;
+        /**
+         * Codigo base y fraccion de cada DAC. Se escriben de una vez
+         * para que la interrupcion nunca vea un valor a medias:
+         * bit 16 habilitado, bits 8-15 codigo, bits 0-7 fraccion.
+         */
+        volatile uint32_t _state[DAC_OUTPUT_SIZE];
+        /**
+         * Acumulador del modulador de cada DAC
+         */
+        uint16_t _accumulator[DAC_OUTPUT_SIZE];
+        /**
+         * Ultimo codigo escrito en cada DAC
+         */
+        uint8_t _written[DAC_OUTPUT_SIZE];
+        /**
+         * Escribe directamente el registro del DAC. Se puede llamar desde interrupciones.
+         */
+        static void writeRegister(uint8_t dac, uint8_t value);
+        /**
+         * Interrupcion del temporizador
+         */
+        static void ditherISR();
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomDacOutputClass();
+        /**
+         * Inicia el temporizador de la modulacion.
+         */
+        bool begin();
+        /**
+         * Para el temporizador. Las salidas quedan en su codigo base.
+         */
+        void end();
+        /**
+         * Escribe en el pin @pin el codigo @code con decimales.
+         */
+        void write(uint8_t pin, float code);
+        /**
+         * Escribe en el pin @pin el codigo entero @code sin esperar al temporizador.
+         * Se puede llamar desde interrupciones una vez escrito el pin con write().
+         */
+        void writeNow(uint8_t pin, uint8_t code);
+};
+
+#if !defined(NO_GLOBAL_INSTANCES)
+extern DomDomDacOutputClass DomDomDacOutput;
+#endif
+
+#endif /* DOMDOM_DACOUTPUT_h */
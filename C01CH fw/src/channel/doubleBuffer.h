@@ -0,0 +1,122 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_DOUBLEBUFFER_h
+#define DOMDOM_DOUBLEBUFFER_h
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Doble buffer con publicacion atomica para un unico escritor.
+ *
+ * El escritor prepara la copia que no esta publicada y la publica
+ * cambiando de golpe el indice de la activa. Los lectores nunca
+ * esperan: toman la copia activa y la marcan como en uso mientras
+ * la leen, y el escritor no vuelve a tocar una copia hasta que
+ * ningun lector la esta usando. Asi cada lector ve entera la copia
+ * anterior o la nueva, nunca una a medias.
+ *
+ * No reserva memoria ni depende del framework de Arduino para poder
+ * compilarse en el host.
+ */
+template <typename T>
+class DomDomDoubleBuffer
+{
+    private:
+        /**
+         * Las dos copias
+         */
+        T _values[2];
+        /**
+         * Copia publicada
+         */
+        std::atomic<uint8_t> _active;
+        /**
+         * Lectores usando cada copia
+         */
+        mutable std::atomic<uint16_t> _readers[2];
+
+    public:
+        /**
+         * Lectura de la copia publicada. Mientras existe la copia no cambia.
+         */
+        class Reader
+        {
+            private:
+                const DomDomDoubleBuffer &_buffer;
+                uint8_t _slot;
+
+            public:
+                /**
+                 * Toma la copia publicada de @buffer. Si se publica otra mientras
+                 * la marcamos como en uso volvemos a intentarlo con la nueva.
+                 */
+                explicit Reader(const DomDomDoubleBuffer &buffer) : _buffer(buffer)
+                {
+                    while (true)
+                    {
+                        _slot = _buffer._active.load();
+                        _buffer._readers[_slot]++;
+                        if (_buffer._active.load() == _slot)
+                        {
+                            break;
+                        }
+
+                        _buffer._readers[_slot]--;
+                    }
+                };
+                /**
+                 * Deja libre la copia
+                 */
+                ~Reader() { _buffer._readers[_slot]--; };
+                Reader(const Reader &) = delete;
+                Reader &operator=(const Reader &) = delete;
+                const T &operator*() const { return _buffer._values[_slot]; };
+                const T *operator->() const { return &_buffer._values[_slot]; };
+        };
+
+        /**
+         * Constructor
+         */
+        DomDomDoubleBuffer() : _active(0)
+        {
+            _readers[0] = 0;
+            _readers[1] = 0;
+        };
+        /**
+         * Devuelve la copia sin publicar para prepararla, o nullptr si algun lector
+         * la esta usando todavia. Solo debe llamarse desde un escritor a la vez.
+         */
+        T *back()
+        {
+            uint8_t slot = 1 - _active.load();
+
+            return _readers[slot].load() == 0 ? &_values[slot] : nullptr;
+        };
+        /**
+         * Publica la copia devuelta por back().
+         */
+        void publish() { _active.store(1 - _active.load()); };
+};
+
+#endif /* DOMDOM_DOUBLEBUFFER_h */
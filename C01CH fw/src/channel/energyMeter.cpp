@@ -0,0 +1,123 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "energyMeter.h"
+
+// Anterior a esta fecha (2020-01-01) consideramos que el reloj no esta en hora
+const time_t VALID_TIME = 1577836800;
+
+// Muestras mas separadas se descartan (primera iteracion o tarea bloqueada)
+const float MAX_SAMPLE_S = 10.0f;
+
+/**
+ * Dias desde 1970-01-01 de una fecha del calendario gregoriano
+ */
+int32_t daysFromCivil(int32_t year, int32_t month, int32_t day)
+{
+    year -= month <= 2;
+    int32_t era = (year >= 0 ? year : year - 399) / 400;
+    int32_t yoe = year - era * 400;
+    int32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * 146097 + doe - 719468;
+}
+
+DomDomEnergyMeter::DomDomEnergyMeter()
+{
+    clear();
+}
+
+void DomDomEnergyMeter::clear()
+{
+    _counters = DomDomEnergyCounters();
+    _dirty = true;
+}
+
+DomDomEnergyPeriod DomDomEnergyMeter::period(time_t now)
+{
+    DomDomEnergyPeriod period;
+    if (now < VALID_TIME)
+    {
+        return period;
+    }
+
+    tm timeinfo;
+    localtime_r(&now, &timeinfo);
+
+    period.valid = true;
+    period.month_key = timeinfo.tm_year * 12 + timeinfo.tm_mon;
+    period.day_key = daysFromCivil(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday);
+    period.hour_key = period.day_key * 24 + timeinfo.tm_hour;
+
+    return period;
+}
+
+void DomDomEnergyMeter::add(float power_W, float dt_s, const DomDomEnergyPeriod &period)
+{
+    // Los periodos cambian aunque el canal este apagado, para que una hora sin
+    // consumo no deje la energia de la hora anterior como la de la ultima hora
+    if (period.valid)
+    {
+        int32_t month_key = period.month_key;
+        int32_t day_key = period.day_key;
+        int32_t hour_key = period.hour_key;
+
+        // Al cambiar de periodo el actual pasa a ser el anterior. Si se ha
+        // saltado algun periodo (equipo apagado) el anterior queda a cero
+        if (hour_key != _counters.hour_key)
+        {
+            _counters.last_hour_Wh = hour_key == _counters.hour_key + 1 ? _counters.hour_Wh : 0;
+            _counters.hour_Wh = 0;
+            _counters.hour_key = hour_key;
+            _dirty = true;
+        }
+
+        if (day_key != _counters.day_key)
+        {
+            _counters.last_day_Wh = day_key == _counters.day_key + 1 ? _counters.day_Wh : 0;
+            _counters.day_Wh = 0;
+            _counters.day_key = day_key;
+            _dirty = true;
+        }
+
+        if (month_key != _counters.month_key)
+        {
+            _counters.last_month_Wh = month_key == _counters.month_key + 1 ? _counters.month_Wh : 0;
+            _counters.month_Wh = 0;
+            _counters.month_key = month_key;
+            _dirty = true;
+        }
+    }
+
+    if (dt_s <= 0 || dt_s > MAX_SAMPLE_S || power_W <= 0)
+    {
+        return;
+    }
+
+    double energy = power_W * dt_s / 3600.0;
+    _counters.total_Wh += energy;
+    _counters.hour_Wh += energy;
+    _counters.day_Wh += energy;
+    _counters.month_Wh += energy;
+
+    _dirty = true;
+}
@@ -0,0 +1,124 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_ENERGYMETER_h
+#define DOMDOM_ENERGYMETER_h
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Energia consumida por un canal en Wh.
+ */
+struct DomDomEnergyCounters
+{
+    /**
+     * Energia total desde la ultima puesta a cero
+     */
+    double total_Wh = 0;
+    /**
+     * Energia de la hora, el dia y el mes en curso
+     */
+    double hour_Wh = 0, day_Wh = 0, month_Wh = 0;
+    /**
+     * Energia de la hora, el dia y el mes anteriores
+     */
+    double last_hour_Wh = 0, last_day_Wh = 0, last_month_Wh = 0;
+    /**
+     * Identificadores de la hora, el dia y el mes en curso (hora local)
+     */
+    int32_t hour_key = -1, day_key = -1, month_key = -1;
+};
+
+/**
+ * Hora, dia y mes (hora local) de un instante para repartir la energia.
+ */
+struct DomDomEnergyPeriod
+{
+    /**
+     * Indica si el reloj esta en hora
+     */
+    bool valid = false;
+    /**
+     * Identificadores de la hora, el dia y el mes
+     */
+    int32_t hour_key = -1, day_key = -1, month_key = -1;
+};
+
+/**
+ * Contador de energia de un canal.
+ *
+ * Integra la potencia de cada conversion y reparte la energia
+ * en la hora, el dia y el mes en curso segun la hora local. Mientras
+ * el reloj no esta en hora solo se acumula en los periodos actuales.
+ *
+ * No depende del framework de Arduino para poder compilarse en el host.
+ */
+class DomDomEnergyMeter
+{
+    private:
+        /**
+         * Contadores actuales
+         */
+        DomDomEnergyCounters _counters;
+        /**
+         * Indica si hay cambios sin guardar
+         */
+        bool _dirty;
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomEnergyMeter();
+        /**
+         * Calcula el periodo del instante @now. Usa localtime_r(), que toma un bloqueo
+         * de la libreria, por lo que no debe llamarse dentro de una seccion critica.
+         */
+        static DomDomEnergyPeriod period(time_t now);
+        /**
+         * Suma @power_W vatios durante @dt_s segundos en el periodo @period.
+         */
+        void add(float power_W, float dt_s, const DomDomEnergyPeriod &period);
+        /**
+         * Devuelve los contadores actuales.
+         */
+        const DomDomEnergyCounters &counters() const { return _counters; };
+        /**
+         * Pone todos los contadores a cero.
+         */
+        void clear();
+        /**
+         * Sustituye los contadores por los cargados de memoria.
+         */
+        void setLoaded(const DomDomEnergyCounters &counters) { _counters = counters; _dirty = false; };
+        /**
+         * Indica si hay cambios sin guardar
+         */
+        bool isDirty() const { return _dirty; };
+        /**
+         * Marca los contadores como guardados.
+         */
+        void setSaved() { _dirty = false; };
+};
+
+#endif /* DOMDOM_ENERGYMETER_h */
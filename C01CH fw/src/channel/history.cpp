@@ -0,0 +1,187 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "history.h"
+
+DomDomHistoryTier::DomDomHistoryTier(DomDomHistoryBucket *buckets, uint16_t capacity, uint32_t period)
+{
+    _buckets = buckets;
+    _capacity = capacity;
+    _period = period;
+
+    clear();
+}
+
+void DomDomHistoryTier::clear()
+{
+    _head = 0;
+    _count = 0;
+    _newest = 0;
+    _sum = 0;
+    _samples = 0;
+}
+
+void DomDomHistoryTier::add(uint32_t time, uint16_t power)
+{
+    uint32_t number = time / _period;
+
+    // Si el reloj va hacia atras o el hueco llena todo el buffer empezamos de nuevo:
+    // todos los intervalos quedarian vacios igualmente
+    if (_count > 0 && (number < _newest || number - _newest >= _capacity))
+    {
+        clear();
+    }
+
+    if (_count == 0)
+    {
+        _count = 1;
+        _newest = number;
+    }
+
+    // Avanzamos dejando vacios los intervalos sin muestras. Se llama con el bloqueo
+    // del historial tomado, asi que nunca se rellenan mas de _capacity - 1
+    uint16_t gap = number - _newest;
+    for (uint16_t i = 0; i < gap; i++)
+    {
+        _head = (_head + 1) % _capacity;
+        _buckets[_head].min = UINT16_MAX;
+        _buckets[_head].avg = 0;
+        _buckets[_head].max = 0;
+
+        _count = _count < _capacity ? _count + 1 : _capacity;
+        _newest++;
+        _sum = 0;
+        _samples = 0;
+    }
+
+    DomDomHistoryBucket &bucket = _buckets[_head];
+    if (_samples == 0)
+    {
+        bucket.min = power;
+        bucket.max = power;
+    }
+    else
+    {
+        bucket.min = power < bucket.min ? power : bucket.min;
+        bucket.max = power > bucket.max ? power : bucket.max;
+    }
+
+    _sum += power;
+    _samples++;
+    bucket.avg = _sum / _samples;
+}
+
+bool DomDomHistoryTier::get(uint16_t index, uint32_t &time, DomDomHistoryBucket &bucket) const
+{
+    if (index >= _count)
+    {
+        return false;
+    }
+
+    uint16_t age = _count - 1 - index;
+    bucket = _buckets[(_head + _capacity - age) % _capacity];
+    time = (_newest - age) * _period;
+
+    return true;
+}
+
+uint16_t DomDomHistoryTier::indexOf(uint32_t time) const
+{
+    if (_count == 0)
+    {
+        return 0;
+    }
+
+    uint32_t number = time / _period;
+    uint32_t oldest = _newest - (_count - 1);
+
+    if (number <= oldest)
+    {
+        return 0;
+    }
+
+    if (number > _newest)
+    {
+        return _count;
+    }
+
+    return number - oldest;
+}
+
+DomDomPowerHistory::DomDomPowerHistory() :
+    seconds(_seconds_buckets, HISTORY_SECONDS_SIZE, 1),
+    minutes(_minutes_buckets, HISTORY_MINUTES_SIZE, 60),
+    hours(_hours_buckets, HISTORY_HOURS_SIZE, 3600)
+{
+    clear();
+}
+
+void DomDomPowerHistory::clear()
+{
+    _raw_head = 0;
+    _raw_count = 0;
+
+    seconds.clear();
+    minutes.clear();
+    hours.clear();
+}
+
+void DomDomPowerHistory::add(uint32_t time, uint32_t time_ms, float power_W)
+{
+    float scaled = power_W * HISTORY_POWER_SCALE;
+    uint16_t power = scaled <= 0 ? 0 : (scaled >= UINT16_MAX ? UINT16_MAX : (uint16_t)(scaled + 0.5f));
+
+    _raw_head = (_raw_head + 1) % HISTORY_RAW_SIZE;
+    _raw[_raw_head].time_ms = time_ms;
+    _raw[_raw_head].power = power;
+    _raw_count = _raw_count < HISTORY_RAW_SIZE ? _raw_count + 1 : HISTORY_RAW_SIZE;
+
+    seconds.add(time, power);
+    minutes.add(time, power);
+    hours.add(time, power);
+}
+
+bool DomDomPowerHistory::getRaw(uint16_t index, DomDomHistorySample &sample) const
+{
+    if (index >= _raw_count)
+    {
+        return false;
+    }
+
+    uint16_t age = _raw_count - 1 - index;
+    sample = _raw[(_raw_head + HISTORY_RAW_SIZE - age) % HISTORY_RAW_SIZE];
+
+    return true;
+}
+
+DomDomHistoryTier *DomDomPowerHistory::tier(DomDomHistoryTierType type)
+{
+    switch (type)
+    {
+        case HISTORY_SECONDS:
+            return &seconds;
+        case HISTORY_MINUTES:
+            return &minutes;
+        case HISTORY_HOURS:
+            return &hours;
+        default:
+            return nullptr;
+    }
+}
@@ -0,0 +1,192 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+#ifndef DOMDOM_HISTORY_h
+#define DOMDOM_HISTORY_h
+
+#include <stdint.h>
+
+/**
+ * Tamaño de cada nivel. Con muestras de 8 bytes e intervalos de 6 ocupan unos 11 KB
+ * por canal, 8.6 KB de ellos para las 24 h de minutos
+ */
+#define HISTORY_RAW_SIZE        64
+#define HISTORY_SECONDS_SIZE    120
+#define HISTORY_MINUTES_SIZE    1440
+#define HISTORY_HOURS_SIZE      168
+
+/**
+ * Potencia guardada en centesimas de vatio
+ */
+#define HISTORY_POWER_SCALE     100
+
+/**
+ * Niveles de resolucion del historico
+ */
+enum DomDomHistoryTierType
+{
+    HISTORY_RAW = 0,
+    HISTORY_SECONDS = 1,
+    HISTORY_MINUTES = 2,
+    HISTORY_HOURS = 3
+};
+
+/**
+ * Muestra sin agrupar
+ */
+struct DomDomHistorySample
+{
+    uint32_t time_ms;
+    uint16_t power;
+};
+
+/**
+ * Intervalo agrupado con los valores minimo, medio y maximo.
+ * Un intervalo sin muestras tiene min > max.
+ */
+struct DomDomHistoryBucket
+{
+    uint16_t min;
+    uint16_t avg;
+    uint16_t max;
+};
+
+/**
+ * Buffer circular de intervalos consecutivos de @period segundos.
+ *
+ * No reserva memoria, trabaja sobre el array que recibe en el constructor.
+ */
+class DomDomHistoryTier
+{
+    private:
+        /**
+         * Intervalos guardados
+         */
+        DomDomHistoryBucket *_buckets;
+        /**
+         * Numero maximo de intervalos
+         */
+        uint16_t _capacity;
+        /**
+         * Posicion del intervalo mas reciente
+         */
+        uint16_t _head;
+        /**
+         * Numero de intervalos guardados
+         */
+        uint16_t _count;
+        /**
+         * Duracion de cada intervalo en segundos
+         */
+        uint32_t _period;
+        /**
+         * Numero (tiempo / periodo) del intervalo mas reciente
+         */
+        uint32_t _newest;
+        /**
+         * Acumuladores del intervalo en curso
+         */
+        uint32_t _sum, _samples;
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomHistoryTier(DomDomHistoryBucket *buckets, uint16_t capacity, uint32_t period);
+        /**
+         * Borra todos los intervalos.
+         */
+        void clear();
+        /**
+         * Añade una muestra en el instante @time (segundos).
+         */
+        void add(uint32_t time, uint16_t power);
+        /**
+         * Numero de intervalos guardados
+         */
+        uint16_t count() const { return _count; };
+        /**
+         * Duracion de cada intervalo en segundos
+         */
+        uint32_t period() const { return _period; };
+        /**
+         * Devuelve en @bucket el intervalo @index (0 es el mas antiguo) y en @time su inicio.
+         */
+        bool get(uint16_t index, uint32_t &time, DomDomHistoryBucket &bucket) const;
+        /**
+         * Devuelve la posicion del primer intervalo que termina despues de @time.
+         */
+        uint16_t indexOf(uint32_t time) const;
+};
+
+/**
+ * Historico de potencia de un canal.
+ *
+ * Guarda las ultimas muestras sin agrupar y tres niveles agrupados
+ * por segundo, minuto y hora. Cada muestra se añade a todos los
+ * niveles en tiempo constante y sin reservar memoria.
+ */
+class DomDomPowerHistory
+{
+    private:
+        DomDomHistorySample _raw[HISTORY_RAW_SIZE];
+        uint16_t _raw_head;
+        uint16_t _raw_count;
+
+        DomDomHistoryBucket _seconds_buckets[HISTORY_SECONDS_SIZE];
+        DomDomHistoryBucket _minutes_buckets[HISTORY_MINUTES_SIZE];
+        DomDomHistoryBucket _hours_buckets[HISTORY_HOURS_SIZE];
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomPowerHistory();
+        /**
+         * Niveles agrupados (segundos, minutos y horas)
+         */
+        DomDomHistoryTier seconds;
+        DomDomHistoryTier minutes;
+        DomDomHistoryTier hours;
+        /**
+         * Borra todo el historico.
+         */
+        void clear();
+        /**
+         * Añade una muestra de @power_W vatios en el instante @time (segundos)
+         * con la marca de @time_ms milisegundos para las muestras sin agrupar.
+         */
+        void add(uint32_t time, uint32_t time_ms, float power_W);
+        /**
+         * Numero de muestras sin agrupar
+         */
+        uint16_t rawCount() const { return _raw_count; };
+        /**
+         * Devuelve la muestra sin agrupar @index (0 es la mas antigua).
+         */
+        bool getRaw(uint16_t index, DomDomHistorySample &sample) const;
+        /**
+         * Devuelve el nivel agrupado @type o nullptr si es HISTORY_RAW.
+         */
+        DomDomHistoryTier *tier(DomDomHistoryTierType type);
+};
+
+#endif /* DOMDOM_HISTORY_h */
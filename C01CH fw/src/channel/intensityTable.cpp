@@ -0,0 +1,73 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "intensityTable.h"
+#include "scheduleFade.h"
+
+DomDomIntensityTable::DomDomIntensityTable()
+{
+    for (int i = 0; i < INTENSITY_TABLE_SIZE; i++)
+    {
+        _intensity[i] = 0;
+    }
+
+    _day = 0;
+}
+
+uint16_t DomDomIntensityTable::intensityAt(uint32_t second) const
+{
+    uint16_t minute = second / 60;
+    int32_t from = intensity(minute);
+    int32_t to = intensity(minute + 1);
+
+    return from + (to - from) * (int32_t)(second % 60) / 60;
+}
+
+uint16_t DomDomIntensityTable::nextChange(uint16_t minute) const
+{
+    uint16_t current = intensity(minute);
+    for (uint16_t m = minute + 1; m < INTENSITY_TABLE_SIZE; m++)
+    {
+        if (_intensity[m] != current)
+        {
+            return m;
+        }
+    }
+
+    return INTENSITY_TABLE_SIZE;
+}
+
+uint32_t DomDomIntensityTable::nextStep(uint32_t second) const
+{
+    uint16_t minute = second / 60;
+    if (intensity(minute + 1) != intensity(minute))
+    {
+        return (minute + 1) * 60;
+    }
+
+    uint16_t change = nextChange(minute);
+    return (change < INTENSITY_TABLE_SIZE ? change - 1 : INTENSITY_TABLE_SIZE) * 60;
+}
+
+uint32_t DomDomIntensityTable::percent(uint16_t intensity, uint8_t value)
+{
+    return ((uint64_t)value * FADE_PERCENT_ONE * intensity + UINT16_MAX / 2) / UINT16_MAX;
+}
@@ -0,0 +1,95 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_INTENSITYTABLE_h
+#define DOMDOM_INTENSITYTABLE_h
+
+#include <stdint.h>
+
+/**
+ * Un valor por cada minuto del dia
+ */
+#define INTENSITY_TABLE_SIZE    1440
+
+/**
+ * Tabla de intensidad de un dia.
+ *
+ * Guarda la intensidad (0 - 65535) al inicio de cada minuto del dia, de
+ * forma que la programacion solo tiene que leerla e interpolar entre dos
+ * minutos. Las clases derivadas la rellenan una vez al dia.
+ *
+ * No reserva memoria ni depende del framework de Arduino para poder
+ * compilarse en el host.
+ */
+class DomDomIntensityTable
+{
+    protected:
+        /**
+         * Intensidad (0 - 65535) al inicio de cada minuto del dia
+         */
+        uint16_t _intensity[INTENSITY_TABLE_SIZE];
+        /**
+         * Dia (segundos desde 1970 / 86400) de la tabla, 0 si no hay ninguna
+         */
+        uint32_t _day;
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomIntensityTable();
+        /**
+         * Invalida la tabla para que se vuelva a calcular.
+         */
+        void clear() { _day = 0; };
+        /**
+         * Indica si la tabla es la del dia que empieza en @midnight (hora local contada
+         * como unix, igual que el reloj interno)
+         */
+        bool isFor(uint32_t midnight) const { return _day != 0 && _day == midnight / 86400; };
+        /**
+         * Intensidad (0 - 65535) al inicio del minuto @minute. Despues del ultimo minuto
+         * se mantiene su valor.
+         */
+        uint16_t intensity(uint16_t minute) const { return _intensity[minute < INTENSITY_TABLE_SIZE ? minute : INTENSITY_TABLE_SIZE - 1]; };
+        /**
+         * Intensidad en el segundo del dia @second, interpolada entre sus dos minutos
+         */
+        uint16_t intensityAt(uint32_t second) const;
+        /**
+         * Primer minuto despues de @minute con una intensidad distinta, o INTENSITY_TABLE_SIZE
+         * si no cambia hasta el final del dia.
+         */
+        uint16_t nextChange(uint16_t minute) const;
+        /**
+         * Segundo del dia posterior a @second hasta el que la intensidad es una recta: el
+         * minuto siguiente si esta cambiando, o el anterior al proximo cambio si no.
+         */
+        uint32_t nextStep(uint32_t second) const;
+        /**
+         * Porcentaje en coma fija Q16 de un canal con valor maximo @value (0-100%)
+         * a la intensidad @intensity.
+         */
+        static uint32_t percent(uint16_t intensity, uint8_t value);
+};
+
+#endif /* DOMDOM_INTENSITYTABLE_h */
@@ -0,0 +1,146 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "loopTiming.h"
+
+void DomDomTimingHistogram::clear()
+{
+    for (int i = 0; i < LOOP_TIMING_BUCKETS; i++)
+    {
+        buckets[i] = 0;
+    }
+
+    count = 0;
+    min_us = UINT32_MAX;
+    max_us = 0;
+    sum_us = 0;
+}
+
+void DomDomTimingHistogram::add(uint32_t us)
+{
+    // El intervalo es el numero de bits significativos del tiempo
+    uint8_t bucket = 0;
+    while (us >> bucket && bucket < LOOP_TIMING_BUCKETS - 1)
+    {
+        bucket++;
+    }
+
+    buckets[bucket]++;
+    count++;
+    sum_us += us;
+    min_us = us < min_us ? us : min_us;
+    max_us = us > max_us ? us : max_us;
+}
+
+DomDomLoopTiming::DomDomLoopTiming()
+{
+    _ticks_per_us = 1;
+    _start = 0;
+    _mark = 0;
+    _period_us = 0;
+    _last_period_us = 0;
+
+    clear();
+    restart();
+}
+
+void DomDomLoopTiming::clear()
+{
+    for (int i = 0; i < LOOP_PHASE_SIZE; i++)
+    {
+        _stats.phases[i].clear();
+    }
+
+    _stats.period.clear();
+    _stats.jitter_count = 0;
+    _stats.jitter_max_us = 0;
+    _stats.jitter_sum_us = 0;
+
+    _has_period = false;
+}
+
+void DomDomLoopTiming::restart()
+{
+    _has_start = false;
+    _has_period = false;
+    _period_us = 0;
+}
+
+void DomDomLoopTiming::startIteration()
+{
+    uint32_t now = ticks();
+
+    if (!_has_start)
+    {
+        // La frecuencia de la CPU puede cambiar entre arranques del control
+        _ticks_per_us = ticksPerMicro();
+        _ticks_per_us = _ticks_per_us == 0 ? 1 : _ticks_per_us;
+        _period_us = 0;
+    }
+    else
+    {
+        _period_us = (now - _start) / _ticks_per_us;
+    }
+
+    _has_start = true;
+    _start = now;
+    _mark = now;
+
+    for (int i = 0; i < LOOP_PHASE_SIZE; i++)
+    {
+        _phase_ticks[i] = 0;
+    }
+}
+
+void DomDomLoopTiming::endIteration()
+{
+    if (!_has_start)
+    {
+        return;
+    }
+
+    mark(LOOP_PHASE_COMPUTE);
+    _phase_ticks[LOOP_PHASE_TOTAL] = _mark - _start;
+
+    for (int i = 0; i < LOOP_PHASE_SIZE; i++)
+    {
+        _stats.phases[i].add(_phase_ticks[i] / _ticks_per_us);
+    }
+
+    // La primera iteracion tras una pausa no tiene periodo
+    if (_period_us == 0)
+    {
+        return;
+    }
+
+    _stats.period.add(_period_us);
+
+    if (_has_period)
+    {
+        uint32_t jitter = _period_us > _last_period_us ? _period_us - _last_period_us : _last_period_us - _period_us;
+        _stats.jitter_count++;
+        _stats.jitter_sum_us += jitter;
+        _stats.jitter_max_us = jitter > _stats.jitter_max_us ? jitter : _stats.jitter_max_us;
+    }
+
+    _last_period_us = _period_us;
+    _has_period = true;
+}
@@ -0,0 +1,205 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_LOOPTIMING_h
+#define DOMDOM_LOOPTIMING_h
+
+#include <stdint.h>
+#if defined(DOMDOM_NATIVE)
+#include <chrono>
+#else
+#include <Arduino.h>
+#endif
+
+/**
+ * Numero de intervalos de los histogramas. El intervalo 0 cuenta
+ * los tiempos menores de 1 us, el intervalo i los tiempos entre
+ * 2^(i-1) y 2^i us, y el ultimo todos los mayores.
+ */
+#define LOOP_TIMING_BUCKETS     20
+
+/**
+ * Fases de una iteracion del control
+ */
+enum DomDomLoopPhase
+{
+    LOOP_PHASE_WAIT = 0,
+    LOOP_PHASE_I2C = 1,
+    LOOP_PHASE_COMPUTE = 2,
+    LOOP_PHASE_DAC = 3,
+    LOOP_PHASE_TOTAL = 4,
+    LOOP_PHASE_SIZE = 5
+};
+
+/**
+ * Histograma de tiempos en intervalos de potencias de dos.
+ */
+struct DomDomTimingHistogram
+{
+    uint32_t buckets[LOOP_TIMING_BUCKETS];
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    /**
+     * Borra el histograma.
+     */
+    void clear();
+    /**
+     * Añade un tiempo de @us microsegundos.
+     */
+    void add(uint32_t us);
+    /**
+     * Tiempo medio o 0 si no hay muestras
+     */
+    uint32_t mean_us() const { return count > 0 ? sum_us / count : 0; };
+    /**
+     * Limite inferior (us) del intervalo @bucket
+     */
+    static uint32_t bucketLimit(uint8_t bucket) { return bucket == 0 ? 0 : 1UL << (bucket - 1); };
+};
+
+/**
+ * Estadisticas de tiempo del bucle de control.
+ */
+struct DomDomLoopStats
+{
+    /**
+     * Duracion de cada fase de la iteracion
+     */
+    DomDomTimingHistogram phases[LOOP_PHASE_SIZE];
+    /**
+     * Tiempo entre el inicio de dos iteraciones seguidas
+     */
+    DomDomTimingHistogram period;
+    /**
+     * Variacion del periodo entre dos iteraciones seguidas
+     */
+    uint32_t jitter_count;
+    uint32_t jitter_max_us;
+    uint64_t jitter_sum_us;
+    /**
+     * Iteraciones por segundo segun el periodo medio
+     */
+    float rate_hz() const { return period.sum_us > 0 ? period.count * 1000000.0f / period.sum_us : 0; };
+    /**
+     * Variacion media del periodo
+     */
+    uint32_t jitter_mean_us() const { return jitter_count > 0 ? jitter_sum_us / jitter_count : 0; };
+};
+
+/**
+ * Mide el tiempo de las fases de cada iteracion del bucle de control.
+ *
+ * Usa el contador de ciclos de la CPU, por lo que cada medida cuesta
+ * unos pocos ciclos. Los tiempos de la iteracion en curso se acumulan
+ * en ciclos y solo se pasan a los histogramas al terminarla, de forma
+ * que basta con proteger endIteration() y las consultas.
+ */
+class DomDomLoopTiming
+{
+    private:
+        /**
+         * Estadisticas acumuladas
+         */
+        DomDomLoopStats _stats;
+        /**
+         * Ciclos por microsegundo del contador
+         */
+        uint32_t _ticks_per_us;
+        /**
+         * Inicio de la iteracion en curso y ultima marca
+         */
+        uint32_t _start, _mark;
+        /**
+         * Ciclos de cada fase en la iteracion en curso
+         */
+        uint32_t _phase_ticks[LOOP_PHASE_SIZE];
+        /**
+         * Periodo de la iteracion en curso y de la anterior (us)
+         */
+        uint32_t _period_us, _last_period_us;
+        /**
+         * Indica si hay una iteracion anterior para medir el periodo
+         */
+        bool _has_start, _has_period;
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomLoopTiming();
+        /**
+         * Contador de ciclos de la CPU (nanosegundos en el host)
+         */
+        static uint32_t ticks()
+        {
+#if defined(DOMDOM_NATIVE)
+            return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+            return ESP.getCycleCount();
+#endif
+        };
+        /**
+         * Ciclos del contador por microsegundo
+         */
+        static uint32_t ticksPerMicro()
+        {
+#if defined(DOMDOM_NATIVE)
+            return 1000;
+#else
+            return ESP.getCpuFreqMHz();
+#endif
+        };
+        /**
+         * Borra las estadisticas.
+         */
+        void clear();
+        /**
+         * Olvida la iteracion anterior para que una pausa no cuente como periodo.
+         */
+        void restart();
+        /**
+         * Marca el inicio de una iteracion.
+         */
+        void startIteration();
+        /**
+         * Suma a la fase @phase el tiempo desde la ultima marca.
+         */
+        void mark(DomDomLoopPhase phase)
+        {
+            uint32_t now = ticks();
+            _phase_ticks[phase] += now - _mark;
+            _mark = now;
+        };
+        /**
+         * Termina la iteracion y pasa sus tiempos a los histogramas. El tiempo
+         * desde la ultima marca se suma al calculo.
+         */
+        void endIteration();
+        /**
+         * Estadisticas acumuladas
+         */
+        const DomDomLoopStats &stats() const { return _stats; };
+};
+
+#endif /* DOMDOM_LOOPTIMING_h */
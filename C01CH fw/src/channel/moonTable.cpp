@@ -0,0 +1,94 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "moonTable.h"
+#include "astronomy.h"
+
+/**
+ * Limita @value entre 0 y 1
+ */
+static float saturate(float value)
+{
+    return value < 0 ? 0 : (value > 1 ? 1 : value);
+}
+
+DomDomMoonTable::DomDomMoonTable()
+{
+    _moonrise = -1;
+    _moonset = -1;
+}
+
+void DomDomMoonTable::compile(uint32_t midnight, float latitude, float longitude, int32_t utcOffset)
+{
+    // La luna se mueve medio grado por hora, calculamos su posicion cada hora
+    const int HOURS = INTENSITY_TABLE_SIZE / 60;
+    float ra[HOURS + 1], dec[HOURS + 1], lit[HOURS + 1];
+    double start = DomDomAstronomy::daysSinceJ2000(midnight - utcOffset);
+    for (int h = 0; h <= HOURS; h++)
+    {
+        float phase;
+        DomDomAstronomy::moon(start + h / 24.0, ra[h], dec[h], phase, lit[h]);
+    }
+
+    float sunDeclination, equation;
+    DomDomAstronomy::sun(start + 0.5, sunDeclination, equation);
+
+    _moonrise = -1;
+    _moonset = -1;
+    bool up = false;
+
+    for (int minute = 0; minute < INTENSITY_TABLE_SIZE; minute++)
+    {
+        int h = minute / 60;
+        float f = (minute % 60) / 60.0f;
+
+        // La ascension recta puede pasar de 180 a -180 entre dos horas
+        float step = ra[h + 1] - ra[h];
+        step = step > 180 ? step - 360 : (step < -180 ? step + 360 : step);
+
+        float rightAscension = ra[h] + step * f;
+        float declination = dec[h] + (dec[h + 1] - dec[h]) * f;
+        float illumination = lit[h] + (lit[h + 1] - lit[h]) * f;
+
+        float hourAngle = DomDomAstronomy::siderealTime(start + minute / 1440.0) + longitude - rightAscension;
+        float elevation = DomDomAstronomy::elevation(latitude, declination, hourAngle);
+
+        bool visible = elevation >= DomDomAstronomy::MOONRISE_ELEVATION;
+        if (visible && !up && minute > 0)
+        {
+            _moonrise = minute;
+        }
+        else if (!visible && up && minute > 0)
+        {
+            _moonset = minute;
+        }
+        up = visible;
+
+        // De dia no hay luz de luna, aparece durante el crepusculo
+        float sun = DomDomAstronomy::elevation(latitude, sunDeclination, DomDomAstronomy::sunHourAngle(minute - utcOffset / 60.0f, longitude, equation));
+        float night = saturate((DomDomAstronomy::SUNRISE_ELEVATION - sun) / (DomDomAstronomy::SUNRISE_ELEVATION - SCHEDULE_SOLAR_TWILIGHT));
+        float height = saturate((elevation - DomDomAstronomy::MOONRISE_ELEVATION) / SCHEDULE_MOON_FADE_ELEVATION);
+
+        _intensity[minute] = (uint16_t)(saturate(illumination) * height * night * UINT16_MAX + 0.5f);
+    }
+
+    _day = midnight / 86400;
+}
@@ -0,0 +1,92 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_MOONTABLE_h
+#define DOMDOM_MOONTABLE_h
+
+#include <stdint.h>
+#include "configuration.h"
+#include "intensityTable.h"
+
+/**
+ * Configuracion de la luz de luna
+ */
+struct DomDomMoonSettings
+{
+    /**
+     * Indica si se añade la luz de luna a la programacion por la noche
+     */
+    bool enabled = false;
+    /**
+     * Valor en porcentaje (0 - SCHEDULE_MOON_MAX_PERCENT) de cada canal con la luna llena en lo alto
+     */
+    uint8_t value[CHANNEL_SIZE];
+    /**
+     * Constructor
+     */
+    DomDomMoonSettings()
+    {
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            value[c] = SCHEDULE_MOON_PERCENT;
+        }
+    };
+};
+
+/**
+ * Tabla de intensidad de la luz de luna de un dia.
+ *
+ * Se calcula una vez al dia a partir de la posicion de la luna cada hora,
+ * interpolada en cada minuto. La intensidad es la fraccion iluminada del
+ * disco, sube desde el orto hasta SCHEDULE_MOON_FADE_ELEVATION grados y
+ * solo hay luz de noche, entre el ocaso del sol y el final del crepusculo.
+ */
+class DomDomMoonTable : public DomDomIntensityTable
+{
+    private:
+        /**
+         * Minutos del dia del orto y del ocaso de la luna, -1 si hoy no sale o no se pone
+         */
+        int16_t _moonrise, _moonset;
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomMoonTable();
+        /**
+         * Calcula la tabla del dia que empieza en @midnight (hora local contada como unix,
+         * igual que el reloj interno) en la situacion @latitude, @longitude (grados) con
+         * una diferencia de @utcOffset segundos respecto a UTC.
+         */
+        void compile(uint32_t midnight, float latitude, float longitude, int32_t utcOffset);
+        /**
+         * Minuto del dia del orto de la luna, -1 si hoy no sale
+         */
+        int16_t moonrise() const { return _moonrise; };
+        /**
+         * Minuto del dia del ocaso de la luna, -1 si hoy no se pone
+         */
+        int16_t moonset() const { return _moonset; };
+};
+
+#endif /* DOMDOM_MOONTABLE_h */
@@ -0,0 +1,170 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "scheduleFade.h"
+#include <math.h>
+
+uint32_t DomDomFade::interpolate(uint8_t from, uint8_t to, uint32_t elapsed, uint32_t total)
+{
+    if (total == 0 || elapsed >= total)
+    {
+        return to * FADE_PERCENT_ONE;
+    }
+
+    // El redondeo al mas cercano se aleja del cero en los fundidos descendentes
+    int64_t change = (int64_t)((int32_t)to - from) * FADE_PERCENT_ONE * elapsed;
+    int64_t half = change < 0 ? -(int64_t)(total / 2) : total / 2;
+
+    return from * FADE_PERCENT_ONE + (int32_t)((change + half) / (int64_t)total);
+}
+
+uint32_t DomDomFade::nextStep(uint8_t from, uint8_t to, uint32_t elapsed, uint32_t total, uint32_t step)
+{
+    uint64_t diff = to > from ? to - from : from - to;
+    if (diff == 0 || step == 0 || elapsed >= total)
+    {
+        return total;
+    }
+
+    // Avance exacto hasta @elapsed medido en escalones, y segundo en el que se alcanza el siguiente
+    uint64_t span = diff * FADE_PERCENT_ONE;
+    uint64_t steps = span * elapsed / ((uint64_t)total * step) + 1;
+    uint64_t seconds = (steps * step * total + span - 1) / span;
+
+    return seconds < total ? seconds : total;
+}
+
+int32_t DomDomFade::monotoneSlope(uint8_t previous, uint32_t before, uint8_t value, uint8_t next, uint32_t after)
+{
+    if (before == 0 || after == 0)
+    {
+        return 0;
+    }
+
+    // Pendientes de los dos tramos en % por hora
+    float d0 = ((float)value - previous) * 60 / before;
+    float d1 = ((float)next - value) * 60 / after;
+    if (d0 * d1 <= 0)
+    {
+        return 0;
+    }
+
+    // La media armonica nunca pasa del doble de la menor de las dos pendientes,
+    // lo que cumple la condicion de Fritsch-Carlson y mantiene cada tramo monotono
+    float slope = 2 * d0 * d1 / (d0 + d1);
+
+    return (int32_t)lroundf(slope * 65536);
+}
+
+uint32_t DomDomFadeSegment::value(uint32_t elapsed) const
+{
+    if (curve == FADE_CURVE_LINEAR || total == 0 || elapsed >= total)
+    {
+        return DomDomFade::interpolate(from, to, elapsed, total);
+    }
+
+    // Avance normalizado del tiempo en Q16
+    uint64_t u = ((uint64_t)elapsed << 16) / total;
+    int64_t change = ((int64_t)to - from) * (int64_t)FADE_PERCENT_ONE;
+    int64_t result;
+
+    switch (curve)
+    {
+        case FADE_CURVE_COSINE:
+        {
+            uint32_t index = u * FADE_COSINE_STEPS >> 16;
+            uint32_t fraction = (u * FADE_COSINE_STEPS) & 0xFFFF;
+            const uint32_t *table = DomDomFade::Cosine::values;
+            uint64_t ease = table[index] + (((uint64_t)(table[index + 1] - table[index]) * fraction + 0x8000) >> 16);
+            result = change * (int64_t)ease;
+            break;
+        }
+        case FADE_CURVE_SMOOTHSTEP:
+        {
+            // 3u^2 - 2u^3
+            uint64_t u2 = (u * u) >> 16;
+            uint64_t ease = (u2 * (3 * 65536 - 2 * u)) >> 16;
+            result = change * (int64_t)ease;
+            break;
+        }
+        default:
+        {
+            // Hermite cubico con las pendientes de los extremos convertidas a cambio en el tramo
+            int64_t u2 = (int64_t)((u * u) >> 16);
+            int64_t u3 = (u2 * (int64_t)u) >> 16;
+            int64_t h01 = 3 * u2 - 2 * u3;
+            int64_t h10 = u3 - 2 * u2 + (int64_t)u;
+            int64_t h11 = u3 - u2;
+            int64_t m0 = (int64_t)slope_from * total / 3600;
+            int64_t m1 = (int64_t)slope_to * total / 3600;
+            result = change * h01 + m0 * h10 + m1 * h11;
+            break;
+        }
+    }
+
+    int64_t value = (int64_t)from * FADE_PERCENT_ONE + (result + (result < 0 ? -0x8000 : 0x8000)) / 65536;
+
+    // Nunca se sale del intervalo entre los dos extremos
+    int64_t low = (int64_t)(from < to ? from : to) * FADE_PERCENT_ONE;
+    int64_t high = (int64_t)(from < to ? to : from) * FADE_PERCENT_ONE;
+    value = value < low ? low : (value > high ? high : value);
+
+    return (uint32_t)value;
+}
+
+uint32_t DomDomFadeSegment::nextStep(uint32_t elapsed, uint32_t step) const
+{
+    if (curve == FADE_CURVE_LINEAR)
+    {
+        return DomDomFade::nextStep(from, to, elapsed, total, step);
+    }
+
+    if (from == to || step == 0 || elapsed >= total)
+    {
+        return total;
+    }
+
+    // Escalon siguiente al actual medido desde @from
+    uint32_t start = from * FADE_PERCENT_ONE;
+    uint32_t current = value(elapsed);
+    uint32_t moved = current > start ? current - start : start - current;
+    uint32_t target = (moved / step + 1) * step;
+
+    // El tramo es monotono, buscamos el primer segundo que llega al escalon
+    uint32_t low = elapsed + 1;
+    uint32_t high = total;
+    while (low < high)
+    {
+        uint32_t mid = low + (high - low) / 2;
+        uint32_t at = value(mid);
+        uint32_t distance = at > start ? at - start : start - at;
+        if (distance >= target)
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
+
+    return low;
+}
@@ -0,0 +1,140 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_SCHEDULEFADE_h
+#define DOMDOM_SCHEDULEFADE_h
+
+#include <stdint.h>
+#include "brightnessCurve.h"
+
+/**
+ * Unidad de los porcentajes en coma fija (Q16): 1% = 65536
+ */
+#define FADE_PERCENT_ONE    65536UL
+
+/**
+ * Intervalos de la tabla del fundido coseno
+ */
+#define FADE_COSINE_STEPS   128
+
+/**
+ * Forma del fundido entre dos puntos de programacion
+ */
+enum DomDomFadeCurve
+{
+    FADE_CURVE_LINEAR = 0,
+    FADE_CURVE_COSINE = 1,
+    FADE_CURVE_SMOOTHSTEP = 2,
+    FADE_CURVE_SPLINE = 3,
+    FADE_CURVE_COUNT
+};
+
+/**
+ * Interpolacion de los fundidos de la programacion.
+ *
+ * Trabaja en segundos y con porcentajes en coma fija Q16 para no perder
+ * las fracciones de porcentaje ni usar coma flotante. Los productos se
+ * hacen en 64 bits, por lo que admite fundidos de cualquier duracion.
+ */
+namespace DomDomFade
+{
+    constexpr double PI = 3.14159265358979324;
+
+    /**
+     * Serie de Taylor del coseno, suficiente para 0 <= x <= PI
+     */
+    constexpr double cosSeries(double x2, double term, int n)
+    {
+        return n > 40 ? 0 : term + cosSeries(x2, -term * x2 / ((n + 1) * (n + 2)), n + 2);
+    }
+
+    /**
+     * Avance (Q16, 0 - 65536) del fundido coseno (1 - cos(PI u)) / 2 en u = @i / FADE_COSINE_STEPS
+     */
+    constexpr uint32_t cosineEase(int i)
+    {
+        return (uint32_t)((1 - cosSeries(DomDomBrightness::square(PI * i / FADE_COSINE_STEPS), 1, 0)) / 2 * 65536 + 0.5);
+    }
+
+    template <typename Index> struct CosineTable;
+    template <int... I> struct CosineTable<DomDomBrightness::Indices<I...>>
+    {
+        static constexpr uint32_t values[sizeof...(I)] = { cosineEase(I)... };
+    };
+    template <int... I> constexpr uint32_t CosineTable<DomDomBrightness::Indices<I...>>::values[sizeof...(I)];
+
+    typedef CosineTable<DomDomBrightness::MakeIndices<FADE_COSINE_STEPS + 1>::type> Cosine;
+
+    /**
+     * Porcentaje (Q16) a los @elapsed segundos de un fundido lineal de @total segundos
+     * desde @from hasta @to (0 - 100%), redondeado al valor mas cercano.
+     */
+    uint32_t interpolate(uint8_t from, uint8_t to, uint32_t elapsed, uint32_t total);
+    /**
+     * Primer segundo despues de @elapsed en el que el fundido lineal avanza hasta el siguiente
+     * multiplo de @step (Q16) contado desde @from. Devuelve @total si no hay mas escalones.
+     */
+    uint32_t nextStep(uint8_t from, uint8_t to, uint32_t elapsed, uint32_t total, uint32_t step);
+    /**
+     * Pendiente (Q16 % por hora) en un punto de valor @value para una curva monotona
+     * (Fritsch-Carlson), a partir del punto anterior @previous, @before minutos antes,
+     * y del siguiente @next, @after minutos despues. Es cero en los maximos y minimos.
+     */
+    int32_t monotoneSlope(uint8_t previous, uint32_t before, uint8_t value, uint8_t next, uint32_t after);
+}
+
+/**
+ * Tramo de fundido entre dos puntos de programacion.
+ *
+ * Todas las formas son monotonas dentro del tramo, por lo que el
+ * siguiente escalon se puede buscar de forma binaria.
+ */
+struct DomDomFadeSegment
+{
+    /**
+     * Porcentajes al inicio y al final del tramo
+     */
+    uint8_t from = 0, to = 0;
+    /**
+     * Forma del tramo (DomDomFadeCurve)
+     */
+    uint8_t curve = FADE_CURVE_LINEAR;
+    /**
+     * Duracion del tramo en segundos
+     */
+    uint32_t total = 0;
+    /**
+     * Pendientes (Q16 % por hora) al inicio y al final, solo para FADE_CURVE_SPLINE
+     */
+    int32_t slope_from = 0, slope_to = 0;
+    /**
+     * Porcentaje (Q16) a los @elapsed segundos del inicio del tramo
+     */
+    uint32_t value(uint32_t elapsed) const;
+    /**
+     * Primer segundo despues de @elapsed en el que el tramo avanza hasta el siguiente
+     * multiplo de @step (Q16) contado desde @from. Devuelve @total si no hay mas escalones.
+     */
+    uint32_t nextStep(uint32_t elapsed, uint32_t step) const;
+};
+
+#endif /* DOMDOM_SCHEDULEFADE_h */
@@ -22,20 +22,40 @@
 #include "configuration.h"
 
 DomDomSchedulePoint::DomDomSchedulePoint(){};
-DomDomSchedulePoint::DomDomSchedulePoint(DomDomDayOfWeek _day, uint8_t _hour, uint8_t _minute, bool _fade)
+DomDomSchedulePoint::DomDomSchedulePoint(DomDomDayOfWeek _day, uint8_t _hour, uint8_t _minute, bool _fade, uint8_t _curve)
 {
     dayOfWeek = _day;
     hour = _hour;
     minute = _minute;
     fade = _fade;
-    value = 0;
+    curve = _curve < FADE_CURVE_COUNT ? _curve : FADE_CURVE_LINEAR;
+    for (int i = 0; i < CHANNEL_SIZE; i++)
+    {
+        value[i] = 0;
+    }
 }
 
-DomDomSchedulePoint::DomDomSchedulePoint(DomDomDayOfWeek _day, uint8_t _hour, uint8_t _minute, uint8_t _value, bool _fade)
+DomDomSchedulePoint::DomDomSchedulePoint(DomDomDayOfWeek _day, uint8_t _hour, uint8_t _minute, const uint8_t *_values, bool _fade, uint8_t _curve)
 {
     dayOfWeek = _day;
     hour = _hour;
     minute = _minute;
     fade = _fade;
-    value = _value;
-}
\ No newline at end of file
+    curve = _curve < FADE_CURVE_COUNT ? _curve : FADE_CURVE_LINEAR;
+    for (int i = 0; i < CHANNEL_SIZE; i++)
+    {
+        value[i] = _values[i];
+    }
+}
+
+bool DomDomSchedulePointList::add(const DomDomSchedulePoint &point)
+{
+    if (full())
+    {
+        return false;
+    }
+
+    _points[_count++] = point;
+
+    return true;
+}
@@ -23,6 +23,8 @@
 #define DOMDOM_SCHEDULEPOINT_h
 
 #include <Arduino.h>
+#include "configuration.h"
+#include "scheduleFade.h"
 
 /**
  * Enumerado para los dias de la semana
@@ -59,18 +61,21 @@ class DomDomSchedulePoint
         /**
          * Constructor para inicializar con ciertos valores.
          */
-        DomDomSchedulePoint(DomDomDayOfWeek dayOfWeek, uint8_t hour, uint8_t minute, bool fade = true);
+        DomDomSchedulePoint(DomDomDayOfWeek dayOfWeek, uint8_t hour, uint8_t minute, bool fade = true, uint8_t curve = FADE_CURVE_LINEAR);
         /**
          * Constructor para inicializar con todos los valores.
          */
-        DomDomSchedulePoint(DomDomDayOfWeek dayOfWeek, uint8_t hour, uint8_t minute, uint8_t value, bool fade = true);
+        DomDomSchedulePoint(DomDomDayOfWeek dayOfWeek, uint8_t hour, uint8_t minute, const uint8_t *values, bool fade = true, uint8_t curve = FADE_CURVE_LINEAR);
         /**
          * Indica si el cambio es progresivo en el tiempo o no.
          */
         bool fade = true;
         /**
-         * Dia de la semana a la que afecta el punto de programacion.
-         * NO IMPLEMENTADO!!!!
+         * Forma del fundido desde el punto anterior hasta este (DomDomFadeCurve).
+         */
+        uint8_t curve = FADE_CURVE_LINEAR;
+        /**
+         * Dias de la semana a los que afecta el punto de programacion (mascara de bits).
          */
         DomDomDayOfWeek dayOfWeek;
         /**
@@ -82,9 +87,52 @@ class DomDomSchedulePoint
          */
         uint8_t minute;
         /**
-         * Valor en porcentaje (0-100%) para el canal.
+         * Valor en porcentaje (0-100%) para cada canal.
+         */
+        uint8_t value[CHANNEL_SIZE];
+};
+
+/**
+ * Lista de puntos de programacion.
+ *
+ * Guarda los puntos por valor en un array de EEPROM_MAX_SCHEDULE_POINTS,
+ * de forma que añadir puntos o cambiar la programacion completa no reserva
+ * ni libera memoria y no fragmenta el heap.
+ */
+class DomDomSchedulePointList
+{
+    private:
+        /**
+         * Puntos guardados
+         */
+        DomDomSchedulePoint _points[EEPROM_MAX_SCHEDULE_POINTS];
+        /**
+         * Numero de puntos guardados
+         */
+        uint8_t _count = 0;
+
+    public:
+        /**
+         * Borra todos los puntos.
+         */
+        void clear() { _count = 0; };
+        /**
+         * Añade una copia de @point al final. Devuelve falso si la lista esta llena.
+         */
+        bool add(const DomDomSchedulePoint &point);
+        /**
+         * Numero de puntos guardados
+         */
+        uint8_t size() const { return _count; };
+        /**
+         * Indica si no caben mas puntos
+         */
+        bool full() const { return _count >= EEPROM_MAX_SCHEDULE_POINTS; };
+        /**
+         * Punto @index en el orden en el que se añadieron
          */
-        uint8_t value;
+        DomDomSchedulePoint &operator[](uint8_t index) { return _points[index]; };
+        const DomDomSchedulePoint &operator[](uint8_t index) const { return _points[index]; };
 };
 
 #endif /* DOMDOM_SCHEDULEPOINT_h */
\ No newline at end of file
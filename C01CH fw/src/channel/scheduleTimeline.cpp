@@ -0,0 +1,150 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "scheduleTimeline.h"
+
+DomDomScheduleTimeline::DomDomScheduleTimeline()
+{
+    clear();
+}
+
+void DomDomScheduleTimeline::clear()
+{
+    for (uint8_t day = 0; day < SCHEDULE_DAYS_PER_WEEK; day++)
+    {
+        _day_count[day] = 0;
+    }
+
+    _count = 0;
+}
+
+bool DomDomScheduleTimeline::add(uint16_t minute, uint8_t days, uint8_t point)
+{
+    if (_count >= EEPROM_MAX_SCHEDULE_POINTS || minute >= SCHEDULE_MINUTES_PER_DAY)
+    {
+        return false;
+    }
+
+    for (uint8_t day = 0; day < SCHEDULE_DAYS_PER_WEEK; day++)
+    {
+        if (!(days & (1 << day)))
+        {
+            continue;
+        }
+
+        // Insertamos detras de los puntos del mismo minuto para mantener el orden
+        DomDomTimelineEntry *entries = _entries[day];
+        uint8_t position = lowerBound(day, minute + 1);
+        for (uint8_t i = _day_count[day]; i > position; i--)
+        {
+            entries[i] = entries[i - 1];
+        }
+
+        entries[position].minute = minute;
+        entries[position].point = point;
+        for (uint8_t c = 0; c < CHANNEL_SIZE; c++)
+        {
+            entries[position].slope[c] = 0;
+        }
+        _day_count[day]++;
+    }
+
+    _count++;
+
+    return true;
+}
+
+uint8_t DomDomScheduleTimeline::lowerBound(uint8_t day, uint16_t minute) const
+{
+    const DomDomTimelineEntry *entries = _entries[day];
+    uint8_t low = 0;
+    uint8_t high = _day_count[day];
+    while (low < high)
+    {
+        uint8_t mid = (low + high) / 2;
+        if (entries[mid].minute < minute)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+bool DomDomScheduleTimeline::previous(uint8_t day, uint16_t minute, const DomDomTimelineEntry *&entry, int32_t &at) const
+{
+    day %= SCHEDULE_DAYS_PER_WEEK;
+
+    // Antes del primer punto del dia el anterior es el ultimo de los dias previos,
+    // hasta el mismo dia de la semana anterior
+    uint8_t position = lowerBound(day, minute + 1);
+    int32_t offset = 0;
+    for (uint8_t back = 1; position == 0 && back <= SCHEDULE_DAYS_PER_WEEK; back++)
+    {
+        day = (day + SCHEDULE_DAYS_PER_WEEK - 1) % SCHEDULE_DAYS_PER_WEEK;
+        position = _day_count[day];
+        offset -= SCHEDULE_MINUTES_PER_DAY;
+    }
+
+    if (position == 0)
+    {
+        return false;
+    }
+
+    // De varios puntos en el mismo minuto nos quedamos con el primero
+    uint16_t found = _entries[day][position - 1].minute;
+    position = lowerBound(day, found);
+
+    entry = &_entries[day][position];
+    at = found + offset;
+
+    return true;
+}
+
+bool DomDomScheduleTimeline::next(uint8_t day, uint16_t minute, const DomDomTimelineEntry *&entry, int32_t &at) const
+{
+    day %= SCHEDULE_DAYS_PER_WEEK;
+
+    // Despues del ultimo punto del dia el siguiente es el primero de los dias siguientes,
+    // hasta el mismo dia de la semana siguiente
+    uint8_t position = lowerBound(day, minute + 1);
+    int32_t offset = 0;
+    for (uint8_t ahead = 1; position == _day_count[day] && ahead <= SCHEDULE_DAYS_PER_WEEK; ahead++)
+    {
+        day = (day + 1) % SCHEDULE_DAYS_PER_WEEK;
+        position = 0;
+        offset += SCHEDULE_MINUTES_PER_DAY;
+    }
+
+    if (position == _day_count[day])
+    {
+        return false;
+    }
+
+    entry = &_entries[day][position];
+    at = entry->minute + offset;
+
+    return true;
+}
@@ -0,0 +1,123 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_SCHEDULETIMELINE_h
+#define DOMDOM_SCHEDULETIMELINE_h
+
+#include <stdint.h>
+#include "configuration.h"
+
+#define SCHEDULE_MINUTES_PER_DAY    1440
+#define SCHEDULE_DAYS_PER_WEEK      7
+
+/**
+ * Punto de la linea de tiempo: minuto del dia y posicion del punto
+ * de programacion al que corresponde.
+ */
+struct DomDomTimelineEntry
+{
+    uint16_t minute;
+    uint8_t point;
+    /**
+     * Pendiente de cada canal en el punto (Q16 % por hora) para los fundidos
+     * FADE_CURVE_SPLINE. La calcula el programador al cambiar los puntos.
+     */
+    int32_t slope[CHANNEL_SIZE];
+};
+
+/**
+ * Linea de tiempo de la programacion.
+ *
+ * Mantiene para cada dia de la semana los puntos de programacion que
+ * le afectan ordenados por minuto del dia, para encontrar el anterior
+ * y el siguiente a una hora con una busqueda binaria sobre enteros.
+ * Si el dia no tiene puntos antes o despues de esa hora se pasa a los
+ * dias vecinos, como mucho una semana. Los puntos con el mismo minuto
+ * conservan el orden en el que se añadieron.
+ *
+ * No reserva memoria ni depende del framework de Arduino para poder
+ * compilarse en el host.
+ */
+class DomDomScheduleTimeline
+{
+    private:
+        /**
+         * Puntos de cada dia (0 es domingo) ordenados por minuto
+         */
+        DomDomTimelineEntry _entries[SCHEDULE_DAYS_PER_WEEK][EEPROM_MAX_SCHEDULE_POINTS];
+        /**
+         * Numero de puntos de cada dia
+         */
+        uint8_t _day_count[SCHEDULE_DAYS_PER_WEEK];
+        /**
+         * Numero de puntos añadidos
+         */
+        uint8_t _count;
+        /**
+         * Posicion del primer punto del dia @day con minuto mayor o igual que @minute
+         */
+        uint8_t lowerBound(uint8_t day, uint16_t minute) const;
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomScheduleTimeline();
+        /**
+         * Borra todos los puntos.
+         */
+        void clear();
+        /**
+         * Añade el punto de programacion @point en el minuto del dia @minute de los
+         * dias de la mascara @days (bit 0 domingo, como DomDomDayOfWeek).
+         * Devuelve falso si la linea esta llena o el minuto no es valido.
+         */
+        bool add(uint16_t minute, uint8_t days, uint8_t point);
+        /**
+         * Numero de puntos añadidos
+         */
+        uint8_t count() const { return _count; };
+        /**
+         * Numero de puntos del dia de la semana @day
+         */
+        uint8_t dayCount(uint8_t day) const { return _day_count[day % SCHEDULE_DAYS_PER_WEEK]; };
+        /**
+         * Punto @position (ordenado por minuto) del dia de la semana @day
+         */
+        DomDomTimelineEntry &entry(uint8_t day, uint8_t position) { return _entries[day % SCHEDULE_DAYS_PER_WEEK][position]; };
+        /**
+         * Busca el ultimo punto en o antes del minuto @minute del dia de la semana @day
+         * (0 es domingo), que es el que esta en vigor. Devuelve en @entry el punto y en
+         * @at su minuto contado desde el inicio del dia @day, que es negativo si el punto
+         * es de un dia anterior.
+         */
+        bool previous(uint8_t day, uint16_t minute, const DomDomTimelineEntry *&entry, int32_t &at) const;
+        /**
+         * Busca el primer punto despues del minuto @minute del dia de la semana @day
+         * (0 es domingo). Devuelve en @entry el punto y en @at su minuto contado
+         * desde el inicio del dia @day, que pasa de SCHEDULE_MINUTES_PER_DAY si el punto
+         * es de un dia posterior.
+         */
+        bool next(uint8_t day, uint16_t minute, const DomDomTimelineEntry *&entry, int32_t &at) const;
+};
+
+#endif /* DOMDOM_SCHEDULETIMELINE_h */
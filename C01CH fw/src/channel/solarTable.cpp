@@ -0,0 +1,69 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "solarTable.h"
+#include "astronomy.h"
+#include <math.h>
+
+DomDomSolarTable::DomDomSolarTable()
+{
+    _sunrise = -1;
+    _sunset = -1;
+}
+
+void DomDomSolarTable::compile(uint32_t midnight, float latitude, float longitude, int32_t utcOffset)
+{
+    // La posicion del sol apenas cambia en un dia, la tomamos a mediodia
+    float declination, equation;
+    DomDomAstronomy::sun(DomDomAstronomy::daysSinceJ2000(midnight + 43200 - utcOffset), declination, equation);
+
+    float low = sinf(SCHEDULE_SOLAR_TWILIGHT * 3.14159265f / 180);
+    float peak = sinf(DomDomAstronomy::elevation(latitude, declination, 0) * 3.14159265f / 180);
+
+    _sunrise = -1;
+    _sunset = -1;
+    bool up = false;
+
+    for (int minute = 0; minute < INTENSITY_TABLE_SIZE; minute++)
+    {
+        float hourAngle = DomDomAstronomy::sunHourAngle(minute - utcOffset / 60.0f, longitude, equation);
+        float elevation = DomDomAstronomy::elevation(latitude, declination, hourAngle);
+
+        bool visible = elevation >= DomDomAstronomy::SUNRISE_ELEVATION;
+        if (visible && !up && minute > 0)
+        {
+            _sunrise = minute;
+        }
+        else if (!visible && up)
+        {
+            _sunset = minute;
+        }
+        up = visible;
+
+        // En la noche polar no hay luz
+        float fraction = peak > low ? (sinf(elevation * 3.14159265f / 180) - low) / (peak - low) : 0;
+        fraction = fraction < 0 ? 0 : (fraction > 1 ? 1 : fraction);
+
+        _intensity[minute] = (uint16_t)(fraction * UINT16_MAX + 0.5f);
+    }
+
+    _day = midnight / 86400;
+}
@@ -0,0 +1,97 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_SOLARTABLE_h
+#define DOMDOM_SOLARTABLE_h
+
+#include <stdint.h>
+#include "configuration.h"
+#include "intensityTable.h"
+
+/**
+ * Configuracion del modo de programacion solar
+ */
+struct DomDomSolarSettings
+{
+    /**
+     * Indica si la programacion sigue al sol en lugar de a los puntos de programacion
+     */
+    bool enabled = false;
+    /**
+     * Situacion (grados, norte y este positivos)
+     */
+    float latitude = SCHEDULE_SOLAR_LATITUDE;
+    float longitude = SCHEDULE_SOLAR_LONGITUDE;
+    /**
+     * Valor en porcentaje (0-100%) de cada canal a plena intensidad
+     */
+    uint8_t value[CHANNEL_SIZE];
+    /**
+     * Constructor
+     */
+    DomDomSolarSettings()
+    {
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            value[c] = 100;
+        }
+    };
+};
+
+/**
+ * Tabla de intensidad solar de un dia.
+ *
+ * Se calcula una vez al dia a partir de la altura del sol en cada minuto.
+ * La intensidad sube desde el crepusculo (SCHEDULE_SOLAR_TWILIGHT) hasta
+ * el mediodia solar, donde siempre llega al maximo, y sigue el seno de
+ * la altura.
+ */
+class DomDomSolarTable : public DomDomIntensityTable
+{
+    private:
+        /**
+         * Minutos del dia del orto y del ocaso, -1 si el sol no sale o no se pone
+         */
+        int16_t _sunrise, _sunset;
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomSolarTable();
+        /**
+         * Calcula la tabla del dia que empieza en @midnight (hora local contada como unix,
+         * igual que el reloj interno) en la situacion @latitude, @longitude (grados) con
+         * una diferencia de @utcOffset segundos respecto a UTC.
+         */
+        void compile(uint32_t midnight, float latitude, float longitude, int32_t utcOffset);
+        /**
+         * Minuto del dia del orto, -1 si el sol no sale
+         */
+        int16_t sunrise() const { return _sunrise; };
+        /**
+         * Minuto del dia del ocaso, -1 si el sol no se pone
+         */
+        int16_t sunset() const { return _sunset; };
+};
+
+#endif /* DOMDOM_SOLARTABLE_h */
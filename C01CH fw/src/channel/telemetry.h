@@ -0,0 +1,188 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+#ifndef DOMDOM_TELEMETRY_h
+#define DOMDOM_TELEMETRY_h
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Causa del disparo de la proteccion de un canal
+ */
+enum DomDomChannelTrip
+{
+    TRIP_NONE = 0,
+    TRIP_OVERCURRENT = 1,
+    TRIP_OVERVOLTAGE = 2
+};
+
+/**
+ * Lecturas de un canal tomadas en la misma conversion del INA.
+ */
+struct DomDomChannelReading
+{
+    /**
+     * Ultimo voltaje leido en el bus
+     */
+    float busVoltage_V = 0;
+    /**
+     * Ultima corriente leida en el bus
+     */
+    float busCurrent_mA = 0;
+    /**
+     * Consigna de corriente de la rampa con el efecto de nubes y rayos
+     */
+    float setpoint_mA = 0;
+    /**
+     * Ultima potencia calculada
+     */
+    float busPower_W = 0;
+    /**
+     * Voltaje maximo detectado en el bus
+     */
+    float busVoltagePeak_V = 0;
+    /**
+     * Corriente maxima detectada
+     */
+    float busCurrentPeak_mA = 0;
+    /**
+     * Potencia maxima detectada
+     */
+    float busPowerPeak_W = 0;
+    /**
+     * Codigo DAC aplicado tras la lectura
+     */
+    uint8_t dac_pwm = 0;
+    /**
+     * Codigo DAC con decimales aplicado tras la lectura
+     */
+    float dac_code = 0;
+    /**
+     * Indica si la corriente se encontraba estable
+     */
+    bool stable = false;
+    /**
+     * Causa del disparo de la proteccion (TRIP_NONE si no ha saltado)
+     */
+    uint8_t trip = TRIP_NONE;
+    /**
+     * Indica si el INA esta en modo rapido (poco promedio)
+     */
+    bool fast_mode = false;
+    /**
+     * Tiempo (ms) acumulado en modo rapido y en modo lento
+     */
+    uint32_t fast_mode_ms = 0;
+    uint32_t slow_mode_ms = 0;
+    /**
+     * Numero de cambios de modo del INA
+     */
+    uint32_t mode_switches = 0;
+    /**
+     * Numero de conversion, permite detectar lecturas nuevas
+     */
+    uint32_t sample = 0;
+    /**
+     * Marca de tiempo (ms) de la lectura
+     */
+    uint32_t time_ms = 0;
+};
+
+/**
+ * Bloqueo de secuencia (seqlock) para un unico escritor.
+ *
+ * El escritor nunca espera, y los lectores repiten la copia si
+ * coincide con una escritura, de forma que siempre obtienen un
+ * valor completo de una misma publicacion. Si el escritor tiene
+ * menos prioridad y se queda a medias, el lector le cede la CPU
+ * tras unos pocos intentos en lugar de girar sin fin.
+ */
+template <typename T>
+class DomDomSeqLock
+{
+    private:
+        /**
+         * Contador de secuencia. Es impar mientras se esta escribiendo.
+         */
+        std::atomic<uint32_t> _seq;
+        /**
+         * Valor publicado
+         */
+        T _value;
+        /**
+         * Intentos seguidos antes de ceder la CPU al escritor
+         */
+        static const uint8_t SPIN_RETRIES = 4;
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomSeqLock() : _seq(0) {};
+        /**
+         * Publica un nuevo valor. Solo debe llamarse desde una tarea.
+         */
+        void write(const T &value)
+        {
+            uint32_t seq = _seq.load(std::memory_order_relaxed);
+            _seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            _value = value;
+
+            _seq.store(seq + 2, std::memory_order_release);
+        };
+        /**
+         * Devuelve una copia del ultimo valor publicado.
+         */
+        T read() const
+        {
+            T value;
+            uint32_t before, after;
+            uint8_t retries = 0;
+
+            while (true)
+            {
+                before = _seq.load(std::memory_order_acquire);
+                value = _value;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = _seq.load(std::memory_order_relaxed);
+
+                if (!(before & 1) && before == after)
+                {
+                    break;
+                }
+
+                // Un escritor expulsado a mitad de escritura solo termina si le dejamos correr
+                if (++retries >= SPIN_RETRIES)
+                {
+                    retries = 0;
+                    vTaskDelay(1);
+                }
+            }
+
+            return value;
+        };
+};
+
+#endif /* DOMDOM_TELEMETRY_h */
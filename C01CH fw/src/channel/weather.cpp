@@ -0,0 +1,159 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "weather.h"
+
+/**
+ * Si el consultor se para mas de esto (ms) la secuencia sigue desde el instante actual
+ */
+static const uint32_t MAX_CATCH_UP_MS = 3600000;
+
+DomDomWeather::DomDomWeather()
+{
+    configure(DomDomWeatherSettings(), 0);
+}
+
+uint32_t DomDomWeather::random()
+{
+    // xorshift32
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+
+    return _state;
+}
+
+uint32_t DomDomWeather::uniform(uint32_t low, uint32_t high)
+{
+    if (high <= low)
+    {
+        return low;
+    }
+
+    return low + (uint32_t)(((uint64_t)random() * (high - low + 1)) >> 32);
+}
+
+void DomDomWeather::configure(const DomDomWeatherSettings &settings, uint32_t now_ms)
+{
+    _settings = settings;
+
+    // Mezclamos la semilla para que semillas parecidas den secuencias distintas. El
+    // estado del xorshift nunca puede ser cero
+    uint32_t seed = settings.seed * 0x9E3779B9UL;
+    seed ^= seed >> 16;
+    _state = seed != 0 ? seed : 0x6D2B79F5UL;
+
+    nextCloud(now_ms);
+    nextFlash(now_ms);
+}
+
+void DomDomWeather::nextCloud(uint32_t after)
+{
+    _cloud_length = 0;
+    _cloud_start = after;
+    if (_settings.clouds_per_hour == 0)
+    {
+        return;
+    }
+
+    // Huecos entre la mitad y vez y media de la media
+    uint32_t mean = 3600000UL / _settings.clouds_per_hour;
+    _cloud_start = after + uniform(mean / 2, mean + mean / 2);
+    _cloud_length = uniform(_settings.cloud_min_s, _settings.cloud_max_s) * 1000UL;
+    _cloud_length = _cloud_length > 0 ? _cloud_length : 1000;
+    _cloud_depth = uniform(_settings.cloud_depth / 2 * WEATHER_ONE / 100, _settings.cloud_depth * WEATHER_ONE / 100);
+}
+
+void DomDomWeather::nextFlash(uint32_t after)
+{
+    _flash_length = 0;
+    _flash_start = after;
+    if (_settings.flashes_per_hour == 0)
+    {
+        return;
+    }
+
+    uint32_t mean = 3600000UL / _settings.flashes_per_hour;
+    _flash_start = after + uniform(mean / 2, mean + mean / 2);
+    _flash_length = uniform(WEATHER_FLASH_MIN_MS, WEATHER_FLASH_MAX_MS);
+    _flash_level = uniform(_settings.flash_intensity / 2 * WEATHER_ONE / 100, _settings.flash_intensity * WEATHER_ONE / 100);
+}
+
+DomDomWeatherSample DomDomWeather::sample(uint32_t now_ms)
+{
+    DomDomWeatherSample sample;
+    if (!_settings.enabled)
+    {
+        return sample;
+    }
+
+    // Los instantes se comparan por diferencia para aguantar el desbordamiento de millis()
+    if (_cloud_length > 0)
+    {
+        while ((int32_t)(now_ms - _cloud_start) >= (int32_t)_cloud_length)
+        {
+            uint32_t end = _cloud_start + _cloud_length;
+            nextCloud(now_ms - end > MAX_CATCH_UP_MS ? now_ms : end);
+        }
+
+        int32_t elapsed = now_ms - _cloud_start;
+        if (elapsed >= 0)
+        {
+            // Triangulo suavizado (3t^2 - 2t^3) que baja y vuelve a subir
+            uint64_t u = ((uint64_t)elapsed << 16) / _cloud_length;
+            uint64_t t = u < 32768 ? 2 * u : 2 * (65536 - u);
+            uint64_t shape = (((t * t) >> 16) * (3 * 65536 - 2 * t)) >> 16;
+            sample.dim = WEATHER_ONE - (uint32_t)((_cloud_depth * shape) >> 16);
+        }
+    }
+
+    if (_flash_length > 0)
+    {
+        while ((int32_t)(now_ms - _flash_start) >= (int32_t)_flash_length)
+        {
+            uint32_t end = _flash_start + _flash_length;
+            nextFlash(now_ms - end > MAX_CATCH_UP_MS ? now_ms : end);
+        }
+
+        // El destello sube de golpe y decae hasta el final
+        int32_t elapsed = now_ms - _flash_start;
+        if (elapsed >= 0)
+        {
+            sample.flash = (uint32_t)(((uint64_t)_flash_level * (_flash_length - elapsed)) / _flash_length);
+        }
+    }
+
+    return sample;
+}
+
+float DomDomWeather::apply(const DomDomWeatherSample &sample, float setpoint_mA, float minimum_mA, float maximum_mA)
+{
+    // Con el canal apagado o al minimo no hay efecto, un rayo no enciende un canal apagado
+    if (setpoint_mA <= minimum_mA || !sample.active())
+    {
+        return setpoint_mA;
+    }
+
+    float value = minimum_mA + (setpoint_mA - minimum_mA) * sample.dim / (float)WEATHER_ONE;
+    value += (maximum_mA - value) * sample.flash / (float)WEATHER_ONE;
+
+    return value;
+}
@@ -0,0 +1,164 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_WEATHER_h
+#define DOMDOM_WEATHER_h
+
+#include <stdint.h>
+#include "configuration.h"
+
+/**
+ * Unidad de los factores del efecto en coma fija (Q16): 1.0 = 65536
+ */
+#define WEATHER_ONE     65536UL
+
+/**
+ * Configuracion del efecto de nubes y tormenta
+ */
+struct DomDomWeatherSettings
+{
+    /**
+     * Indica si el efecto esta activo
+     */
+    bool enabled = false;
+    /**
+     * Semilla del generador. Con la misma semilla se repiten las mismas nubes y rayos
+     */
+    uint32_t seed = WEATHER_SEED;
+    /**
+     * Nubes por hora de media (0 sin nubes)
+     */
+    uint16_t clouds_per_hour = WEATHER_CLOUDS_PER_HOUR;
+    /**
+     * Atenuacion maxima (%) de una nube
+     */
+    uint8_t cloud_depth = WEATHER_CLOUD_DEPTH;
+    /**
+     * Duracion minima y maxima (s) de una nube
+     */
+    uint16_t cloud_min_s = WEATHER_CLOUD_MIN_S;
+    uint16_t cloud_max_s = WEATHER_CLOUD_MAX_S;
+    /**
+     * Rayos por hora de media (0 sin tormenta)
+     */
+    uint16_t flashes_per_hour = WEATHER_FLASHES_PER_HOUR;
+    /**
+     * Intensidad maxima (%) de un destello, hacia la corriente maxima del canal
+     */
+    uint8_t flash_intensity = WEATHER_FLASH_INTENSITY;
+};
+
+/**
+ * Efecto en un instante
+ */
+struct DomDomWeatherSample
+{
+    /**
+     * Fraccion de la consigna que deja pasar la nube (Q16, WEATHER_ONE sin nube)
+     */
+    uint32_t dim = WEATHER_ONE;
+    /**
+     * Fraccion del camino hasta la corriente maxima del destello (Q16, 0 sin rayo)
+     */
+    uint32_t flash = 0;
+    /**
+     * Indica si hay una nube o un rayo en curso
+     */
+    bool active() const { return dim != WEATHER_ONE || flash != 0; };
+};
+
+/**
+ * Generador de nubes y rayos.
+ *
+ * Las nubes son bajadas suaves de la intensidad y los rayos destellos
+ * que decaen en unas decenas de milisegundos. Los tiempos, duraciones e
+ * intensidades salen de un generador pseudoaleatorio xorshift con semilla,
+ * de forma que cada suceso depende solo de la semilla y de los anteriores,
+ * no de cuando se consulta, y una simulacion se puede repetir.
+ *
+ * No reserva memoria y cada consulta son unas pocas operaciones enteras,
+ * por lo que se evalua en cada iteracion del bucle de control.
+ *
+ * No depende del framework de Arduino para poder compilarse en el host.
+ */
+class DomDomWeather
+{
+    private:
+        /**
+         * Configuracion actual
+         */
+        DomDomWeatherSettings _settings;
+        /**
+         * Estado del generador pseudoaleatorio
+         */
+        uint32_t _state;
+        /**
+         * Nube actual o siguiente: inicio (ms), duracion (ms) y atenuacion (Q16)
+         */
+        uint32_t _cloud_start, _cloud_length, _cloud_depth;
+        /**
+         * Rayo actual o siguiente: inicio (ms), duracion (ms) e intensidad (Q16)
+         */
+        uint32_t _flash_start, _flash_length, _flash_level;
+        /**
+         * Siguiente numero del generador
+         */
+        uint32_t random();
+        /**
+         * Numero del generador entre @low y @high, ambos incluidos
+         */
+        uint32_t uniform(uint32_t low, uint32_t high);
+        /**
+         * Prepara la siguiente nube despues del instante @after (ms)
+         */
+        void nextCloud(uint32_t after);
+        /**
+         * Prepara el siguiente rayo despues del instante @after (ms)
+         */
+        void nextFlash(uint32_t after);
+
+    public:
+        /**
+         * Constructor
+         */
+        DomDomWeather();
+        /**
+         * Cambia la configuracion y vuelve a empezar la secuencia de la semilla en @now_ms.
+         */
+        void configure(const DomDomWeatherSettings &settings, uint32_t now_ms);
+        /**
+         * Configuracion actual
+         */
+        const DomDomWeatherSettings &settings() const { return _settings; };
+        /**
+         * Devuelve el efecto en el instante @now_ms. Los instantes de consultas
+         * sucesivas no pueden ir hacia atras.
+         */
+        DomDomWeatherSample sample(uint32_t now_ms);
+        /**
+         * Aplica el efecto @sample a la consigna @setpoint_mA de un canal entre
+         * @minimum_mA y @maximum_mA.
+         */
+        static float apply(const DomDomWeatherSample &sample, float setpoint_mA, float minimum_mA, float maximum_mA);
+};
+
+#endif /* DOMDOM_WEATHER_h */
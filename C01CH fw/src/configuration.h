@@ -16,6 +16,12 @@
 // Define la velocidad de comunicación del puerto COM
 #define BAUDRATE 9600
 
+//===========================================================================
+//============================ TASKS SECTION ================================
+//===========================================================================
+// Tiempo maximo (ms) que se espera a que una tarea termine al pararla
+#define TASK_STOP_TIMEOUT       5000
+
 //===========================================================================
 //============================ STATUS LED CONTROL  ==========================
 //===========================================================================
@@ -69,12 +75,93 @@
 //============================ CHANNELS SECTION =============================
 //===========================================================================
 
+// Numero de canales. El ESP32 solo tiene dos salidas DAC (pines 25 y 26)
 #define CHANNEL_SIZE                    1
 #define CHANNEL_RESOLUTION              8
 #define CHANNEL_MAX_LEDS_CONFIG         10
 #define CHANNEL_CURRENT_PIN             { 25 }
+// Direccion I2C del INA de cada canal
+#define CHANNEL_INA_ADDRESS             { 0x40 }
 #define CHANNEL_BUS_REFRESH_INTERVAL    10000
-#define CHANNEL_PERCENTAGE_MIN_STEP     5
+// Pin ALERT del INA (solo INA226/230/231/260). -1 para consultar siempre por I2C
+#define CHANNEL_INA_ALERT_PIN           { 27 }
+// Tiempo maximo esperando la alerta antes de consultar por I2C (ms)
+#define CHANNEL_INA_ALERT_TIMEOUT       2000
+// Resistencia del shunt (micro ohmios) y corriente maxima esperada (A) de los INA
+#define CHANNEL_SHUNT_MICRO_OHM         100000
+#define CHANNEL_INA_MAXIMUM_AMPS        3
+// 1 = el pin ALERT corta el canal por sobrecorriente desde su interrupcion en lugar de avisar del
+// fin de conversion, que se consulta por I2C. El INA solo tiene un limite: el de sobretension
+// (maximum_V) no se programa y se vigila por software en cada conversion
+#define CHANNEL_TRIP_HARDWARE           1
+// Margen sobre maximum_mA y maximum_V a partir del cual se corta el canal
+#define CHANNEL_TRIP_MARGIN             0.2
+// Pendiente maxima por defecto de la consigna (mA/s). 0 sin limite, asi los pasos sin fundido
+// de la programacion y los tests no se retrasan. Cada canal puede fijarla con max_slew
+#define CHANNEL_RAMP_MAX_SLEW           0
+// Pendiente maxima admitida (mA/s). Por encima el paso es practicamente instantaneo
+#define CHANNEL_RAMP_MAX_SLEW_LIMIT     100000
+// Modulacion sigma-delta entre codigos DAC vecinos para tener codigos con decimales
+#define CHANNEL_DITHER_ENABLED          1
+// Bits de fraccion. Con 4 bits el patron mas lento se repite a FREQUENCY/16 Hz
+#define CHANNEL_DITHER_BITS             4
+#define CHANNEL_DITHER_FREQUENCY        20000
+#define CHANNEL_DITHER_TIMER            0
+// Promedio y tiempo de conversion (us) del INA con la corriente estable
+#define CHANNEL_INA_AVERAGING               64
+#define CHANNEL_INA_CONVERSION_TIME         8244
+// Promedio y tiempo de conversion (us) del INA mientras la corriente converge
+#define CHANNEL_INA_FAST_AVERAGING          4
+#define CHANNEL_INA_FAST_CONVERSION_TIME    1100
+// Lecturas estables seguidas antes de pasar al promedio lento
+#define CHANNEL_INA_SLOW_AFTER_STABLE       5
+// Error (veces la tolerancia) que devuelve el INA al modo rapido
+#define CHANNEL_INA_FAST_ERROR_FACTOR       3
+
+// Curva de brillo por defecto: 0 lineal, 1 CIE 1931, 2 gamma, 3 personalizada
+#define CHANNEL_BRIGHTNESS_CURVE            0
+#define CHANNEL_BRIGHTNESS_GAMMA            2.2
+// Curva personalizada: corriente (%) para 0%, 10%, ... 100% de brillo
+#define CHANNEL_BRIGHTNESS_CUSTOM_POINTS    { 0, 1, 3, 6, 11, 18, 27, 39, 54, 74, 100 }
+
+// Ganancias por defecto del controlador PI (codigos DAC por mA). La integral esta limitada
+// por las conversiones lentas (~1 s), con mas de 0.3 la carga simulada oscila en ese modo
+#define CHANNEL_CONTROL_KP                  0.02
+#define CHANNEL_CONTROL_KI                  0.25
+// Ganancias maximas que se aceptan en la configuracion
+#define CHANNEL_CONTROL_KP_MAX              1
+#define CHANNEL_CONTROL_KI_MAX              1
+// Tolerancia para considerar la corriente estable (fraccion de maximum_mA)
+#define CHANNEL_CONTROL_TOLERANCE           0.01
+#define CHANNEL_CONTROL_MIN_TOLERANCE_MA    2
+// Lecturas por debajo de este valor no se usan para aprender la recta DAC->mA
+#define CHANNEL_CONTROL_LEARN_MIN_MA        1
+// Error que se aplica cuando se supera el voltaje maximo
+#define CHANNEL_CONTROL_VOLTAGE_BACKOFF_MA  5
+// Promedio del INA durante el barrido de calibracion
+#define CHANNEL_CALIBRATION_AVERAGING       4
+// Tiempo minimo entre escrituras de la tabla de calibracion refinada (ms)
+#define CHANNEL_CALIBRATION_SAVE_INTERVAL   3600000
+// Tiempo entre escrituras de los contadores de energia de todos los canales (ms)
+#define CHANNEL_ENERGY_SAVE_INTERVAL        3600000
+
+//===========================================================================
+//============================ WEATHER SECTION ==============================
+//===========================================================================
+// Valores por defecto del efecto de nubes y tormenta sobre la programacion
+#define WEATHER_SEED                1
+#define WEATHER_CLOUDS_PER_HOUR     20
+// Atenuacion maxima (%) de una nube y su duracion minima y maxima (s)
+#define WEATHER_CLOUD_DEPTH         50
+#define WEATHER_CLOUD_MIN_S         10
+#define WEATHER_CLOUD_MAX_S         90
+// Rayos por hora (0 sin tormenta) e intensidad maxima (%) de cada destello, como fraccion
+// del camino hasta la corriente maxima. Un salto hasta el maximo puede disparar la proteccion
+#define WEATHER_FLASHES_PER_HOUR    0
+#define WEATHER_FLASH_INTENSITY     50
+// Duracion minima y maxima (ms) de un destello
+#define WEATHER_FLASH_MIN_MS        40
+#define WEATHER_FLASH_MAX_MS        200
 
 //===========================================================================
 //============================ FAN SECTION =============================
@@ -83,6 +170,24 @@
 #define FAN_PWM_RESOLUTION              10
 #define FAN_PWM_CHANNEL                 12
 
+//===========================================================================
+//============================ SCHEDULE SECTION =============================
+//===========================================================================
+// Tiempo maximo (ms) que el programador duerme sin volver a comprobar la programacion
+#define SCHEDULE_MAX_SLEEP      3600000
+// Avance (%) de un fundido que hace despertar al programador para mover la rampa
+#define SCHEDULE_FADE_STEP      1
+// Situacion (grados) por defecto de la programacion solar, la de la zona horaria por defecto
+#define SCHEDULE_SOLAR_LATITUDE     40.4168f
+#define SCHEDULE_SOLAR_LONGITUDE    -3.7038f
+// Altura del sol (grados) a la que empieza a haber luz en la programacion solar (crepusculo civil)
+#define SCHEDULE_SOLAR_TWILIGHT     -6.0f
+// Valor por defecto y maximo (%) de la luz de luna con la luna llena, cerca del minimo de los canales
+#define SCHEDULE_MOON_PERCENT       5
+#define SCHEDULE_MOON_MAX_PERCENT   10
+// Altura de la luna (grados) a la que su luz llega al maximo
+#define SCHEDULE_MOON_FADE_ELEVATION 10.0f
+
 //===========================================================================
 //===================== RTC Y  NTP SECTION ==================================
 //===========================================================================
@@ -101,10 +206,15 @@
 //============================ EEPROM SECTION ===============================
 //===========================================================================
 
-#define EEPROM_SIZE                             EEPROM_FAN_ENABLED_ADDRESS
+#define EEPROM_SIZE                             (EEPROM_WEATHER_ADDRESS + EEPROM_WEATHER_SIZE)
 #define EEPROM_INIT_RETRIES                     10
 #define EEPROM_INA_SIZE                         512
 
+// Version de la distribucion de la memoria. Si la guardada es otra se inicializan los bloques
+// añadidos desde la primera version (control, calibracion, canales extra, energia, sol, luna y nubes)
+#define EEPROM_LAYOUT_VERSION_ADDRESS           2
+#define EEPROM_LAYOUT_VERSION                   2
+
 #define EEPROM_STA_SSID_NAME_ADDRESS            4
 #define EEPROM_SSID_NAME_LENGTH                 32
 #define EEPROM_STA_PASSWORD_ADDRESS             EEPROM_STA_SSID_NAME_ADDRESS + EEPROM_SSID_NAME_LENGTH
@@ -118,7 +228,7 @@
 #define EEPROM_MAX_SCHEDULE_POINTS              50
 #define EEPROM_SCHEDULE_STATUS_ADDRESS          EEPROM_CHANNEL_FIRST_ADDRESS + EEPROM_CHANNEL_MEMORY_SIZE + (EEPROM_CHANNEL_LED_MEMORY_SIZE * EEPROM_CHANNEL_LED_COUNT)
 #define EEPROM_SCHEDULE_FIRST_ADDRESS           EEPROM_SCHEDULE_STATUS_ADDRESS + 1
-#define EEPROM_SCHEDULEPOINT_SIZE               5
+#define EEPROM_SCHEDULEPOINT_SIZE               (4 + CHANNEL_SIZE)
 
 #define EEPROM_NTP_ENABLED_ADDRESS              EEPROM_SCHEDULE_FIRST_ADDRESS + (EEPROM_SCHEDULEPOINT_SIZE * EEPROM_MAX_SCHEDULE_POINTS )
 
@@ -134,4 +244,32 @@
 #define EEPROM_NTP_TIMEZONEPOSIX_LENGTH         32
 
 #define EEPROM_FAN_ENABLED_ADDRESS              EEPROM_NTP_TIMEZONEPOSIX_ADDRESS + EEPROM_NTP_TIMEZONEPOSIX_LENGTH
+#define EEPROM_FAN_MEMORY_SIZE                  11
+
+#define EEPROM_CHANNEL_CONTROL_ADDRESS          EEPROM_FAN_ENABLED_ADDRESS + EEPROM_FAN_MEMORY_SIZE
+#define EEPROM_CHANNEL_CONTROL_SIZE             13
+
+// Calibracion: valida + ultimo codigo medido + mA y mV de cada codigo
+#define EEPROM_CHANNEL_CALIBRATION_SIZE         (1 + 1 + (256 * 4))
+#define EEPROM_CHANNEL_CONTROL_BLOCK_SIZE       (EEPROM_CHANNEL_CONTROL_SIZE + EEPROM_CHANNEL_CALIBRATION_SIZE)
+
+// El primer canal se guarda en EEPROM_CHANNEL_FIRST_ADDRESS, el resto a continuacion
+#define EEPROM_CHANNEL_EXTRA_ADDRESS            EEPROM_CHANNEL_CONTROL_ADDRESS + (CHANNEL_SIZE * EEPROM_CHANNEL_CONTROL_BLOCK_SIZE)
+#define EEPROM_CHANNEL_SLOT_SIZE                (21 + (EEPROM_CHANNEL_LED_MEMORY_SIZE * EEPROM_CHANNEL_LED_COUNT))
+
+// Contadores de energia: valido + 7 double + 3 int
+#define EEPROM_CHANNEL_ENERGY_ADDRESS           EEPROM_CHANNEL_EXTRA_ADDRESS + ((CHANNEL_SIZE - 1) * EEPROM_CHANNEL_SLOT_SIZE)
+#define EEPROM_CHANNEL_ENERGY_SIZE              (1 + (7 * 8) + (3 * 4))
+
+// Programacion solar: activa + latitud + longitud + valor de cada canal
+#define EEPROM_SCHEDULE_SOLAR_ADDRESS           EEPROM_CHANNEL_ENERGY_ADDRESS + (CHANNEL_SIZE * EEPROM_CHANNEL_ENERGY_SIZE)
+#define EEPROM_SCHEDULE_SOLAR_SIZE              (1 + (2 * 4) + CHANNEL_SIZE)
+
+// Luz de luna: activa + valor de cada canal
+#define EEPROM_SCHEDULE_MOON_ADDRESS            EEPROM_SCHEDULE_SOLAR_ADDRESS + EEPROM_SCHEDULE_SOLAR_SIZE
+#define EEPROM_SCHEDULE_MOON_SIZE               (1 + CHANNEL_SIZE)
+
+// Efecto de nubes y tormenta: activo + semilla + nubes/h + profundidad + duraciones + rayos/h + intensidad
+#define EEPROM_WEATHER_ADDRESS                  EEPROM_SCHEDULE_MOON_ADDRESS + EEPROM_SCHEDULE_MOON_SIZE
+#define EEPROM_WEATHER_SIZE                     (1 + 4 + 2 + 1 + (2 * 2) + 2 + 1)
 #endif /* GLOBAL_CONFIGURACION_h */
\ No newline at end of file
@@ -21,16 +21,14 @@
 #include "fanControl.h"
 #include "configuration.h"
 #include <EEPROM.h>
-#include "../channel/channel.h"
+#include "../channel/channelMgt.h"
 
 DomDomFanControlClass::DomDomFanControlClass(){}
 
 void DomDomFanControlClass::begin()
 {
-    if (!_started)
+    if (!isStarted())
     {
-        _started = true;
-
         pinMode(FAN_PWM_PIN, OUTPUT);
 
         min_pwm = 0;
@@ -49,44 +47,46 @@ void DomDomFanControlClass::begin()
         // init PWM
         ledcWrite(FAN_PWM_CHANNEL, min_pwm); 
 
-        xTaskCreate(
-            this->fanTask,          /* Task function. */
-            "fantTask",             /* String with name of task. */
-            10000,                  /* Stack size in bytes. */
-            NULL,                   /* Parameter passed as input of the task */
-            1,                      /* Priority of the task. */
-            NULL                    /* Task handle. */
-        );
+        _task.start(fanTask, "fantTask", 10000, this);
     }
 }
 
 void DomDomFanControlClass::end()
 {
-    if (_started)
-    {
-        _started = false;
-    }
+    _task.stop();
 }
 
 void DomDomFanControlClass::fanTask(void * parameter)
 {
-    while(DomDomFanControl.isStarted())
+    DomDomFanControlClass *fan = (DomDomFanControlClass *)parameter;
+
+    while(fan->_task.running())
     {
-        DomDomFanControl.update();
-        vTaskDelay(5000 / portTICK_PERIOD_MS);
+        fan->update();
+        fan->_task.sleep(5000);
     }
 
-    vTaskDelete(NULL);
+    fan->_task.finish();
 }
 
 void DomDomFanControlClass::update()
 {
-    if (DomDomChannel.started())
+    // El ventilador sigue al canal con mayor porcentaje
+    int porcentaje_canal = -1;
+    for (int c = 0; c < CHANNEL_SIZE; c++)
     {
-        int rango_canal = DomDomChannel.maximum_mA - DomDomChannel.minimum_mA;
-        int valor_canal = DomDomChannel.target_mA - DomDomChannel.minimum_mA;
-        int porcentaje_canal = valor_canal * 100 / rango_canal;
+        DomDomChannelClass *channel = DomDomChannelMgt.channels[c];
+        if (channel->started())
+        {
+            int rango_canal = channel->maximum_mA - channel->minimum_mA;
+            int valor_canal = channel->target_mA - channel->minimum_mA;
+            int porcentaje = rango_canal > 0 ? valor_canal * 100 / rango_canal : 0;
+            porcentaje_canal = porcentaje > porcentaje_canal ? porcentaje : porcentaje_canal;
+        }
+    }
 
+    if (porcentaje_canal >= 0)
+    {
         int rango_fan = max_channel_value - min_channel_value;
         int valor_fan = porcentaje_canal - min_channel_value;
         int porcentaje_fan = valor_fan * 100 / rango_fan;
@@ -131,7 +131,7 @@ void DomDomFanControlClass::setCurrentPWM(uint16_t pwm)
 bool DomDomFanControlClass::save()
 {
     int address = EEPROM_FAN_ENABLED_ADDRESS;
-    EEPROM.writeBool(address, _started);
+    EEPROM.writeBool(address, isStarted());
     address += 1;
     EEPROM.writeUShort(address, max_pwm);
     address += 2;
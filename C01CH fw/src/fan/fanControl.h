@@ -24,6 +24,7 @@
 
 #include <Arduino.h>
 #include "configuration.h"
+#include "../task/managedTask.h"
 
 /**
  * Clase para el control del ventilador
@@ -35,11 +36,11 @@ class DomDomFanControlClass
 {
     private:
         /**
-         * Indica si el proceso está activado.
+         * Tarea de control. Mientras esta en marcha el proceso está activado.
          */
-        bool _started = false;
+        DomDomManagedTask _task;
         /**
-         * Tarea de control.
+         * Tarea de control. Recibe el objeto como parametro.
          */
         static void fanTask(void * parameter);
         /**
@@ -81,7 +82,7 @@ class DomDomFanControlClass
          */
         void begin();
         /**
-         * Para el proceso de control de ventilador.
+         * Para el proceso de control de ventilador y espera a que termine.
          */
         void end();
         /**
@@ -91,7 +92,7 @@ class DomDomFanControlClass
         /**
          * Indica si el control de ventilador esta activo
          */
-        bool isStarted() const {return _started; };
+        bool isStarted() const {return _task.running(); };
         /**
          * Establece el PWM para el ventialdor
          */
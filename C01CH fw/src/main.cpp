@@ -23,7 +23,7 @@
 #include <Wire.h>
 #include "configuration.h"
 #include "statusLedControl/statusLedControl.h"
-#include "channel/channel.h"
+#include "channel/channelMgt.h"
 #include "wifi/WiFi.h"
 #include "rtc/rtc.h"
 #include "webServer/webServer.h"
@@ -93,10 +93,10 @@ void setup()
   // Iniciamos el servidor web
   DomDomWebServer.begin();
 
-  // configuramos el canal
-  DomDomChannel.loadFromEEPROM();
- // Iniciamos el canal
-  DomDomChannel.begin();  
+  // configuramos los canales
+  DomDomChannelMgt.loadFromEEPROM();
+ // Iniciamos los canales
+  DomDomChannelMgt.begin();  
 
   // Puntos de programacion
   DomDomScheduleMgt.load();
@@ -106,7 +106,10 @@ void setup()
   {
       DomDomScheduleMgt.begin();
   }else{
-    DomDomChannel.setTargetmA(DomDomChannel.target_mA);
+    for (int i = 0; i < CHANNEL_SIZE; i++)
+    {
+      DomDomChannelMgt.channels[i]->setTargetmA(DomDomChannelMgt.channels[i]->target_mA);
+    }
   }
 
   // Ventilador
@@ -0,0 +1,234 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Simulacion de los canales en el host (env:native).
+ *
+ * Conecta a la placa simulada un INA226 con su carga por cada canal,
+ * arranca el gestor de canales como en el equipo y lleva la corriente
+ * a la consigna, mostrando una lectura por segundo simulado.
+ *
+ * Uso: program [-t segundos] [-s velocidad] [-m consigna_mA] [-M maximo_mA]
+ *              [-V maximo_V] [-r rampa_ms] [-w semilla] [-c] [-q]
+ *
+ *  -w  activa las nubes y una tormenta con la semilla indicada
+ *  -c  hace el barrido de calibracion antes de fijar la consigna
+ *  -q  no muestra el log del firmware
+ *
+ * Los tests (pio test -e native) compilan tambien el resto de src/ con su
+ * propio main(), asi que entonces la simulacion no se compila.
+ */
+
+#if !defined(PIO_UNIT_TESTING)
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <simBoard.h>
+#include <simClock.h>
+#include <simINA226.h>
+#include "configuration.h"
+#include "EEPROMHelper.h"
+#include "channel/channelMgt.h"
+#include "log/logger.h"
+
+struct SimulationOptions
+{
+    uint32_t seconds = 30;
+    double speed = 1;
+    float target_mA = 200;
+    float maximum_mA = 500;
+    float maximum_V = 12;
+    uint32_t ramp_ms = 0;
+    bool weather = false;
+    uint32_t seed = 0;
+    bool calibrate = false;
+    bool quiet = false;
+};
+
+static bool parseOptions(int argc, char **argv, SimulationOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        String option = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (option == "-t" && has_value)        options.seconds = atoi(argv[++i]);
+        else if (option == "-s" && has_value)   options.speed = atof(argv[++i]);
+        else if (option == "-m" && has_value)   options.target_mA = atof(argv[++i]);
+        else if (option == "-M" && has_value)   options.maximum_mA = atof(argv[++i]);
+        else if (option == "-V" && has_value)   options.maximum_V = atof(argv[++i]);
+        else if (option == "-r" && has_value)   options.ramp_ms = atoi(argv[++i]);
+        else if (option == "-w" && has_value)
+        {
+            options.weather = true;
+            options.seed = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (option == "-c")                options.calibrate = true;
+        else if (option == "-q")                options.quiet = true;
+        else
+        {
+            fprintf(stderr, "Uso: %s [-t segundos] [-s velocidad] [-m consigna_mA] [-M maximo_mA] [-V maximo_V] [-r rampa_ms] [-w semilla] [-c] [-q]\n", argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void printReading(DomDomChannelClass *channel)
+{
+    DomDomChannelReading reading = channel->reading();
+
+    Serial.printf("%8.3f\tCH%d\t%8.2f\t%8.2f\t%6.3f\t%7.2f\t%s\t%s\t%u\n",
+        reading.time_ms / 1000.0,
+        channel->getNum(),
+        reading.setpoint_mA,
+        reading.busCurrent_mA,
+        reading.busVoltage_V,
+        reading.dac_code,
+        reading.stable ? "estable" : "-",
+        reading.fast_mode ? "rapido" : "lento",
+        reading.trip);
+}
+
+/**
+ * Escribe el resumen de tiempos del bucle de control de @channel.
+ */
+void printTiming(DomDomChannelClass *channel)
+{
+    const char *phases[LOOP_PHASE_SIZE] = { "espera", "i2c", "calculo", "dac", "total" };
+    DomDomLoopStats stats = channel->timing();
+
+    Serial.printf("CH%d: %u iteraciones, %.1f Hz, jitter medio %u us, maximo %u us\n",
+        channel->getNum(), stats.phases[LOOP_PHASE_TOTAL].count, stats.rate_hz(), stats.jitter_mean_us(), stats.jitter_max_us);
+
+    for (uint8_t phase = 0; phase < LOOP_PHASE_SIZE; phase++)
+    {
+        const DomDomTimingHistogram &histogram = stats.phases[phase];
+        Serial.printf("  %-8s min %7u us  media %7u us  max %7u us\n",
+            phases[phase], histogram.count > 0 ? histogram.min_us : 0, histogram.mean_us(), histogram.max_us);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    SimulationOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+
+    DomDomSimClock.setScale(options.speed);
+    DomDomLogger.output_serial_enabled = !options.quiet;
+    DomDomLogger.output_ram_enabled = false;
+
+    // Un INA con su carga por canal, cableados como en la placa
+    uint8_t addresses[CHANNEL_SIZE] = CHANNEL_INA_ADDRESS;
+    int dac_pins[CHANNEL_SIZE] = CHANNEL_CURRENT_PIN;
+    int alert_pins[CHANNEL_SIZE] = CHANNEL_INA_ALERT_PIN;
+    for (uint8_t c = 0; c < CHANNEL_SIZE; c++)
+    {
+        DomDomSimBoard.addINA(new DomDomSimINA226(addresses[c], CHANNEL_SHUNT_MICRO_OHM, dac_pins[c], alert_pins[c]));
+    }
+    DomDomSimBoard.begin();
+
+    EEPROM.begin(EEPROM_SIZE + EEPROM_INA_SIZE);
+    EEPROMCheck();
+
+    DomDomChannelMgt.loadFromEEPROM();
+    for (uint8_t c = 0; c < CHANNEL_SIZE; c++)
+    {
+        DomDomChannelClass *channel = DomDomChannelMgt.channels[c];
+        channel->maximum_mA = options.maximum_mA;
+        channel->maximum_V = options.maximum_V;
+        channel->setEnabled(true);
+    }
+
+    // Nubes y rayos frecuentes para verlos en pocos segundos simulados
+    if (options.weather)
+    {
+        DomDomWeatherSettings weather;
+        weather.enabled = true;
+        weather.seed = options.seed;
+        weather.clouds_per_hour = 360;
+        weather.cloud_min_s = 2;
+        weather.cloud_max_s = 8;
+        weather.flashes_per_hour = 720;
+        DomDomChannelMgt.setWeather(weather);
+    }
+
+    if (!DomDomChannelMgt.begin())
+    {
+        fprintf(stderr, "No se ha podido iniciar ningun canal\n");
+        return 1;
+    }
+
+    if (options.calibrate)
+    {
+        for (uint8_t c = 0; c < CHANNEL_SIZE; c++)
+        {
+            DomDomChannelMgt.channels[c]->startCalibration();
+        }
+
+        for (uint8_t c = 0; c < CHANNEL_SIZE; c++)
+        {
+            while (DomDomChannelMgt.channels[c]->calibrating())
+            {
+                delay(100);
+            }
+        }
+    }
+
+    for (uint8_t c = 0; c < CHANNEL_SIZE; c++)
+    {
+        DomDomChannelMgt.channels[c]->setTargetmA(options.target_mA, options.ramp_ms);
+    }
+
+    Serial.printf("tiempo_s\tcanal\tconsigna\tmA\tV\tdac\testado\tmodo\tdisparo\n");
+    for (uint32_t s = 0; s < options.seconds; s++)
+    {
+        delay(1000);
+
+        for (uint8_t c = 0; c < CHANNEL_SIZE; c++)
+        {
+            if (DomDomChannelMgt.channels[c]->started())
+            {
+                printReading(DomDomChannelMgt.channels[c]);
+            }
+        }
+    }
+
+    for (uint8_t c = 0; c < CHANNEL_SIZE; c++)
+    {
+        if (DomDomChannelMgt.channels[c]->started())
+        {
+            printTiming(DomDomChannelMgt.channels[c]);
+        }
+    }
+
+    DomDomChannelMgt.end();
+    DomDomSimBoard.end();
+    EEPROM.commit();
+
+    return 0;
+}
+
+#endif /* PIO_UNIT_TESTING */
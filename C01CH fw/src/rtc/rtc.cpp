@@ -23,7 +23,9 @@
 #include "sys/time.h"
 #include <EEPROM.h>
 #include <Wire.h>
+#if !defined(DOMDOM_NATIVE)
 #include "../wifi/WiFi.h"
+#endif
 #include "configuration.h"
 #include "../log/logger.h"
 
@@ -31,6 +33,18 @@
 
 DomDomRTCClass::DomDomRTCClass(){}
 
+/**
+ * Indica si hay conexion para consultar el NTP. En el host no hay WiFi y el reloj no se ajusta por NTP.
+ */
+static bool NTPAvailable()
+{
+#if defined(DOMDOM_NATIVE)
+    return false;
+#else
+    return DomDomWifi.getMode() == 1;
+#endif
+}
+
 bool DomDomRTCClass::begin()
 {
     DomDomLogger.log(DomDomLoggerClass::LogLevel::info, "RTC", "Inicializando RTC...");
@@ -39,7 +53,7 @@ bool DomDomRTCClass::begin()
     timeClient = new NTPClient(_ntpUDP, _ntpServerName.c_str(), 0, 0);
     timeClient->begin();
 
-    if (DomDomWifi.getMode() == 1)
+    if (NTPAvailable())
     {
         ready = updateFromNTP();
         beginNTP();
@@ -63,7 +77,7 @@ bool DomDomRTCClass::begin()
 bool DomDomRTCClass::updateFromNTP()
 {
     bool result = false;
-    if (DomDomWifi.getMode() == 1)
+    if (NTPAvailable())
     {
         LastNTPCheck = millis();
         result = timeClient->forceUpdate();
@@ -80,50 +94,51 @@ bool DomDomRTCClass::updateFromNTP()
 
 void DomDomRTCClass::beginNTP()
 {
-    if (!_ntpStarted)
+    if (!NTPStarted())
     {
-        _ntpStarted = true;
-
-        xTaskCreate(
-            this->NTPTask,        /* Task function. */
-            "NTP_Task",             /* String with name of task. */
-            10000,                  /* Stack size in bytes. */
-            NULL,                   /* Parameter passed as input of the task */
-            1,                      /* Priority of the task. */
-            this->_ntp_task         /* Task handle. */
-        );
+        _ntp_task.start(NTPTask, "NTP_Task", 10000, this);
     }
 }
 
 void DomDomRTCClass::endNTP()
 {
-    if (_ntpStarted)
+    if (NTPStarted())
     {
-        _ntpStarted = false;
+        // La tarea puede estar esperando la respuesta del servidor
+        _ntp_task.stop();
         timeClient->end();
     }
 }
 
 void DomDomRTCClass::NTPTask(void * parameter)
 {
-    int ms = NTP_DELAY_ON_SUCCESS;
-    while(DomDomRTC.NTPStarted())
+    DomDomRTCClass *rtc = (DomDomRTCClass *)parameter;
+
+    unsigned long ms = NTP_DELAY_ON_SUCCESS;
+    while(rtc->_ntp_task.running())
     {
-        if (millis() - DomDomRTC.LastNTPCheck >= ms)
+        unsigned long elapsed = millis() - rtc->LastNTPCheck;
+        if (elapsed < ms)
+        {
+            rtc->_ntp_task.sleep(ms - elapsed);
+            continue;
+        }
+
+        if (rtc->updateFromNTP())
         {
-            if (DomDomRTC.updateFromNTP())
-            {
-                ms = NTP_DELAY_ON_SUCCESS;
-            }
-            else
-            {
-                ms = NTP_DELAY_ON_FAILURE;
-                DomDomLogger.log(DomDomLoggerClass::LogLevel::error,"RTC", "No se recibio respuesta del NTP");
-            }
+            ms = NTP_DELAY_ON_SUCCESS;
         }
+        else
+        {
+            ms = NTP_DELAY_ON_FAILURE;
+            DomDomLogger.log(DomDomLoggerClass::LogLevel::error,"RTC", "No se recibio respuesta del NTP");
+        }
+
+        // Tras un fallo LastNTPCheck no cambia, esperamos antes de reintentar
+        rtc->_ntp_task.sleep(ms);
     }
 
-    vTaskDelete(NULL);
+    rtc->_ntp_task.finish();
 }
 
 DateTime DomDomRTCClass::now()
@@ -135,6 +150,30 @@ DateTime DomDomRTCClass::now()
     return dt;
 }
 
+int32_t DomDomRTCClass::utcOffset(const DateTime &local)
+{
+    // El reloj interno guarda la hora local, la zona POSIX da la diferencia con UTC.
+    // Cerca de un cambio de hora puede equivocarse en esa hora, de sobra para un dia
+    tm timeinfo;
+    const char* zone = _ntpPosixZone.c_str();
+    setenv("TZ", zone, 1);
+    tzset();
+
+    time_t dt = local.unixtime();
+    localtime_r(&dt, &timeinfo);
+
+    DateTime shifted(
+        timeinfo.tm_year + 1900,
+        timeinfo.tm_mon + 1,
+        timeinfo.tm_mday,
+        timeinfo.tm_hour,
+        timeinfo.tm_min,
+        timeinfo.tm_sec
+    );
+
+    return (int32_t)shifted.unixtime() - (int32_t)dt;
+}
+
 void DomDomRTCClass::adjust(time_t dt)
 {
     // Reloj interno
@@ -161,6 +200,17 @@ void DomDomRTCClass::adjust(time_t dt)
     settimeofday((const timeval*)&epoch, 0);
 
     DomDomLogger.log(DomDomLoggerClass::LogLevel::debug,"RTC", "RTC interno ajustado a %s",nDate.timestamp().c_str());
+
+    if (_adjust_callback != nullptr)
+    {
+        _adjust_callback(_adjust_arg);
+    }
+}
+
+void DomDomRTCClass::onAdjust(void (*callback)(void *), void *arg)
+{
+    _adjust_arg = arg;
+    _adjust_callback = callback;
 }
 
 bool DomDomRTCClass::save()
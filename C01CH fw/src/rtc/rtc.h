@@ -28,6 +28,7 @@
 #include "../lib/NTPClient/NTPClient.h"
 #include <WiFiUdp.h>
 #include "../configuration.h"
+#include "../task/managedTask.h"
 
 /**
  * Clase encargada de la gestion de la hora.
@@ -41,15 +42,11 @@ class DomDomRTCClass
 {
     private:
         /**
-         * Indica si el servicio NTP esta activo o no.
+         * Tarea del NTP. Mientras esta en marcha el servicio NTP esta activo.
          */
-        bool _ntpStarted = false;
+        DomDomManagedTask _ntp_task;
         /**
-         * Puntero a la tarea del NTP
-         */
-        TaskHandle_t *_ntp_task;
-        /**
-         * Actualiza la hora por NTP.
+         * Actualiza la hora por NTP. Recibe el objeto como parametro.
          */
         static void NTPTask(void * parameter);
         /**
@@ -72,6 +69,11 @@ class DomDomRTCClass
          * Cliente NTP para la actualizacion de la hora por internet
          */
         NTPClient *timeClient;
+        /**
+         * Funcion a la que se avisa al ajustar la hora y su parametro
+         */
+        void (*_adjust_callback)(void *) = nullptr;
+        void *_adjust_arg = nullptr;
 
     public:
         /**
@@ -90,10 +92,18 @@ class DomDomRTCClass
          * Ajusta el RTC interno y externo con la nueva fecha y hora
          */
         void adjust(time_t dt);
+        /**
+         * Registra la funcion @callback, que recibe @arg, para avisar cada vez que se ajusta la hora.
+         */
+        void onAdjust(void (*callback)(void *), void *arg);
         /**
          * Devuelve la fecha y hora actual
          */
         DateTime now();
+        /**
+         * Devuelve la diferencia (segundos) de la hora local @local con UTC segun la zona horaria.
+         */
+        int32_t utcOffset(const DateTime &local);
         /**
          * Inicia el proceso completo para la gestion de la hora
          */
@@ -103,7 +113,7 @@ class DomDomRTCClass
          */
         void beginNTP();
         /**
-         * Para el servicio NTP.
+         * Para el servicio NTP y espera a que termine su tarea.
          */
         void endNTP();
         /**
@@ -121,7 +131,7 @@ class DomDomRTCClass
         /**
          * Indica si el NTP esta en ejecucion
          */
-        bool NTPStarted() const { return _ntpStarted; };
+        bool NTPStarted() const { return _ntp_task.running(); };
         /**
          * Devuelve la zona horaria en formato POSIX
          */
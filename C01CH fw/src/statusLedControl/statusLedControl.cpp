@@ -32,7 +32,6 @@ void DomDomStatusLedControlClass::begin()
 
     min_pwm = 0;
     max_pwm = pow(2, LED_STATUS_RESOLUTION);
-    blinking = false;
 
     // configure LED PWM functionalitites
     ledcSetup(LED_STATUS_CHANNEL, 5000, LED_STATUS_RESOLUTION);
@@ -49,16 +48,7 @@ void DomDomStatusLedControlClass::blinkInfinite()
 {
     if (!isBlinking())
     {
-        blinking = true;
-
-        xTaskCreate(
-            this->blinkTask,        /* Task function. */
-            "Blink_Task",             /* String with name of task. */
-            10000,                  /* Stack size in bytes. */
-            NULL,                   /* Parameter passed as input of the task */
-            1,                      /* Priority of the task. */
-            NULL                    /* Task handle. */
-        );
+        _blink_task.start(blinkTask, "Blink_Task", 10000, this);
     }
     
 }
@@ -87,19 +77,21 @@ void DomDomStatusLedControlClass::blink( int times)
 
 void DomDomStatusLedControlClass::blinkTask(void * parameter)
 {
-    DomDomStatusLedControl.block();
-    while (DomDomStatusLedControl.isBlinking())
+    DomDomStatusLedControlClass *led = (DomDomStatusLedControlClass *)parameter;
+
+    led->block();
+    while (led->isBlinking())
     {
-        ledcWrite(LED_STATUS_CHANNEL, DomDomStatusLedControl.min_pwm);
-        vTaskDelay(LED_STATUS_BLINK_DELAY / portTICK_PERIOD_MS);
-        ledcWrite(LED_STATUS_CHANNEL, DomDomStatusLedControl.max_pwm);
-        vTaskDelay(LED_STATUS_BLINK_DELAY / portTICK_PERIOD_MS);
-        ledcWrite(LED_STATUS_CHANNEL, DomDomStatusLedControl.min_pwm);
-        vTaskDelay(DomDomStatusLedControl.getDelay() / portTICK_PERIOD_MS);
+        ledcWrite(LED_STATUS_CHANNEL, led->min_pwm);
+        led->_blink_task.sleep(LED_STATUS_BLINK_DELAY);
+        ledcWrite(LED_STATUS_CHANNEL, led->max_pwm);
+        led->_blink_task.sleep(LED_STATUS_BLINK_DELAY);
+        ledcWrite(LED_STATUS_CHANNEL, led->min_pwm);
+        led->_blink_task.sleep(led->getDelay());
     }
-    DomDomStatusLedControl.release();
+    led->release();
 
-    vTaskDelete(NULL);
+    led->_blink_task.finish();
 }
 
 void DomDomStatusLedControlClass::block()
@@ -114,7 +106,8 @@ void DomDomStatusLedControlClass::release()
 
 void DomDomStatusLedControlClass::on()
 {
-    blinking = false;
+    // Esperamos a que el parpadeo termine y libere el led
+    _blink_task.stop();
     block();
     Serial.println("Status led on");
     ledcWrite(LED_STATUS_CHANNEL, max_pwm);
@@ -123,7 +116,8 @@ void DomDomStatusLedControlClass::on()
 
 void DomDomStatusLedControlClass::off()
 {
-    blinking = false;
+    // Esperamos a que el parpadeo termine y libere el led
+    _blink_task.stop();
     block();
     Serial.println("Status led off");
     ledcWrite(LED_STATUS_CHANNEL, min_pwm);
@@ -132,10 +126,10 @@ void DomDomStatusLedControlClass::off()
 
 bool DomDomStatusLedControlClass::isBlinking()
 {
-    return blinking;
+    return _blink_task.running();
 }
 
-bool DomDomStatusLedControlClass::getDelay()
+int DomDomStatusLedControlClass::getDelay()
 {
     return blinkDelay;
 }
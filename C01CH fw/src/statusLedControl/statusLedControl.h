@@ -24,6 +24,7 @@
 
 #include <Arduino.h>
 #include "../configuration.h"
+#include "../task/managedTask.h"
 
 /**
  * Clase para el control del led
@@ -35,9 +36,9 @@ class DomDomStatusLedControlClass
 {
     private:
         /**
-         * Varianle para controlar si actualmente esta parpadeando el led
+         * Tarea del parpadeo infinito. Mientras esta en marcha el led esta parpadeando
          */
-        bool blinking;
+        DomDomManagedTask _blink_task;
         /**
          * Nivel PWM para cuando lo encendemos
          */
@@ -55,7 +56,7 @@ class DomDomStatusLedControlClass
          */
         SemaphoreHandle_t xMutex;
         /**
-         * Actualiza la hora por NTP.
+         * Parpadea el led. Recibe el objeto como parametro.
          */
         static void blinkTask(void * parameter);
 
@@ -100,7 +101,7 @@ class DomDomStatusLedControlClass
         /**
          * Devuelve en tiempo entre parpadeos
          */
-        bool getDelay();
+        int getDelay();
         /**
          * Inicia un parpadeo infinito del led
          */
@@ -0,0 +1,104 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "managedTask.h"
+
+bool DomDomManagedTask::start(TaskFunction_t function, const char *name, uint32_t stack, void *owner, UBaseType_t priority)
+{
+    if (_handle != NULL && !stop())
+    {
+        return false;
+    }
+
+    if (_finished == NULL)
+    {
+        _finished = xSemaphoreCreateBinary();
+    }
+
+    // Descartamos el aviso de una tarea anterior que termino por si sola
+    xSemaphoreTake(_finished, 0);
+
+    _running = true;
+
+    // FreeRTOS escribe el handle antes de que la tarea llegue a ejecutarse
+    if (xTaskCreate(function, name, stack, owner, priority, &_handle) != pdPASS)
+    {
+        _handle = NULL;
+        _running = false;
+        return false;
+    }
+
+    return true;
+}
+
+bool DomDomManagedTask::stop(uint32_t timeout_ms)
+{
+    _running = false;
+
+    if (_handle == xTaskGetCurrentTaskHandle() || !notify())
+    {
+        return true;
+    }
+
+    return xSemaphoreTake(_finished, timeout_ms / portTICK_PERIOD_MS) == pdTRUE;
+}
+
+bool DomDomManagedTask::sleep(uint32_t ms)
+{
+    if (_running)
+    {
+        ulTaskNotifyTake(pdTRUE, ms / portTICK_PERIOD_MS);
+    }
+
+    return _running;
+}
+
+void DomDomManagedTask::wake()
+{
+    notify();
+}
+
+bool DomDomManagedTask::notify()
+{
+    bool alive = false;
+
+    portENTER_CRITICAL(&_mux);
+    if (_handle != NULL)
+    {
+        xTaskNotifyGive(_handle);
+        alive = true;
+    }
+    portEXIT_CRITICAL(&_mux);
+
+    return alive;
+}
+
+void DomDomManagedTask::finish()
+{
+    portENTER_CRITICAL(&_mux);
+    _running = false;
+    _handle = NULL;
+    portEXIT_CRITICAL(&_mux);
+
+    xSemaphoreGive(_finished);
+
+    vTaskDelete(NULL);
+}
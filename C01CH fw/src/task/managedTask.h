@@ -0,0 +1,96 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+#ifndef DOMDOM_MANAGEDTASK_h
+#define DOMDOM_MANAGEDTASK_h
+
+#include <Arduino.h>
+#include "../configuration.h"
+
+/**
+ * Tarea de FreeRTOS ligada al objeto que la crea.
+ *
+ * La funcion de la tarea recibe el objeto como parametro, comprueba
+ * running() en su bucle, duerme con sleep() y llama a finish() al
+ * salir. stop() pide a la tarea que termine, la despierta y espera
+ * a que lo haga, de forma que al volver de end() ya no queda nada
+ * ejecutandose sobre el objeto.
+ */
+class DomDomManagedTask
+{
+    private:
+        /**
+         * Tarea en marcha o NULL
+         */
+        TaskHandle_t _handle = NULL;
+        /**
+         * Indica si la tarea debe seguir ejecutandose
+         */
+        volatile bool _running = false;
+        /**
+         * Semaforo que la tarea libera al terminar
+         */
+        SemaphoreHandle_t _finished = NULL;
+        /**
+         * Protege el handle mientras la tarea termina
+         */
+        portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+        /**
+         * Despierta la tarea si sigue viva
+         */
+        bool notify();
+
+    public:
+        /**
+         * Crea la tarea @function pasandole @owner como parametro.
+         * Si ya habia una tarea en marcha la para antes.
+         */
+        bool start(TaskFunction_t function, const char *name, uint32_t stack, void *owner, UBaseType_t priority = 1);
+        /**
+         * Pide a la tarea que termine y espera hasta @timeout_ms a que lo haga.
+         * Llamada desde la propia tarea solo avisa, sin esperar.
+         */
+        bool stop(uint32_t timeout_ms = TASK_STOP_TIMEOUT);
+        /**
+         * Indica si la tarea debe seguir ejecutandose
+         */
+        bool running() const { return _running; };
+        /**
+         * Tarea en marcha o NULL
+         */
+        TaskHandle_t handle() const { return _handle; };
+        /**
+         * Duerme @ms milisegundos o hasta que se pare la tarea.
+         * Devuelve running().
+         */
+        bool sleep(uint32_t ms);
+        /**
+         * Despierta la tarea si esta dormida en sleep().
+         */
+        void wake();
+        /**
+         * Debe llamarse desde la tarea al salir de su bucle. No vuelve.
+         */
+        void finish();
+};
+
+#endif /* DOMDOM_MANAGEDTASK_h */
@@ -0,0 +1,183 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "settingsJson.h"
+#include "../log/logger.h"
+
+/**
+ * Lee en @value el campo @key de @json si se envia. Devuelve falso si no es del tipo
+ * de @value (un entero fuera de su rango tampoco lo es) o es mayor que @max.
+ */
+template <typename T>
+static bool readField(JsonObjectConst json, const char *key, T max, T &value)
+{
+    JsonVariantConst field = json[key];
+    if (field.isNull())
+    {
+        return true;
+    }
+
+    if (!field.is<T>() || field.as<T>() > max)
+    {
+        return false;
+    }
+
+    value = field.as<T>();
+    return true;
+}
+
+size_t DomDomSettingsJson::scheduleCapacity()
+{
+    // Raiz con tres campos y cada punto con sus cinco campos y el array de valores
+    return JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(EEPROM_MAX_SCHEDULE_POINTS)
+        + EEPROM_MAX_SCHEDULE_POINTS * (JSON_OBJECT_SIZE(6) + JSON_ARRAY_SIZE(CHANNEL_SIZE));
+}
+
+bool DomDomSettingsJson::writeSchedule(const DomDomSchedulePointList &points, JsonDocument &doc)
+{
+    doc["max_schedule_points"] = EEPROM_MAX_SCHEDULE_POINTS;
+    doc["channel_size"] = CHANNEL_SIZE;
+    JsonArray schedule = doc.createNestedArray("schedule");
+
+    for(int i = 0; i < points.size(); i++)
+    {
+        JsonObject obj = schedule.createNestedObject();
+        obj["hour"] = points[i].hour;
+        obj["minute"] = points[i].minute;
+        obj["fade"] = points[i].fade;
+        obj["days"] = (uint8_t)points[i].dayOfWeek;
+        obj["curve"] = points[i].curve;
+        
+        JsonArray values = obj.createNestedArray("values");
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            values.add(points[i].value[c]);
+        }
+    }
+
+    return !doc.overflowed();
+}
+
+bool DomDomSettingsJson::readSchedule(JsonArrayConst json, DomDomSchedulePointList &points)
+{
+    points.clear();
+    if (json.isNull())
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < json.size(); i++)
+    {
+        JsonObjectConst obj = json[i];
+
+        uint8_t values[CHANNEL_SIZE];
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            values[c] = obj["values"][c];
+        }
+
+        // Sin dias el punto afecta a toda la semana, como antes de existir la mascara.
+        // Un punto sin ningun dia no se aplicaria nunca y se rechaza.
+        int days = obj["days"] | (int)ALL;
+        if (days <= 0 || days > ALL)
+        {
+            DomDomLogger.log(DomDomLoggerClass::LogLevel::warn,"SCHEDULE", "Dias no validos en el punto %d: %d", (int)i, days);
+            points.clear();
+            return false;
+        }
+
+        // Sin forma el fundido es lineal
+        uint8_t curve = obj["curve"] | (int)FADE_CURVE_LINEAR;
+
+        if (!points.add(DomDomSchedulePoint((DomDomDayOfWeek)days, obj["hour"], obj["minute"], values, (bool)obj["fade"], curve)))
+        {
+            DomDomLogger.log(DomDomLoggerClass::LogLevel::warn,"SCHEDULE", "Numero maximo de programaciones alcanzado. Se omitiran %d puntos", (int)(json.size() - i));
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool DomDomSettingsJson::readSolar(JsonObjectConst json, DomDomSolarSettings &solar)
+{
+    // Lo que no se envia se mantiene
+    DomDomSolarSettings result = solar;
+    result.enabled = json["enabled"] | result.enabled;
+    result.latitude = json["latitude"] | result.latitude;
+    result.longitude = json["longitude"] | result.longitude;
+
+    if (fabsf(result.latitude) > 90 || fabsf(result.longitude) > 180)
+    {
+        return false;
+    }
+
+    if (json.containsKey("values"))
+    {
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            uint8_t value = json["values"][c] | result.value[c];
+            result.value[c] = value <= 100 ? value : 100;
+        }
+    }
+
+    solar = result;
+    return true;
+}
+
+bool DomDomSettingsJson::readMoon(JsonObjectConst json, DomDomMoonSettings &moon)
+{
+    // Lo que no se envia se mantiene
+    moon.enabled = json["enabled"] | moon.enabled;
+
+    if (json.containsKey("values"))
+    {
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            uint8_t value = json["values"][c] | moon.value[c];
+            moon.value[c] = value <= SCHEDULE_MOON_MAX_PERCENT ? value : SCHEDULE_MOON_MAX_PERCENT;
+        }
+    }
+
+    return true;
+}
+
+bool DomDomSettingsJson::readWeather(JsonObjectConst json, DomDomWeatherSettings &weather)
+{
+    // Lo que no se envia se mantiene
+    DomDomWeatherSettings result = weather;
+    bool valid = readField(json, "enabled", true, result.enabled)
+        && readField(json, "seed", (uint32_t)UINT32_MAX, result.seed)
+        && readField(json, "clouds_per_hour", (uint16_t)3600, result.clouds_per_hour)
+        && readField(json, "cloud_depth", (uint8_t)100, result.cloud_depth)
+        && readField(json, "cloud_min_s", (uint16_t)UINT16_MAX, result.cloud_min_s)
+        && readField(json, "cloud_max_s", (uint16_t)UINT16_MAX, result.cloud_max_s)
+        && readField(json, "flashes_per_hour", (uint16_t)3600, result.flashes_per_hour)
+        && readField(json, "flash_intensity", (uint8_t)100, result.flash_intensity);
+
+    if (!valid || result.cloud_min_s > result.cloud_max_s)
+    {
+        return false;
+    }
+
+    weather = result;
+    return true;
+}
@@ -0,0 +1,71 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+
+#pragma once
+#ifndef DOMDOM_SETTINGSJSON_h
+#define DOMDOM_SETTINGSJSON_h
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "configuration.h"
+#include "../channel/schedulePoint.h"
+#include "../channel/solarTable.h"
+#include "../channel/moonTable.h"
+#include "../channel/weather.h"
+
+/**
+ * Conversion entre JSON y la configuracion de la programacion.
+ *
+ * Es el contenido de las peticiones del servidor web sin nada del servidor,
+ * asi se puede probar en el host (pio test -e native).
+ */
+class DomDomSettingsJson
+{
+    public:
+        /**
+         * Capacidad del documento con toda la programacion
+         */
+        static size_t scheduleCapacity();
+        /**
+         * Escribe en @doc los puntos de programacion @points. Devuelve falso si no caben.
+         */
+        static bool writeSchedule(const DomDomSchedulePointList &points, JsonDocument &doc);
+        /**
+         * Lee en @points los puntos del array @json. Devuelve falso si @json no es un array
+         * o algun punto no tiene ningun dia de la semana.
+         */
+        static bool readSchedule(JsonArrayConst json, DomDomSchedulePointList &points);
+        /**
+         * Cambia en @solar los campos que trae @json. Devuelve falso si algun valor no es valido.
+         */
+        static bool readSolar(JsonObjectConst json, DomDomSolarSettings &solar);
+        /**
+         * Cambia en @moon los campos que trae @json. Devuelve falso si algun valor no es valido.
+         */
+        static bool readMoon(JsonObjectConst json, DomDomMoonSettings &moon);
+        /**
+         * Cambia en @weather los campos que trae @json. Devuelve falso si algun valor no es valido.
+         */
+        static bool readWeather(JsonObjectConst json, DomDomWeatherSettings &weather);
+};
+
+#endif /* DOMDOM_SETTINGSJSON_h */
@@ -19,6 +19,7 @@
  */
 
 #include "webServer.h"
+#include "settingsJson.h"
 #include <FS.h>
 #include "../../lib/AsyncTCP/AsyncTCP.h"
 #include <SPIFFS.h>
@@ -28,7 +29,8 @@
 #include "wifi/WiFi.h"
 #include "statusLedControl/statusLedControl.h"
 #include "channel/ScheduleMgt.h"
-#include "channel/channel.h"
+#include "channel/astronomy.h"
+#include "channel/channelMgt.h"
 #include "EEPROMHelper.h"
 #include "Update.h"
 #include "fan/fanControl.h"
@@ -59,6 +61,19 @@ void SendResponse(AsyncWebServerRequest *request)
     request->send(response);
 }
 
+void PrintTimingHistogram(AsyncResponseStream *response, const char *name, const DomDomTimingHistogram &histogram)
+{
+    response->printf(",\"%s\":{\"count\":%u,\"min_us\":%u,\"mean_us\":%u,\"max_us\":%u,\"buckets\":[",
+        name, histogram.count, histogram.count > 0 ? histogram.min_us : 0, histogram.mean_us(), histogram.max_us);
+
+    for (uint8_t i = 0; i < LOOP_TIMING_BUCKETS; i++)
+    {
+        response->printf(i == 0 ? "%u" : ",%u", histogram.buckets[i]);
+    }
+
+    response->print("]}");
+}
+
 DomDomWebServerClass::DomDomWebServerClass(){}
 
 void DomDomWebServerClass::begin()
@@ -87,6 +102,20 @@ void DomDomWebServerClass::begin()
     _server->on("/canales", HTTP_GET, getChannelsData);
     _server->on("/canales", HTTP_POST, [](AsyncWebServerRequest * request){}, NULL, setChannelsData);
 
+    // AJAX para la calibracion de los canales
+    _server->on("/calibracion", HTTP_GET, getCalibration);
+    _server->on("/calibracion", HTTP_POST, [](AsyncWebServerRequest * request){}, NULL, setCalibration);
+
+    // AJAX para el historico de potencia
+    _server->on("/historico", HTTP_GET, getHistory);
+
+    // AJAX para los contadores de energia
+    _server->on("/energia", HTTP_GET, getEnergy);
+
+    // AJAX para los tiempos del bucle de control
+    _server->on("/tiempos", HTTP_GET, getTiming);
+    _server->on("/tiempos", HTTP_POST, [](AsyncWebServerRequest * request){}, NULL, setResetTiming);
+
     // AJAX para el reset
     _server->on("/reset", HTTP_POST, [](AsyncWebServerRequest * request){}, NULL, setRestart);
 
@@ -97,6 +126,16 @@ void DomDomWebServerClass::begin()
     _server->on("/schedule", HTTP_GET, getSchedule);
     _server->on("/schedule", HTTP_POST, [](AsyncWebServerRequest * request){}, NULL, setSchedule);
 
+    // AJAX para la programacion solar
+    _server->on("/solar", HTTP_GET, getSolar);
+    _server->on("/solar", HTTP_POST, [](AsyncWebServerRequest * request){}, NULL, setSolar);
+
+    // AJAX para la luz de luna
+    _server->on("/luna", HTTP_GET, getMoon);
+    _server->on("/luna", HTTP_POST, [](AsyncWebServerRequest * request){}, NULL, setMoon);
+    _server->on("/clima", HTTP_GET, getWeather);
+    _server->on("/clima", HTTP_POST, [](AsyncWebServerRequest * request){}, NULL, setWeather);
+
     // AJAX para el control de ventilador
     _server->on("/fansettings", HTTP_GET, getFanSettings);
     _server->on("/fansettings", HTTP_POST, [](AsyncWebServerRequest * request){}, NULL, setFanSettings);
@@ -107,6 +146,9 @@ void DomDomWebServerClass::begin()
     // AJAX para el restablecer valores de fbrica
     _server->on("/resetMaximos", HTTP_POST, [](AsyncWebServerRequest * request){}, NULL, setResetMaxValues);
 
+    // AJAX para rearmar la proteccion de los canales
+    _server->on("/rearmar", HTTP_POST, [](AsyncWebServerRequest * request){}, NULL, setResetTrip);
+
     // AJAX para el control de ventilador
     _server->on("/log", HTTP_POST, [](AsyncWebServerRequest * request){}, NULL, getLog);
 
@@ -121,7 +163,7 @@ void DomDomWebServerClass::begin()
         response->addHeader("Access-Control-Allow-Origin", "*");
         request->send(response);
         
-        DomDomChannel.end();
+        DomDomChannelMgt.end();
 
         delay(2000);
         
@@ -325,45 +367,62 @@ void DomDomWebServerClass::getChannelsData(AsyncWebServerRequest *request)
     
     jsonDoc["modo_programado"] = DomDomScheduleMgt.isStarted();
 
-    DomDomSchedulePoint * point = nullptr;
+    DomDomSchedulePoint point;
     DateTime dt;
     if (DomDomScheduleMgt.getShedulePoint(dt, point, false))
     {
-        jsonDoc["siguiente_punto_hora"] = point->hour;
-        jsonDoc["siguiente_punto_minuto"] = point->minute;
+        jsonDoc["siguiente_punto_hora"] = point.hour;
+        jsonDoc["siguiente_punto_minuto"] = point.minute;
     }
     
     JsonArray ports = jsonDoc.createNestedArray("canales");
 
-    JsonObject obj = ports.createNestedObject();
-    obj["enabled"] = DomDomChannel.getEnabled();
-    obj["channel_num"] = DomDomChannel.getNum();
-    obj["target_mA"] = DomDomChannel.target_mA;
-    obj["max_mA"] = DomDomChannel.maximum_mA;
-    obj["min_mA"] = DomDomChannel.minimum_mA;
-    obj["max_volts"] = DomDomChannel.maximum_V;
-    obj["dac_pwm"] = DomDomChannel.curr_dac_pwm;
-    obj["max_leds"] = CHANNEL_MAX_LEDS_CONFIG;
-
-    String str_lvolts = String(DomDomChannel.lastBusVoltaje_V,2);
-    String str_lamps = String(DomDomChannel.lastBusCurrent_mA,3);
-    String str_pamps = String(DomDomChannel.busCurrentPeak_mA,3);
-    String str_pvolts = String(DomDomChannel.busVoltagePeak_V,2);
-    String str_ppower = String(DomDomChannel.busPowerPeak_W,2);
-
-    obj["bus_volts"] = serialized(str_lvolts);
-    obj["bus_miliamps"] = serialized(str_lamps);
-    obj["bus_volts_peak"] = serialized(str_pvolts);
-    obj["bus_miliamps_peak"] = serialized(str_pamps);
-    obj["bus_power_peak"] = serialized(str_ppower);
-    
-    JsonArray leds = obj.createNestedArray("leds");
-    for (int j = 0; j < DomDomChannel.leds.size(); j++)
+    for (int i = 0; i < CHANNEL_SIZE; i++)
     {
-        JsonObject led = leds.createNestedObject();
-        led["K"] = DomDomChannel.leds[j]->K;
-        led["nm"] = DomDomChannel.leds[j]->nm;
-        led["W"] = DomDomChannel.leds[j]->W;
+        DomDomChannelClass *channel = DomDomChannelMgt.channels[i];
+        DomDomChannelReading reading = channel->reading();
+
+        JsonObject obj = ports.createNestedObject();
+        obj["enabled"] = channel->getEnabled();
+        obj["channel_num"] = channel->getNum();
+        obj["target_mA"] = channel->target_mA;
+        obj["max_mA"] = channel->maximum_mA;
+        obj["min_mA"] = channel->minimum_mA;
+        obj["max_volts"] = channel->maximum_V;
+        obj["dac_pwm"] = reading.dac_pwm;
+        obj["dac_code"] = reading.dac_code;
+        obj["max_leds"] = CHANNEL_MAX_LEDS_CONFIG;
+        obj["kp"] = channel->controller.kp;
+        obj["ki"] = channel->controller.ki;
+        obj["brightness_curve"] = channel->brightness_curve;
+        obj["max_slew"] = channel->max_slew_mA_s;
+        obj["setpoint_mA"] = reading.setpoint_mA;
+        obj["trip"] = reading.trip;
+        obj["fast_mode"] = reading.fast_mode;
+        obj["fast_mode_ms"] = reading.fast_mode_ms;
+        obj["slow_mode_ms"] = reading.slow_mode_ms;
+        obj["mode_switches"] = reading.mode_switches;
+
+        String str_lvolts = String(reading.busVoltage_V,2);
+        String str_lamps = String(reading.busCurrent_mA,3);
+        String str_pamps = String(reading.busCurrentPeak_mA,3);
+        String str_pvolts = String(reading.busVoltagePeak_V,2);
+        String str_ppower = String(reading.busPowerPeak_W,2);
+
+        obj["bus_volts"] = serialized(str_lvolts);
+        obj["bus_miliamps"] = serialized(str_lamps);
+        obj["bus_volts_peak"] = serialized(str_pvolts);
+        obj["bus_miliamps_peak"] = serialized(str_pamps);
+        obj["bus_power_peak"] = serialized(str_ppower);
+        
+        JsonArray leds = obj.createNestedArray("leds");
+        for (int j = 0; j < channel->leds.size(); j++)
+        {
+            JsonObject led = leds.createNestedObject();
+            led["K"] = channel->leds[j]->K;
+            led["nm"] = channel->leds[j]->nm;
+            led["W"] = channel->leds[j]->W;
+        }
     }
 
     serializeJson(jsonDoc, *response);
@@ -404,22 +463,69 @@ void DomDomWebServerClass::setChannelsData(AsyncWebServerRequest * request, uint
     if (doc.containsKey("canales"))
     {
         JsonArray canales = doc["canales"].as<JsonArray>();
-        for(JsonObject canal : canales)
+
+        // Rechazamos ganancias invalidas antes de cambiar ningun canal
+        for (JsonObject canal : canales)
         {
-            DomDomChannel.setEnabled(canal["enabled"]);
-            DomDomChannel.maximum_V = canal["max_volts"];
-            DomDomChannel.maximum_mA = canal["max_mA"];
-            DomDomChannel.minimum_mA = canal["min_mA"];
+            if ((canal.containsKey("kp") && !canal["kp"].is<float>()) ||
+                (canal.containsKey("ki") && !canal["ki"].is<float>()) ||
+                !DomDomCurrentController::validGains(canal["kp"] | CHANNEL_CONTROL_KP, canal["ki"] | CHANNEL_CONTROL_KI))
+            {
+                request->send(400);
+                return;
+            }
+        }
+
+        for(int i = 0; i < canales.size(); i++)
+        {
+            JsonObject canal = canales[i];
+            DomDomChannelClass *channel = DomDomChannelMgt.getChannel(canal["channel_num"] | i);
+            if (channel == nullptr)
+            {
+                continue;
+            }
+
+            channel->setEnabled(canal["enabled"]);
+            channel->maximum_V = canal["max_volts"];
+            channel->maximum_mA = canal["max_mA"];
+            channel->minimum_mA = canal["min_mA"];
+
+            if (canal.containsKey("kp"))
+            {
+                channel->controller.kp = canal["kp"];
+            }
+
+            if (canal.containsKey("ki"))
+            {
+                channel->controller.ki = canal["ki"];
+            }
+
+            if (canal.containsKey("max_slew") && canal["max_slew"] >= 0 && canal["max_slew"] <= CHANNEL_RAMP_MAX_SLEW_LIMIT)
+            {
+                channel->max_slew_mA_s = canal["max_slew"];
+            }
+
+            if (canal.containsKey("brightness_curve") && canal["brightness_curve"] < CURVE_COUNT)
+            {
+                channel->brightness_curve = canal["brightness_curve"];
+            }
 
             if (!DomDomScheduleMgt.isStarted())
             {
                 // DomDomStatusLedControl.blink(1);
-                DomDomChannel.setTargetmA(canal["target_mA"]);
+                if (canal.containsKey("target_percent"))
+                {
+                    channel->setTargetPercent(canal["target_percent"]);
+                }
+                else
+                {
+                    channel->setTargetmA(canal["target_mA"]);
+                }
             }
 
             if (canal.containsKey("leds"))
             {
-                DomDomChannel.leds.clear();
+                channel->leds.clear();
                 JsonArray leds = canal["leds"].as<JsonArray>();
                 for(JsonObject led : leds)
                 {
@@ -430,15 +536,231 @@ void DomDomWebServerClass::setChannelsData(AsyncWebServerRequest * request, uint
                     
                     if (obj->K > 0 || obj->nm > 0 || obj->W > 0)
                     {
-                        DomDomChannel.leds.push_back(obj);
+                        channel->leds.push_back(obj);
                     }
                     
                 }
             }
 
-            DomDomChannel.save();
+            channel->save();
         }
 
+        // La curva y los limites cambian la corriente de cada porcentaje programado
+        DomDomScheduleMgt.wake();
+    }
+
+    SendResponse(request);
+}
+
+void DomDomWebServerClass::getCalibration(AsyncWebServerRequest *request)
+{
+    int num = request->hasParam("channel") ? request->getParam("channel")->value().toInt() : 0;
+    DomDomChannelClass *channel = DomDomChannelMgt.getChannel(num);
+    if (channel == nullptr)
+    {
+        request->send(400);
+        return;
+    }
+
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+
+    DynamicJsonDocument jsonDoc(16384);
+
+    jsonDoc["channel_num"] = channel->getNum();
+    jsonDoc["calibrating"] = channel->calibrating();
+    jsonDoc["valid"] = channel->calibration.isValid();
+
+    JsonArray mA = jsonDoc.createNestedArray("mA");
+    JsonArray mV = jsonDoc.createNestedArray("mV");
+    for (int i = 0; i < CALIBRATION_TABLE_SIZE; i++)
+    {
+        mA.add(channel->calibration.mA[i]);
+        mV.add(channel->calibration.mV[i]);
+    }
+
+    serializeJson(jsonDoc, *response);
+
+    SendResponse(request,response);
+}
+
+void DomDomWebServerClass::setCalibration(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+    String bodyContent = GetBodyContent(data, len);
+
+    DynamicJsonDocument doc(1024);
+    DeserializationError err = deserializeJson(doc, bodyContent);
+
+    DomDomChannelClass *channel = DomDomChannelMgt.getChannel(doc["channel"] | 0);
+    if (err || !doc.containsKey("start") || channel == nullptr) {
+        request->send(400);
+        return;
+    }
+
+    if (doc["start"])
+    {
+        if (!channel->startCalibration())
+        {
+            request->send(400);
+            return;
+        }
+    }
+    else
+    {
+        channel->stopCalibration();
+    }
+
+    SendResponse(request);
+}
+
+void DomDomWebServerClass::getHistory(AsyncWebServerRequest *request)
+{
+    int num = request->hasParam("channel") ? request->getParam("channel")->value().toInt() : 0;
+    int tier = request->hasParam("tier") ? request->getParam("tier")->value().toInt() : HISTORY_MINUTES;
+    uint32_t from = request->hasParam("from") ? request->getParam("from")->value().toInt() : 0;
+    uint32_t to = request->hasParam("to") ? request->getParam("to")->value().toInt() : UINT32_MAX;
+
+    DomDomChannelClass *channel = DomDomChannelMgt.getChannel(num);
+    if (channel == nullptr || tier < HISTORY_RAW || tier > HISTORY_HOURS)
+    {
+        request->send(400);
+        return;
+    }
+
+    // El historico puede tener miles de intervalos, lo escribimos directamente sin ArduinoJson
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->printf("{\"channel_num\":%d,\"tier\":%d,\"scale\":%d,\"data\":[", num, tier, HISTORY_POWER_SCALE);
+
+    bool first = true;
+    DomDomHistoryTierType type = (DomDomHistoryTierType)tier;
+    uint16_t count = channel->historyCount(type);
+
+    if (type == HISTORY_RAW)
+    {
+        // Las muestras sin agrupar usan la marca en milisegundos
+        DomDomHistorySample sample;
+        for (uint16_t i = 0; i < count && channel->historyRaw(i, sample); i++)
+        {
+            response->printf(first ? "[%u,%u]" : ",[%u,%u]", sample.time_ms, sample.power);
+            first = false;
+        }
+    }
+    else
+    {
+        uint32_t time;
+        DomDomHistoryBucket bucket;
+        for (uint16_t i = channel->historyIndexOf(type, from); i < count && channel->historyBucket(type, i, time, bucket) && time <= to; i++)
+        {
+            // Los intervalos sin muestras se omiten
+            if (bucket.min > bucket.max)
+            {
+                continue;
+            }
+
+            response->printf(first ? "[%u,%u,%u,%u]" : ",[%u,%u,%u,%u]", time, bucket.min, bucket.avg, bucket.max);
+            first = false;
+        }
+    }
+
+    response->print("]}");
+
+    SendResponse(request,response);
+}
+
+void DomDomWebServerClass::getEnergy(AsyncWebServerRequest *request)
+{
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+
+    DynamicJsonDocument jsonDoc(512 * CHANNEL_SIZE);
+    JsonArray array = jsonDoc.createNestedArray("channels");
+
+    for (uint8_t i = 0; i < CHANNEL_SIZE; i++)
+    {
+        DomDomEnergyCounters counters = DomDomChannelMgt.getChannel(i)->energy();
+
+        JsonObject canal = array.createNestedObject();
+        canal["channel_num"] = i;
+        canal["total_Wh"] = counters.total_Wh;
+        canal["hour_Wh"] = counters.hour_Wh;
+        canal["day_Wh"] = counters.day_Wh;
+        canal["month_Wh"] = counters.month_Wh;
+        canal["last_hour_Wh"] = counters.last_hour_Wh;
+        canal["last_day_Wh"] = counters.last_day_Wh;
+        canal["last_month_Wh"] = counters.last_month_Wh;
+    }
+
+    serializeJson(jsonDoc, *response);
+
+    SendResponse(request, response);
+}
+
+void DomDomWebServerClass::getTiming(AsyncWebServerRequest *request)
+{
+    int num = request->hasParam("channel") ? request->getParam("channel")->value().toInt() : -1;
+    if (num >= CHANNEL_SIZE)
+    {
+        request->send(400);
+        return;
+    }
+
+    const char *phases[LOOP_PHASE_SIZE] = { "wait", "i2c", "compute", "dac", "total" };
+
+    // Los histogramas se escriben directamente sin ArduinoJson
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->print("{\"bucket_us\":[");
+    for (uint8_t i = 0; i < LOOP_TIMING_BUCKETS; i++)
+    {
+        response->printf(i == 0 ? "%u" : ",%u", DomDomTimingHistogram::bucketLimit(i));
+    }
+    response->print("],\"channels\":[");
+
+    bool first = true;
+    for (uint8_t i = 0; i < CHANNEL_SIZE; i++)
+    {
+        if (num >= 0 && num != i)
+        {
+            continue;
+        }
+
+        DomDomLoopStats stats = DomDomChannelMgt.getChannel(i)->timing();
+
+        response->printf(first ? "{" : ",{");
+        response->printf("\"channel_num\":%d,\"iterations\":%u,\"rate_hz\":%.2f,\"jitter_mean_us\":%u,\"jitter_max_us\":%u",
+            i, stats.phases[LOOP_PHASE_TOTAL].count, stats.rate_hz(), stats.jitter_mean_us(), stats.jitter_max_us);
+
+        PrintTimingHistogram(response, "period", stats.period);
+        for (uint8_t phase = 0; phase < LOOP_PHASE_SIZE; phase++)
+        {
+            PrintTimingHistogram(response, phases[phase], stats.phases[phase]);
+        }
+
+        response->print("}");
+        first = false;
+    }
+
+    response->print("]}");
+
+    SendResponse(request, response);
+}
+
+void DomDomWebServerClass::setResetTiming(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+    String bodyContent = GetBodyContent(data, len);
+
+    DynamicJsonDocument doc(1024);
+    DeserializationError err = deserializeJson(doc, bodyContent);
+
+    if (err || !doc.containsKey("reset") || !doc["reset"])
+    {
+        request->send(400);
+        return;
+    }
+
+    for (int i = 0; i < CHANNEL_SIZE; i++)
+    {
+        if (!doc.containsKey("channel") || doc["channel"] == i)
+        {
+            DomDomChannelMgt.channels[i]->resetTiming();
+        }
     }
 
     SendResponse(request);
@@ -467,6 +789,8 @@ void DomDomWebServerClass::setRestart(AsyncWebServerRequest * request, uint8_t *
             
             DomDomStatusLedControl.blink(10);
 
+            DomDomChannelMgt.saveEnergy();
+
             ESP.restart();
         }
     }
@@ -494,9 +818,10 @@ void DomDomWebServerClass::setResetMaxValues(AsyncWebServerRequest * request, ui
         if (doc["reset"])
         {
             
-            DomDomChannel.busPowerPeak_W = 0;
-            DomDomChannel.busCurrentPeak_mA = 0;
-            DomDomChannel.busVoltagePeak_V = 0;
+            for (int i = 0; i < CHANNEL_SIZE; i++)
+            {
+                DomDomChannelMgt.channels[i]->resetPeaks();
+            }
 
             request->send(response);
         }
@@ -505,6 +830,29 @@ void DomDomWebServerClass::setResetMaxValues(AsyncWebServerRequest * request, ui
     request->send(400);
 }
 
+void DomDomWebServerClass::setResetTrip(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+    String bodyContent = GetBodyContent(data, len);
+    
+    DynamicJsonDocument doc(1024);
+    DeserializationError err = deserializeJson(doc, bodyContent);
+
+    if (err) { 
+        request->send(400); 
+        return;
+    }
+
+    for (int i = 0; i < CHANNEL_SIZE; i++)
+    {
+        if (!doc.containsKey("channel") || doc["channel"] == i)
+        {
+            DomDomChannelMgt.channels[i]->resetTrip();
+        }
+    }
+
+    SendResponse(request);
+}
+
 void DomDomWebServerClass::setFactorySettings(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total)
 {
     String bodyContent = GetBodyContent(data, len);
@@ -536,25 +884,18 @@ void DomDomWebServerClass::setFactorySettings(AsyncWebServerRequest * request, u
 
 void DomDomWebServerClass::getSchedule(AsyncWebServerRequest *request)
 {
-    AsyncResponseStream *response = request->beginResponseStream("application/json");
-        
-    DynamicJsonDocument jsonDoc(6000);
-    
-    jsonDoc["max_schedule_points"] = EEPROM_MAX_SCHEDULE_POINTS;
-    jsonDoc["channel_size"] = 1;
-    JsonArray points = jsonDoc.createNestedArray("schedule");
+    DynamicJsonDocument jsonDoc(DomDomSettingsJson::scheduleCapacity());
 
-    for(int i = 0; i < DomDomScheduleMgt.schedulePoints.size(); i++)
+    // La programacion no cambia mientras la recorremos aunque se suba otra
+    DomDomScheduleReader schedule(DomDomScheduleMgt.schedule());
+    if (!DomDomSettingsJson::writeSchedule(schedule->points, jsonDoc))
     {
-        JsonObject obj = points.createNestedObject();
-        obj["hour"] = DomDomScheduleMgt.schedulePoints[i]->hour;
-        obj["minute"] = DomDomScheduleMgt.schedulePoints[i]->minute;
-        obj["fade"] = DomDomScheduleMgt.schedulePoints[i]->fade;
-        
-        JsonArray values = obj.createNestedArray("values");
-        values.add(DomDomScheduleMgt.schedulePoints[i]->value);
+        DomDomLogger.log(DomDomLoggerClass::LogLevel::error,"WEBSERVER", "La programacion no cabe en la respuesta");
+        request->send(500);
+        return;
     }
 
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
     serializeJson(jsonDoc, *response);
     
     SendResponse(request,response);
@@ -572,14 +913,21 @@ void DomDomWebServerClass::setSchedule(AsyncWebServerRequest * request, uint8_t
         return;
     }
 
-    DomDomScheduleMgt.schedulePoints.clear();
-    JsonArray points = doc.as<JsonArray>();
+    DomDomSchedulePointList points;
+    if (!DomDomSettingsJson::readSchedule(doc.as<JsonArrayConst>(), points))
+    {
+        request->send(400);
+        return;
+    }
     Serial.printf("[Schedule] Recibidos %d puntos\n", points.size());
+
+    // La nueva programacion se prepara aparte y se publica entera
+    DomDomScheduleMgt.beginEdit();
     for(int i = 0; i < points.size(); i++)
     {
-        DomDomSchedulePoint *p = new DomDomSchedulePoint(ALL, points[i]["hour"], points[i]["minute"], points[i]["values"][0], (bool)points[i]["fade"]);
-        DomDomScheduleMgt.schedulePoints.push_back(p);
+        DomDomScheduleMgt.addSchedulePoint(points[i].dayOfWeek, points[i].hour, points[i].minute, points[i].value, points[i].fade, points[i].curve);
     }
+    DomDomScheduleMgt.publish();
 
     Serial.printf("[Schedule] Guardando...\n");
     DomDomScheduleMgt.save();
@@ -588,6 +936,162 @@ void DomDomWebServerClass::setSchedule(AsyncWebServerRequest * request, uint8_t
     SendResponse(request);
 }
 
+void DomDomWebServerClass::getSolar(AsyncWebServerRequest *request)
+{
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+
+    StaticJsonDocument<512> jsonDoc;
+    DomDomSolarSettings solar = DomDomScheduleMgt.solar();
+
+    jsonDoc["enabled"] = solar.enabled;
+    jsonDoc["latitude"] = solar.latitude;
+    jsonDoc["longitude"] = solar.longitude;
+    JsonArray values = jsonDoc.createNestedArray("values");
+    for (int c = 0; c < CHANNEL_SIZE; c++)
+    {
+        values.add(solar.value[c]);
+    }
+
+    // Minutos del dia, -1 si hoy no sale o no se pone el sol
+    int16_t sunrise, sunset;
+    DomDomScheduleMgt.sunTimes(sunrise, sunset);
+    jsonDoc["sunrise"] = sunrise;
+    jsonDoc["sunset"] = sunset;
+
+    serializeJson(jsonDoc, *response);
+
+    SendResponse(request,response);
+}
+
+void DomDomWebServerClass::setSolar(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+    String bodyContent = GetBodyContent(data, len);
+
+    DynamicJsonDocument doc(512);
+    DeserializationError err = deserializeJson(doc, bodyContent);
+
+    if (err) {
+        request->send(400);
+        return;
+    }
+
+    DomDomSolarSettings solar = DomDomScheduleMgt.solar();
+    if (!DomDomSettingsJson::readSolar(doc.as<JsonObjectConst>(), solar))
+    {
+        request->send(400);
+        return;
+    }
+
+    DomDomScheduleMgt.setSolar(solar);
+    DomDomScheduleMgt.save();
+
+    SendResponse(request);
+}
+
+void DomDomWebServerClass::getMoon(AsyncWebServerRequest *request)
+{
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+
+    StaticJsonDocument<512> jsonDoc;
+    DomDomMoonSettings moon = DomDomScheduleMgt.moon();
+
+    jsonDoc["enabled"] = moon.enabled;
+    jsonDoc["max_value"] = SCHEDULE_MOON_MAX_PERCENT;
+    JsonArray values = jsonDoc.createNestedArray("values");
+    for (int c = 0; c < CHANNEL_SIZE; c++)
+    {
+        values.add(moon.value[c]);
+    }
+
+    // Fase en este momento: 0 luna nueva, 180 luna llena
+    DateTime now = DomDomRTC.now();
+    float ra, dec, phase, illumination;
+    DomDomAstronomy::moon(DomDomAstronomy::daysSinceJ2000(now.unixtime() - DomDomRTC.utcOffset(now)), ra, dec, phase, illumination);
+    jsonDoc["phase"] = phase;
+    jsonDoc["illumination"] = illumination;
+
+    // Minutos del dia, -1 si hoy no sale o no se pone la luna
+    int16_t moonrise, moonset;
+    DomDomScheduleMgt.moonTimes(moonrise, moonset);
+    jsonDoc["moonrise"] = moonrise;
+    jsonDoc["moonset"] = moonset;
+
+    serializeJson(jsonDoc, *response);
+
+    SendResponse(request,response);
+}
+
+void DomDomWebServerClass::setMoon(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+    String bodyContent = GetBodyContent(data, len);
+
+    DynamicJsonDocument doc(512);
+    DeserializationError err = deserializeJson(doc, bodyContent);
+
+    if (err) {
+        request->send(400);
+        return;
+    }
+
+    DomDomMoonSettings moon = DomDomScheduleMgt.moon();
+    if (!DomDomSettingsJson::readMoon(doc.as<JsonObjectConst>(), moon))
+    {
+        request->send(400);
+        return;
+    }
+
+    DomDomScheduleMgt.setMoon(moon);
+    DomDomScheduleMgt.save();
+
+    SendResponse(request);
+}
+
+void DomDomWebServerClass::getWeather(AsyncWebServerRequest *request)
+{
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+
+    StaticJsonDocument<512> jsonDoc;
+    DomDomWeatherSettings weather = DomDomChannelMgt.weather();
+
+    jsonDoc["enabled"] = weather.enabled;
+    jsonDoc["seed"] = weather.seed;
+    jsonDoc["clouds_per_hour"] = weather.clouds_per_hour;
+    jsonDoc["cloud_depth"] = weather.cloud_depth;
+    jsonDoc["cloud_min_s"] = weather.cloud_min_s;
+    jsonDoc["cloud_max_s"] = weather.cloud_max_s;
+    jsonDoc["flashes_per_hour"] = weather.flashes_per_hour;
+    jsonDoc["flash_intensity"] = weather.flash_intensity;
+
+    serializeJson(jsonDoc, *response);
+
+    SendResponse(request,response);
+}
+
+void DomDomWebServerClass::setWeather(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+    String bodyContent = GetBodyContent(data, len);
+
+    DynamicJsonDocument doc(512);
+    DeserializationError err = deserializeJson(doc, bodyContent);
+
+    if (err) {
+        request->send(400);
+        return;
+    }
+
+    DomDomWeatherSettings weather = DomDomChannelMgt.weather();
+    if (!DomDomSettingsJson::readWeather(doc.as<JsonObjectConst>(), weather))
+    {
+        request->send(400);
+        return;
+    }
+
+    DomDomChannelMgt.setWeather(weather);
+    DomDomChannelMgt.saveWeather();
+
+    SendResponse(request);
+}
+
 void DomDomWebServerClass::setTest(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total)
 {
     String bodyContent = GetBodyContent(data, len);
@@ -603,14 +1107,22 @@ void DomDomWebServerClass::setTest(AsyncWebServerRequest * request, uint8_t *dat
     if (doc.containsKey("canales"))
     {
         JsonArray canales = doc["canales"].as<JsonArray>();
-        uint16_t pwm[canales.size()];
+        float mA[CHANNEL_SIZE] = { 0 };
 
-        for(int i = 0; i < canales.size(); i++)
+        for(int i = 0; i < canales.size() && i < CHANNEL_SIZE; i++)
         {
-            pwm[i] = canales[i]["current_pwm"];
+            // El porcentaje pasa por la curva de brillo del canal, current_pwm son mA directos
+            if (canales[i].containsKey("percent"))
+            {
+                mA[i] = DomDomChannelMgt.channels[i]->percentTomA(canales[i]["percent"]);
+            }
+            else
+            {
+                mA[i] = canales[i]["current_pwm"];
+            }
         }
         
-        DomDomScheduleMgt.startTest(pwm[0]);
+        DomDomScheduleMgt.startTest(mA);
     }
 
     SendResponse(request);
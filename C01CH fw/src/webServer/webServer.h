@@ -75,6 +75,30 @@ class DomDomWebServerClass
          * Acepta un JSON que con la estructura correcta provoca que la EEPROM se reestablezca
          */
         static void setFactorySettings(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total);
+        /**
+         * Devuelve un JSON con la tabla de calibracion DAC -> mA.
+         */
+        static void getCalibration(AsyncWebServerRequest *request);
+        /**
+         * Acepta un JSON para iniciar o cancelar la calibracion del canal.
+         */
+        static void setCalibration(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total);
+        /**
+         * Devuelve un JSON con el historico de potencia de un canal.
+         */
+        static void getHistory(AsyncWebServerRequest *request);
+        /**
+         * Devuelve un JSON con los contadores de energia de los canales.
+         */
+        static void getEnergy(AsyncWebServerRequest *request);
+        /**
+         * Devuelve un JSON con los tiempos del bucle de control de los canales.
+         */
+        static void getTiming(AsyncWebServerRequest *request);
+        /**
+         * Borra los tiempos del bucle de control de un canal, o de todos si no se indica.
+         */
+        static void setResetTiming(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total);
         /**
          * Devuelve un JSON con la programacion
          */
@@ -83,6 +107,30 @@ class DomDomWebServerClass
          * Acepta un JSON para configurar un punto de programacion
          */
         static void setSchedule(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total);
+        /**
+         * Devuelve un JSON con la configuracion de la programacion solar y el orto y ocaso de hoy
+         */
+        static void getSolar(AsyncWebServerRequest *request);
+        /**
+         * Acepta un JSON para configurar la programacion solar
+         */
+        static void setSolar(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total);
+        /**
+         * Devuelve un JSON con la configuracion de la luz de luna, la fase actual y el orto y ocaso de hoy
+         */
+        static void getMoon(AsyncWebServerRequest *request);
+        /**
+         * Acepta un JSON para configurar la luz de luna
+         */
+        static void setMoon(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total);
+        /**
+         * Devuelve un JSON con la configuracion del efecto de nubes y rayos
+         */
+        static void getWeather(AsyncWebServerRequest *request);
+        /**
+         * Acepta un JSON para configurar o activar el efecto de nubes y rayos
+         */
+        static void setWeather(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total);
         /**
          * Acepta un JSON para configurar un test de color
          */
@@ -99,6 +147,10 @@ class DomDomWebServerClass
          * Acepta un JSON que con la estructura correcta provoca un reinicio en equipo.
          */
         static void setResetMaxValues(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total);
+        /**
+         * Rearma la proteccion de un canal, o de todos si no se indica.
+         */
+        static void setResetTrip(AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total);
         /**
          * Devuelve un JSON con la informacion de los canales.
          */
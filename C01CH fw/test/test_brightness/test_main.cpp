@@ -0,0 +1,88 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests de las curvas de brillo perceptual (pio test -e native).
+ */
+
+#include <math.h>
+#include <unity.h>
+#include "channel/brightnessCurve.h"
+#include "channel/scheduleFade.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_tables_match_runtime_math(void)
+{
+    // Las tablas calculadas al compilar contra la libreria matematica
+    for (int percent = 0; percent < BRIGHTNESS_TABLE_SIZE; percent++)
+    {
+        double cie = percent > 8 ? pow((percent + 16) / 116.0, 3) : percent / 903.3;
+        double gamma = pow(percent / 100.0, CHANNEL_BRIGHTNESS_GAMMA);
+        TEST_ASSERT_UINT_WITHIN(1, lround(cie * UINT16_MAX), DomDomBrightness::Cie1931Table::values[percent]);
+        TEST_ASSERT_UINT_WITHIN(1, lround(gamma * UINT16_MAX), DomDomBrightness::GammaTable::values[percent]);
+    }
+}
+
+void test_curves_are_monotone(void)
+{
+    for (uint8_t curve = 0; curve < CURVE_COUNT; curve++)
+    {
+        TEST_ASSERT_EQUAL_FLOAT(0, DomDomBrightness::apply(curve, 0));
+        TEST_ASSERT_EQUAL_FLOAT(1, DomDomBrightness::apply(curve, 100));
+
+        float last = 0;
+        for (float percent = 0; percent <= 100; percent += 0.25f)
+        {
+            float value = DomDomBrightness::apply(curve, percent);
+            TEST_ASSERT_TRUE(value >= last);
+            last = value;
+        }
+    }
+
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, DomDomBrightness::apply(CURVE_LINEAR, 50));
+}
+
+void test_fixed_point_matches_float(void)
+{
+    for (uint8_t curve = 0; curve < CURVE_COUNT; curve++)
+    {
+        for (uint32_t percent = 0; percent <= 100 * FADE_PERCENT_ONE; percent += 97)
+        {
+            double reference = DomDomBrightness::apply(curve, (double)percent / FADE_PERCENT_ONE) * UINT16_MAX;
+            uint16_t value = DomDomBrightness::applyFixed(curve, percent);
+
+            // apply() trabaja en float, admitimos su error de redondeo
+            TEST_ASSERT_FLOAT_WITHIN(1.01, reference, value);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_tables_match_runtime_math);
+    RUN_TEST(test_curves_are_monotone);
+    RUN_TEST(test_fixed_point_matches_float);
+    return UNITY_END();
+}
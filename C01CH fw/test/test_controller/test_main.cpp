@@ -0,0 +1,237 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests del controlador de corriente contra la carga simulada de env:native
+ * (pio test -e native).
+ *
+ * Lleva el controlador con las ganancias por defecto por una serie de escalones
+ * por todo el rango y comprueba el tiempo de establecimiento y la sobreoscilacion:
+ * sin tabla de calibracion, que es el peor caso al arrancar, con la tabla de un
+ * barrido y sin tabla con rampas como las de los fundidos.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <simINA226.h>
+#include "configuration.h"
+#include "channel/currentController.h"
+#include "channel/calibrationTable.h"
+
+/**
+ * Corriente maxima del canal de prueba y consignas de los escalones
+ */
+static const float maximum_mA = 500;
+static const float targets[] = { 200, 50, 400, 10, 490, 200 };
+/**
+ * Periodo de las conversiones en modo rapido y en modo lento
+ */
+static const float fast_s = CHANNEL_INA_FAST_AVERAGING * 2 * CHANNEL_INA_FAST_CONVERSION_TIME / 1e6f;
+static const float slow_s = CHANNEL_INA_AVERAGING * 2 * CHANNEL_INA_CONVERSION_TIME / 1e6f;
+
+static DomDomSimLedLoad load;
+static uint32_t seed;
+static float tolerance_mA;
+
+void setUp(void)
+{
+    load = DomDomSimLedLoad();
+    seed = 1;
+    tolerance_mA = maximum_mA * CHANNEL_CONTROL_TOLERANCE;
+    tolerance_mA = tolerance_mA < CHANNEL_CONTROL_MIN_TOLERANCE_MA ? CHANNEL_CONTROL_MIN_TOLERANCE_MA : tolerance_mA;
+}
+
+void tearDown(void) {}
+
+/**
+ * Mide la corriente media de la carga durante @seconds con el DAC en @dac, como una
+ * conversion del INA.
+ */
+static float measureLoad(float dac, float seconds)
+{
+    const float substep_s = 0.0001f;
+    uint32_t substeps = lroundf(seconds / substep_s);
+    float dac_V = dac * SIM_BOARD_DAC_VOLTS / 255;
+
+    float sum_mA = 0;
+    for (uint32_t i = 0; i < substeps; i++)
+    {
+        load.update(dac_V, substep_s, seed);
+        sum_mA += load.current_mA;
+    }
+
+    return sum_mA / substeps;
+}
+
+/**
+ * Lleva la consigna @goal_mA hacia @target_mA, a @slew_mA_s o de golpe si es 0, y el
+ * controlador tras ella durante @seconds, leyendo la corriente media de cada conversion
+ * de @conversion_s. Como el canal, aprende la recta DAC->mA y al mover la consigna salta
+ * con la prealimentacion de @calibration, si la hay, o de la recta.
+ * Devuelve el tiempo desde que la consigna llega al objetivo hasta que el error queda
+ * dentro de la tolerancia (@seconds si no llega a estabilizarse) y en @overshoot_mA el
+ * mayor exceso sobre la consigna en la direccion del cambio.
+ */
+static float stepResponse(DomDomCurrentController &controller, const DomDomCalibrationTable *calibration,
+    float &goal_mA, float target_mA, float slew_mA_s, float conversion_s, float seconds, float &overshoot_mA)
+{
+    bool rising = target_mA > goal_mA;
+    float reached_s = 0, settle_s = 0;
+    overshoot_mA = 0;
+
+    for (float t = 0; t < seconds; t += conversion_s)
+    {
+        float step = target_mA - goal_mA;
+        if (slew_mA_s > 0)
+        {
+            float max_step = slew_mA_s * conversion_s;
+            step = step > max_step ? max_step : (step < -max_step ? -max_step : step);
+        }
+
+        if (step != 0)
+        {
+            goal_mA += step;
+            reached_s = t;
+
+            float dac;
+            if ((calibration != nullptr && calibration->lookup(goal_mA, dac)) || controller.feedForward(goal_mA, dac))
+            {
+                controller.track(dac);
+            }
+        }
+
+        float mA = measureLoad(controller.output(), conversion_s);
+        if (mA > CHANNEL_CONTROL_LEARN_MIN_MA)
+        {
+            controller.learn(controller.output(), mA);
+        }
+
+        float excess = rising ? mA - goal_mA : goal_mA - mA;
+        overshoot_mA = excess > overshoot_mA ? excess : overshoot_mA;
+
+        if (fabsf(target_mA - mA) > tolerance_mA)
+        {
+            settle_s = t + conversion_s;
+        }
+
+        controller.update(goal_mA - mA, conversion_s);
+    }
+
+    return settle_s > reached_s ? settle_s - reached_s : 0;
+}
+
+/**
+ * Hace todos los escalones desde el canal apagado y despues uno que no saca al canal
+ * de las conversiones lentas, donde el periodo largo limita la ganancia integral.
+ * Comprueba los peores valores contra @max_settle_s y @max_overshoot_mA.
+ */
+static void checkSteps(const DomDomCalibrationTable *calibration, float slew_mA_s, float max_settle_s, float max_overshoot_mA)
+{
+    DomDomCurrentController controller;
+    measureLoad(controller.output(), 0.01f);
+    float goal_mA = 0;
+
+    for (float target_mA : targets)
+    {
+        float overshoot_mA;
+        float settle_s = stepResponse(controller, calibration, goal_mA, target_mA, slew_mA_s, fast_s, 30, overshoot_mA);
+        TEST_ASSERT_LESS_OR_EQUAL(max_settle_s, settle_s);
+        TEST_ASSERT_LESS_OR_EQUAL(max_overshoot_mA, overshoot_mA);
+    }
+
+    // Mas alla de este error el canal vuelve al modo rapido
+    float overshoot_mA;
+    float step_mA = tolerance_mA * (CHANNEL_INA_FAST_ERROR_FACTOR - 1);
+    float settle_s = stepResponse(controller, calibration, goal_mA, goal_mA - step_mA, 0, slow_s, 60, overshoot_mA);
+    TEST_ASSERT_LESS_OR_EQUAL(10, settle_s);
+    TEST_ASSERT_LESS_OR_EQUAL(max_overshoot_mA, overshoot_mA);
+}
+
+void test_load_step_response(void)
+{
+    // Ya estable, cortada con el DAC al maximo y a plena corriente con el DAC a 0
+    measureLoad(UINT8_MAX, 0.01f);
+    TEST_ASSERT_EQUAL_FLOAT(0, measureLoad(UINT8_MAX, 0.01f));
+    measureLoad(0, 0.01f);
+    TEST_ASSERT_FLOAT_WITHIN(load.noise_mA, load.full_mA, measureLoad(0, 0.01f));
+
+    // El filtro de entrada recorre el 63% del escalon en una constante de tiempo
+    // y en cinco la corriente esta casi entera
+    load.input_V = SIM_BOARD_DAC_VOLTS;
+    load.update(0, load.tau_ms / 1000, seed);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, SIM_BOARD_DAC_VOLTS * expf(-1), load.input_V);
+    load.update(0, 4 * load.tau_ms / 1000, seed);
+    TEST_ASSERT_FLOAT_WITHIN(load.full_mA * 0.05f, load.full_mA, load.current_mA);
+
+    // A mas codigo DAC menos corriente
+    float last_mA = load.full_mA * 2;
+    for (int dac = 0; dac <= UINT8_MAX; dac += 15)
+    {
+        float mA = measureLoad(dac, 0.01f);
+        TEST_ASSERT_LESS_OR_EQUAL(last_mA + load.noise_mA, mA);
+        last_mA = mA;
+    }
+}
+
+void test_step_uncalibrated(void)
+{
+    // Sin tabla el integral tiene que cruzar la zona muerta del driver
+    checkSteps(nullptr, 0, 8, tolerance_mA);
+}
+
+void test_step_calibrated(void)
+{
+    // Barrido como el del canal, desde el corte hasta la corriente maxima
+    DomDomCalibrationTable calibration;
+    calibration.clear();
+    int last_dac = UINT8_MAX;
+    for (int dac = UINT8_MAX; dac >= 0; dac--)
+    {
+        measureLoad(dac, 0.01f);
+        float mA = measureLoad(dac, fast_s);
+        calibration.set(dac, mA, load.bus_V);
+        last_dac = dac;
+        if (mA > maximum_mA)
+        {
+            break;
+        }
+    }
+    calibration.finish(last_dac);
+
+    // Con la tabla el salto arrastra durante una conversion el integral del punto anterior
+    checkSteps(&calibration, 0, 0.5f, maximum_mA * 0.05f);
+}
+
+void test_ramp_uncalibrated(void)
+{
+    // En rampa la recta aprendida junto al corte se extrapola
+    checkSteps(nullptr, 20, 8, maximum_mA * 0.05f);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_load_step_response);
+    RUN_TEST(test_step_uncalibrated);
+    RUN_TEST(test_step_calibrated);
+    RUN_TEST(test_ramp_uncalibrated);
+    return UNITY_END();
+}
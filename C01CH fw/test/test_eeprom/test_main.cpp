@@ -0,0 +1,111 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests de la inicializacion de la EEPROM (pio test -e native).
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <unity.h>
+#include "configuration.h"
+#include "EEPROMHelper.h"
+
+#define TEST_EEPROM_FILE    "test_eeprom.bin"
+
+void setUp(void)
+{
+    // EEPROM borrada (0xFF) en cada test
+    remove(TEST_EEPROM_FILE);
+    EEPROM.setFile(TEST_EEPROM_FILE);
+    EEPROM.begin(EEPROM_SIZE);
+}
+
+void tearDown(void)
+{
+    EEPROM.end();
+    remove(TEST_EEPROM_FILE);
+}
+
+/**
+ * Comprueba que el bloque de control de cada canal tiene los valores por defecto
+ */
+static void checkControlDefaults()
+{
+    for (int i = 0; i < CHANNEL_SIZE; i++)
+    {
+        int address = EEPROM_CHANNEL_CONTROL_ADDRESS + i * EEPROM_CHANNEL_CONTROL_BLOCK_SIZE;
+        TEST_ASSERT_EQUAL_FLOAT(CHANNEL_CONTROL_KP, EEPROM.readFloat(address));
+        TEST_ASSERT_EQUAL_FLOAT(CHANNEL_CONTROL_KI, EEPROM.readFloat(address + 4));
+        TEST_ASSERT_EQUAL(CHANNEL_BRIGHTNESS_CURVE, EEPROM.read(address + 8));
+        TEST_ASSERT_EQUAL_FLOAT(CHANNEL_RAMP_MAX_SLEW, EEPROM.readFloat(address + 9));
+        TEST_ASSERT_EQUAL(0, EEPROM.read(address + EEPROM_CHANNEL_CONTROL_SIZE));
+    }
+    TEST_ASSERT_EQUAL(0, EEPROM.read(EEPROM_CHANNEL_ENERGY_ADDRESS));
+    TEST_ASSERT_EQUAL(0, EEPROM.read(EEPROM_WEATHER_ADDRESS));
+}
+
+void test_first_boot(void)
+{
+    EEPROMCheck();
+    TEST_ASSERT_EQUAL(1, EEPROM.read(1));
+    TEST_ASSERT_EQUAL(EEPROM_LAYOUT_VERSION, EEPROM.read(EEPROM_LAYOUT_VERSION_ADDRESS));
+    checkControlDefaults();
+}
+
+void test_upgrade_keeps_old_blocks(void)
+{
+    // EEPROM de la primera version: inicializada pero sin version, con basura
+    // (p.e. los datos del INA) donde ahora estan los bloques nuevos
+    EEPROM.write(1, 1);
+    EEPROM.writeString(EEPROM_MDNS_HOSTNAME_ADDRESS, "acuario");
+    EEPROM.write(EEPROM_SCHEDULE_FIRST_ADDRESS, 3);
+    for (int address = EEPROM_CHANNEL_CONTROL_ADDRESS; address < EEPROM_SIZE; address++)
+    {
+        EEPROM.write(address, 0x5A);
+    }
+
+    EEPROMCheck();
+    TEST_ASSERT_EQUAL(EEPROM_LAYOUT_VERSION, EEPROM.read(EEPROM_LAYOUT_VERSION_ADDRESS));
+    checkControlDefaults();
+    TEST_ASSERT_EQUAL_STRING("acuario", EEPROM.readString(EEPROM_MDNS_HOSTNAME_ADDRESS).c_str());
+    TEST_ASSERT_EQUAL(3, EEPROM.read(EEPROM_SCHEDULE_FIRST_ADDRESS));
+}
+
+void test_current_version_untouched(void)
+{
+    EEPROMCheck();
+
+    // Con la version actual no se vuelve a inicializar nada
+    int address = EEPROM_CHANNEL_CONTROL_ADDRESS;
+    EEPROM.writeFloat(address, 0.5);
+    EEPROMCheck();
+    TEST_ASSERT_EQUAL_FLOAT(0.5, EEPROM.readFloat(address));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_first_boot);
+    RUN_TEST(test_upgrade_keeps_old_blocks);
+    RUN_TEST(test_current_version_untouched);
+    return UNITY_END();
+}
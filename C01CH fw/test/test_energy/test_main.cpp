@@ -0,0 +1,124 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests del contador de energia (pio test -e native).
+ */
+
+#include <unity.h>
+#include "channel/energyMeter.h"
+
+static DomDomEnergyMeter meter;
+
+void setUp(void)
+{
+    meter.clear();
+}
+
+void tearDown(void) {}
+
+/**
+ * Periodo de la hora @hour contada desde el inicio del dia 0 del mes 0
+ */
+static DomDomEnergyPeriod hourPeriod(int32_t hour)
+{
+    DomDomEnergyPeriod period;
+    period.valid = true;
+    period.hour_key = hour;
+    period.day_key = hour / 24;
+    period.month_key = 0;
+    return period;
+}
+
+/**
+ * Suma @power_W vatios durante una hora en muestras de un segundo
+ */
+static void addHour(float power_W, int32_t hour)
+{
+    for (int s = 0; s < 3600; s++)
+    {
+        meter.add(power_W, 1, hourPeriod(hour));
+    }
+}
+
+void test_hours_and_days(void)
+{
+    addHour(100, 10);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 100, meter.counters().hour_Wh);
+
+    addHour(50, 11);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 50, meter.counters().hour_Wh);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 100, meter.counters().last_hour_Wh);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 150, meter.counters().day_Wh);
+
+    // Saltar una hora deja la anterior a cero
+    addHour(10, 13);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 0, meter.counters().last_hour_Wh);
+
+    addHour(10, 24);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 160, meter.counters().last_day_Wh);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 170, meter.counters().month_Wh);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 170, meter.counters().total_Wh);
+}
+
+void test_rollover_without_power(void)
+{
+    addHour(100, 10);
+    meter.setSaved();
+
+    // Con el canal apagado la hora tambien cambia y hay cambios que guardar
+    addHour(0, 11);
+    TEST_ASSERT_TRUE(meter.isDirty());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 0, meter.counters().hour_Wh);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 100, meter.counters().last_hour_Wh);
+    TEST_ASSERT_EQUAL(11, meter.counters().hour_key);
+
+    addHour(0, 12);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 0, meter.counters().last_hour_Wh);
+
+    // Sin cambio de periodo ni consumo no hay nada que guardar
+    meter.setSaved();
+    meter.add(0, 1, hourPeriod(12));
+    TEST_ASSERT_FALSE(meter.isDirty());
+}
+
+void test_invalid_clock_and_samples(void)
+{
+    // Sin hora solo se acumula en los periodos actuales
+    meter.add(3600, 1, DomDomEnergyPeriod());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1, meter.counters().total_Wh);
+    TEST_ASSERT_EQUAL(-1, meter.counters().hour_key);
+
+    // Muestras demasiado separadas o con tiempo negativo se descartan
+    meter.add(3600, 60, hourPeriod(1));
+    meter.add(3600, -1, hourPeriod(1));
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1, meter.counters().total_Wh);
+    TEST_ASSERT_EQUAL(1, meter.counters().hour_key);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_hours_and_days);
+    RUN_TEST(test_rollover_without_power);
+    RUN_TEST(test_invalid_clock_and_samples);
+    return UNITY_END();
+}
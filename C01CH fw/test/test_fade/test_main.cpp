@@ -0,0 +1,223 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests de la interpolacion de los fundidos en coma fija (pio test -e native).
+ *
+ * Compara con el calculo en coma flotante doble todos los pares de porcentajes
+ * y todos los segundos de los fundidos de hasta dos minutos, mas una muestra
+ * de fundidos largos de hasta una semana. Las formas coseno, smoothstep y
+ * spline se comprueban ademas en sus extremos, su monotonia y su siguiente
+ * escalon.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <unity.h>
+#include "channel/scheduleFade.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+/**
+ * Comprueba DomDomFade contra el calculo en coma flotante en un fundido de @total
+ * segundos, mirando uno de cada @stride segundos. Devuelve el numero de errores.
+ */
+static uint32_t checkFade(uint32_t total, uint32_t stride)
+{
+    uint32_t errors = 0;
+    const uint32_t step = FADE_PERCENT_ONE;
+
+    for (int from = 0; from <= 100; from++)
+    {
+        for (int to = 0; to <= 100; to++)
+        {
+            for (uint64_t elapsed = 0; elapsed <= total; elapsed += stride)
+            {
+                double reference = (from + (to - from) * ((double)elapsed / total)) * FADE_PERCENT_ONE;
+                double value = DomDomFade::interpolate(from, to, elapsed, total);
+
+                // Redondeado al valor mas cercano
+                if (fabs(value - reference) > 0.5 + 1e-6)
+                {
+                    if (errors++ < 5)
+                    {
+                        fprintf(stderr, "interpolate(%d, %d, %u, %u) = %.0f, referencia %.3f\n", from, to, (uint32_t)elapsed, total, value, reference);
+                    }
+                }
+
+                // El siguiente escalon es el primer segundo que pasa del siguiente multiplo de step
+                uint32_t next = DomDomFade::nextStep(from, to, elapsed, total, step);
+                if (from == to || elapsed >= total)
+                {
+                    errors += next != total;
+                    continue;
+                }
+
+                double rate = fabs((double)(to - from)) * FADE_PERCENT_ONE / total;
+                double boundary = (floor(rate * elapsed / step + 1e-9) + 1) * step;
+                bool reached = next >= total || rate * next >= boundary - 1e-6;
+                bool first = rate * (next - 1) < boundary - 1e-6 || next - 1 <= elapsed;
+                if (next <= elapsed || !reached || !first)
+                {
+                    if (errors++ < 5)
+                    {
+                        fprintf(stderr, "nextStep(%d, %d, %u, %u) = %u\n", from, to, (uint32_t)elapsed, total, next);
+                    }
+                }
+            }
+        }
+    }
+
+    return errors;
+}
+
+/**
+ * Forma de referencia en coma flotante (0 - 1) de la curva @curve en @u (0 - 1)
+ */
+static double referenceEase(uint8_t curve, double u)
+{
+    switch (curve)
+    {
+        case FADE_CURVE_COSINE:     return (1 - cos(DomDomFade::PI * u)) / 2;
+        case FADE_CURVE_SMOOTHSTEP: return u * u * (3 - 2 * u);
+        default:                    return u;
+    }
+}
+
+/**
+ * Comprueba los tramos con forma en fundidos de @total segundos: extremos, monotonia,
+ * error frente a la referencia y siguiente escalon. Devuelve el numero de errores.
+ */
+static uint32_t checkCurves(uint32_t total, uint32_t stride)
+{
+    uint32_t errors = 0;
+    const uint32_t step = FADE_PERCENT_ONE;
+
+    for (uint8_t curve = FADE_CURVE_COSINE; curve < FADE_CURVE_COUNT; curve++)
+    {
+        for (int from = 0; from <= 100; from += 5)
+        {
+            for (int to = 0; to <= 100; to += 5)
+            {
+                DomDomFadeSegment segment;
+                segment.from = from;
+                segment.to = to;
+                segment.curve = curve;
+                segment.total = total;
+
+                // Vecinos que suben, bajan o se paran alrededor del tramo
+                uint32_t minutes = total / 60 > 0 ? total / 60 : 1;
+                segment.slope_from = DomDomFade::monotoneSlope(100 - to, minutes, from, to, minutes);
+                segment.slope_to = DomDomFade::monotoneSlope(from, minutes, to, from / 2, minutes * 2);
+
+                uint32_t last = segment.value(0);
+                errors += last != (uint32_t)from * FADE_PERCENT_ONE;
+                errors += segment.value(total) != (uint32_t)to * FADE_PERCENT_ONE;
+
+                for (uint64_t elapsed = 0; elapsed <= total; elapsed += stride)
+                {
+                    uint32_t value = segment.value(elapsed);
+                    double u = (double)elapsed / total;
+                    double reference;
+                    if (curve == FADE_CURVE_SPLINE)
+                    {
+                        double m0 = (double)segment.slope_from * total / 3600;
+                        double m1 = (double)segment.slope_to * total / 3600;
+                        double h01 = u * u * (3 - 2 * u), h10 = u * u * u - 2 * u * u + u, h11 = u * u * u - u * u;
+                        reference = from * (double)FADE_PERCENT_ONE + (to - from) * (double)FADE_PERCENT_ONE * h01 + m0 * h10 + m1 * h11;
+                    }
+                    else
+                    {
+                        reference = (from + (to - from) * referenceEase(curve, u)) * FADE_PERCENT_ONE;
+                    }
+
+                    // Monotona y a menos de 0.01% de la referencia (error de la tabla del coseno)
+                    bool monotone = to >= from ? value >= last : value <= last;
+                    if (!monotone || fabs(value - reference) > FADE_PERCENT_ONE / 100.0)
+                    {
+                        if (errors++ < 5)
+                        {
+                            fprintf(stderr, "curva %d (%d, %d, %u, %u) = %u, referencia %.3f\n", curve, from, to, (uint32_t)elapsed, total, value, reference);
+                        }
+                    }
+                    last = value;
+
+                    // El siguiente escalon es el primer segundo que llega al siguiente multiplo de step
+                    uint32_t next = segment.nextStep(elapsed, step);
+                    if (from == to || elapsed >= total)
+                    {
+                        errors += next != total;
+                        continue;
+                    }
+
+                    uint32_t start = from * FADE_PERCENT_ONE;
+                    uint32_t moved = value > start ? value - start : start - value;
+                    uint32_t target = (moved / step + 1) * step;
+                    uint32_t at = segment.value(next);
+                    uint32_t before = segment.value(next - 1);
+                    bool reached = next >= total || (at > start ? at - start : start - at) >= target;
+                    bool first = next - 1 <= elapsed || (before > start ? before - start : start - before) < target;
+                    if (next <= elapsed || !reached || !first)
+                    {
+                        if (errors++ < 5)
+                        {
+                            fprintf(stderr, "curva %d nextStep(%d, %d, %u, %u) = %u\n", curve, from, to, (uint32_t)elapsed, total, next);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return errors;
+}
+
+void test_short_fades(void)
+{
+    for (uint32_t total = 1; total <= 120; total++)
+    {
+        TEST_ASSERT_EQUAL(0, checkFade(total, 1));
+    }
+}
+
+void test_long_fades(void)
+{
+    TEST_ASSERT_EQUAL(0, checkFade(3600, 1));
+    TEST_ASSERT_EQUAL(0, checkFade(86400, 97));
+    TEST_ASSERT_EQUAL(0, checkFade(604800, 997));
+}
+
+void test_curves(void)
+{
+    TEST_ASSERT_EQUAL(0, checkCurves(600, 1));
+    TEST_ASSERT_EQUAL(0, checkCurves(86400, 97));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_short_fades);
+    RUN_TEST(test_long_fades);
+    RUN_TEST(test_curves);
+    return UNITY_END();
+}
@@ -0,0 +1,167 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests del historico de potencia (pio test -e native).
+ */
+
+#include <unity.h>
+#include "channel/history.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_tier_groups_samples(void)
+{
+    DomDomHistoryBucket buckets[4];
+    DomDomHistoryTier tier(buckets, 4, 60);
+
+    tier.add(120, 10);
+    tier.add(150, 30);
+    tier.add(179, 20);
+
+    uint32_t time;
+    DomDomHistoryBucket bucket;
+    TEST_ASSERT_EQUAL(1, tier.count());
+    TEST_ASSERT_TRUE(tier.get(0, time, bucket));
+    TEST_ASSERT_EQUAL(120, time);
+    TEST_ASSERT_EQUAL(10, bucket.min);
+    TEST_ASSERT_EQUAL(20, bucket.avg);
+    TEST_ASSERT_EQUAL(30, bucket.max);
+    TEST_ASSERT_FALSE(tier.get(1, time, bucket));
+}
+
+void test_tier_leaves_gaps_empty(void)
+{
+    DomDomHistoryBucket buckets[4];
+    DomDomHistoryTier tier(buckets, 4, 1);
+
+    tier.add(10, 5);
+    tier.add(12, 7);
+
+    uint32_t time;
+    DomDomHistoryBucket bucket;
+    TEST_ASSERT_EQUAL(3, tier.count());
+    TEST_ASSERT_TRUE(tier.get(1, time, bucket));
+    TEST_ASSERT_EQUAL(11, time);
+    TEST_ASSERT_TRUE(bucket.min > bucket.max);
+    TEST_ASSERT_TRUE(tier.get(2, time, bucket));
+    TEST_ASSERT_EQUAL(12, time);
+    TEST_ASSERT_EQUAL(7, bucket.avg);
+}
+
+void test_tier_wraps_around(void)
+{
+    DomDomHistoryBucket buckets[4];
+    DomDomHistoryTier tier(buckets, 4, 1);
+
+    for (uint32_t t = 0; t < 10; t++)
+    {
+        tier.add(t, t);
+    }
+
+    // Quedan los cuatro ultimos, del mas antiguo al mas reciente
+    TEST_ASSERT_EQUAL(4, tier.count());
+    for (uint16_t i = 0; i < 4; i++)
+    {
+        uint32_t time;
+        DomDomHistoryBucket bucket;
+        TEST_ASSERT_TRUE(tier.get(i, time, bucket));
+        TEST_ASSERT_EQUAL(6 + i, time);
+        TEST_ASSERT_EQUAL(6 + i, bucket.avg);
+    }
+
+    TEST_ASSERT_EQUAL(0, tier.indexOf(0));
+    TEST_ASSERT_EQUAL(2, tier.indexOf(8));
+    TEST_ASSERT_EQUAL(4, tier.indexOf(100));
+}
+
+void test_tier_restarts(void)
+{
+    DomDomHistoryBucket buckets[4];
+    DomDomHistoryTier tier(buckets, 4, 1);
+
+    // Un hueco que llena todo el buffer deja solo la ultima muestra
+    tier.add(10, 1);
+    tier.add(11, 2);
+    tier.add(20, 3);
+    TEST_ASSERT_EQUAL(1, tier.count());
+
+    // Y un reloj que va hacia atras tambien
+    tier.add(21, 4);
+    tier.add(5, 9);
+    TEST_ASSERT_EQUAL(1, tier.count());
+
+    uint32_t time;
+    DomDomHistoryBucket bucket;
+    TEST_ASSERT_TRUE(tier.get(0, time, bucket));
+    TEST_ASSERT_EQUAL(5, time);
+    TEST_ASSERT_EQUAL(9, bucket.avg);
+}
+
+void test_power_history(void)
+{
+    static DomDomPowerHistory history;
+    history.clear();
+
+    // Dos horas a 2.5 W con una muestra cada medio segundo
+    for (uint32_t ms = 0; ms < 2 * 3600 * 1000; ms += 500)
+    {
+        history.add(ms / 1000, ms, 2.5f);
+    }
+
+    TEST_ASSERT_EQUAL(HISTORY_RAW_SIZE, history.rawCount());
+    TEST_ASSERT_EQUAL(HISTORY_SECONDS_SIZE, history.seconds.count());
+    TEST_ASSERT_EQUAL(120, history.minutes.count());
+    TEST_ASSERT_EQUAL(2, history.hours.count());
+    TEST_ASSERT_TRUE(history.tier(HISTORY_RAW) == nullptr);
+    TEST_ASSERT_TRUE(history.tier(HISTORY_HOURS) == &history.hours);
+
+    DomDomHistorySample sample;
+    TEST_ASSERT_TRUE(history.getRaw(HISTORY_RAW_SIZE - 1, sample));
+    TEST_ASSERT_EQUAL(2 * 3600 * 1000 - 500, sample.time_ms);
+    TEST_ASSERT_EQUAL(250, sample.power);
+
+    uint32_t time;
+    DomDomHistoryBucket bucket;
+    TEST_ASSERT_TRUE(history.hours.get(1, time, bucket));
+    TEST_ASSERT_EQUAL(3600, time);
+    TEST_ASSERT_EQUAL(250, bucket.avg);
+
+    // Las potencias negativas o que no caben se limitan
+    history.add(7200, 7200000, -1);
+    history.add(7200, 7200500, 1000);
+    TEST_ASSERT_TRUE(history.seconds.get(history.seconds.count() - 1, time, bucket));
+    TEST_ASSERT_EQUAL(0, bucket.min);
+    TEST_ASSERT_EQUAL(UINT16_MAX, bucket.max);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_tier_groups_samples);
+    RUN_TEST(test_tier_leaves_gaps_empty);
+    RUN_TEST(test_tier_wraps_around);
+    RUN_TEST(test_tier_restarts);
+    RUN_TEST(test_power_history);
+    return UNITY_END();
+}
@@ -0,0 +1,200 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests del JSON de la programacion, el sol, la luna y el tiempo (pio test -e native).
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include "configuration.h"
+#include "webServer/settingsJson.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_schedule_round_trip(void)
+{
+    DomDomSchedulePointList points;
+    uint8_t values[CHANNEL_SIZE];
+    for (int i = 0; i < EEPROM_MAX_SCHEDULE_POINTS; i++)
+    {
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            values[c] = (i + c) % 101;
+        }
+        points.add(DomDomSchedulePoint(i % 2 ? SEMANA : FESTIVO, i % 24, i % 60, values, i % 3 != 0, i % FADE_CURVE_COUNT));
+    }
+
+    // La programacion completa cabe en la capacidad calculada
+    DynamicJsonDocument doc(DomDomSettingsJson::scheduleCapacity());
+    TEST_ASSERT_TRUE(DomDomSettingsJson::writeSchedule(points, doc));
+    TEST_ASSERT_EQUAL(EEPROM_MAX_SCHEDULE_POINTS, doc["max_schedule_points"].as<int>());
+    TEST_ASSERT_EQUAL(CHANNEL_SIZE, doc["channel_size"].as<int>());
+
+    DomDomSchedulePointList read;
+    TEST_ASSERT_TRUE(DomDomSettingsJson::readSchedule(doc["schedule"].as<JsonArrayConst>(), read));
+    TEST_ASSERT_EQUAL(points.size(), read.size());
+    for (int i = 0; i < points.size(); i++)
+    {
+        TEST_ASSERT_EQUAL(points[i].dayOfWeek, read[i].dayOfWeek);
+        TEST_ASSERT_EQUAL(points[i].hour, read[i].hour);
+        TEST_ASSERT_EQUAL(points[i].minute, read[i].minute);
+        TEST_ASSERT_EQUAL(points[i].fade, read[i].fade);
+        TEST_ASSERT_EQUAL(points[i].curve, read[i].curve);
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            TEST_ASSERT_EQUAL(points[i].value[c], read[i].value[c]);
+        }
+    }
+}
+
+void test_schedule_defaults(void)
+{
+    DynamicJsonDocument doc(1024);
+    TEST_ASSERT_FALSE(deserializeJson(doc, "[{\"hour\":8,\"minute\":30,\"fade\":true,\"values\":[40]}]"));
+
+    // Sin dias es toda la semana y sin forma el fundido es lineal
+    DomDomSchedulePointList points;
+    TEST_ASSERT_TRUE(DomDomSettingsJson::readSchedule(doc.as<JsonArrayConst>(), points));
+    TEST_ASSERT_EQUAL(1, points.size());
+    TEST_ASSERT_EQUAL(ALL, points[0].dayOfWeek);
+    TEST_ASSERT_EQUAL(8, points[0].hour);
+    TEST_ASSERT_EQUAL(30, points[0].minute);
+    TEST_ASSERT_TRUE(points[0].fade);
+    TEST_ASSERT_EQUAL(FADE_CURVE_LINEAR, points[0].curve);
+    TEST_ASSERT_EQUAL(40, points[0].value[0]);
+}
+
+void test_schedule_not_array(void)
+{
+    DynamicJsonDocument doc(1024);
+    TEST_ASSERT_FALSE(deserializeJson(doc, "{\"hour\":8}"));
+
+    DomDomSchedulePointList points;
+    TEST_ASSERT_FALSE(DomDomSettingsJson::readSchedule(doc.as<JsonArrayConst>(), points));
+    TEST_ASSERT_EQUAL(0, points.size());
+}
+
+void test_schedule_invalid_days(void)
+{
+    DynamicJsonDocument doc(1024);
+    DomDomSchedulePointList points;
+
+    // Sin ningun dia o con dias que no existen se rechaza toda la programacion
+    const char *invalid[] = {
+        "[{\"hour\":8,\"minute\":0,\"values\":[40]},{\"hour\":9,\"minute\":0,\"days\":0,\"values\":[40]}]",
+        "[{\"hour\":8,\"minute\":0,\"days\":128,\"values\":[40]}]",
+        "[{\"hour\":8,\"minute\":0,\"days\":-1,\"values\":[40]}]",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        TEST_ASSERT_FALSE(deserializeJson(doc, invalid[i]));
+        TEST_ASSERT_FALSE_MESSAGE(DomDomSettingsJson::readSchedule(doc.as<JsonArrayConst>(), points), invalid[i]);
+        TEST_ASSERT_EQUAL(0, points.size());
+    }
+}
+
+void test_solar(void)
+{
+    DomDomSolarSettings solar;
+    solar.latitude = 40;
+    solar.longitude = -3;
+
+    // Lo que no se envia se mantiene y los valores se limitan al 100%
+    StaticJsonDocument<512> doc;
+    TEST_ASSERT_FALSE(deserializeJson(doc, "{\"enabled\":true,\"values\":[150]}"));
+    TEST_ASSERT_TRUE(DomDomSettingsJson::readSolar(doc.as<JsonObjectConst>(), solar));
+    TEST_ASSERT_TRUE(solar.enabled);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 40, solar.latitude);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -3, solar.longitude);
+    TEST_ASSERT_EQUAL(100, solar.value[0]);
+
+    // Fuera de rango no cambia nada
+    TEST_ASSERT_FALSE(deserializeJson(doc, "{\"enabled\":false,\"latitude\":91}"));
+    TEST_ASSERT_FALSE(DomDomSettingsJson::readSolar(doc.as<JsonObjectConst>(), solar));
+    TEST_ASSERT_TRUE(solar.enabled);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 40, solar.latitude);
+}
+
+void test_moon(void)
+{
+    DomDomMoonSettings moon;
+
+    StaticJsonDocument<512> doc;
+    TEST_ASSERT_FALSE(deserializeJson(doc, "{\"enabled\":true,\"values\":[100]}"));
+    TEST_ASSERT_TRUE(DomDomSettingsJson::readMoon(doc.as<JsonObjectConst>(), moon));
+    TEST_ASSERT_TRUE(moon.enabled);
+    TEST_ASSERT_EQUAL(SCHEDULE_MOON_MAX_PERCENT, moon.value[0]);
+}
+
+void test_weather(void)
+{
+    DomDomWeatherSettings weather;
+    weather.cloud_min_s = 10;
+    weather.cloud_max_s = 60;
+
+    // Lo que no se envia se mantiene
+    StaticJsonDocument<512> doc;
+    TEST_ASSERT_FALSE(deserializeJson(doc, "{\"enabled\":true,\"cloud_depth\":70,\"flashes_per_hour\":12}"));
+    TEST_ASSERT_TRUE(DomDomSettingsJson::readWeather(doc.as<JsonObjectConst>(), weather));
+    TEST_ASSERT_TRUE(weather.enabled);
+    TEST_ASSERT_EQUAL(70, weather.cloud_depth);
+    TEST_ASSERT_EQUAL(12, weather.flashes_per_hour);
+    TEST_ASSERT_EQUAL(10, weather.cloud_min_s);
+    TEST_ASSERT_EQUAL(60, weather.cloud_max_s);
+
+    // Valores no validos: no cambia nada
+    const char *invalid[] = {
+        "{\"cloud_depth\":101}",
+        "{\"flash_intensity\":101}",
+        "{\"cloud_min_s\":61}",
+        "{\"clouds_per_hour\":3601}",
+        "{\"cloud_depth\":300}",
+        "{\"cloud_depth\":-5}",
+        "{\"cloud_depth\":\"70\"}",
+        "{\"cloud_max_s\":70000}",
+        "{\"seed\":-1}",
+        "{\"enabled\":1}",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        TEST_ASSERT_FALSE(deserializeJson(doc, invalid[i]));
+        TEST_ASSERT_FALSE_MESSAGE(DomDomSettingsJson::readWeather(doc.as<JsonObjectConst>(), weather), invalid[i]);
+    }
+    TEST_ASSERT_EQUAL(70, weather.cloud_depth);
+    TEST_ASSERT_EQUAL(10, weather.cloud_min_s);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_schedule_round_trip);
+    RUN_TEST(test_schedule_defaults);
+    RUN_TEST(test_schedule_not_array);
+    RUN_TEST(test_schedule_invalid_days);
+    RUN_TEST(test_solar);
+    RUN_TEST(test_moon);
+    RUN_TEST(test_weather);
+    return UNITY_END();
+}
@@ -0,0 +1,118 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests de la luz de luna (pio test -e native).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unity.h>
+#include <RTClib.h>
+#include "channel/astronomy.h"
+#include "channel/solarTable.h"
+#include "channel/moonTable.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+/**
+ * Comprueba la fase (grados) y la fraccion iluminada de la luna en el instante @utc
+ * contra las publicadas. Devuelve el numero de errores.
+ */
+static uint32_t checkMoonPhase(DateTime utc, float phase, float illumination)
+{
+    float ra, dec, found, lit;
+    DomDomAstronomy::moon(DomDomAstronomy::daysSinceJ2000(utc.unixtime()), ra, dec, found, lit);
+
+    float error = fabsf(found - phase);
+    error = error > 180 ? 360 - error : error;
+
+    bool ok = error <= 1.5f && fabsf(lit - illumination) <= 0.02f;
+    if (!ok)
+    {
+        fprintf(stderr, "luna %s: fase %.2f (%.2f), iluminada %.3f (%.3f)\n", utc.timestamp().c_str(), found, phase, lit, illumination);
+    }
+
+    return ok ? 0 : 1;
+}
+
+/**
+ * Comprueba la tabla de luz de luna en @latitude, @longitude el dia @date con @utcOffset
+ * segundos respecto a UTC: con luna llena sale al ponerse el sol y con luna nueva al
+ * salir el sol, y su luz maxima por la noche es la fraccion iluminada @illumination.
+ * Devuelve el numero de errores.
+ */
+static uint32_t checkMoonTable(DateTime date, float latitude, float longitude, int32_t utcOffset, bool full, float illumination)
+{
+    DomDomSolarTable sun;
+    DomDomMoonTable moon;
+    sun.compile(date.unixtime(), latitude, longitude, utcOffset);
+    moon.compile(date.unixtime(), latitude, longitude, utcOffset);
+
+    int sunEvent = full ? sun.sunset() : sun.sunrise();
+    int moonEvent = moon.moonrise();
+
+    // De dia no hay luz de luna
+    uint16_t night = 0, day = 0;
+    for (int m = 0; m < INTENSITY_TABLE_SIZE; m++)
+    {
+        bool daylight = m >= sun.sunrise() && m < sun.sunset();
+        uint16_t &maximum = daylight ? day : night;
+        maximum = moon.intensity(m) > maximum ? moon.intensity(m) : maximum;
+    }
+
+    bool ok = moonEvent >= 0 && abs(moonEvent - sunEvent) <= 60;
+    ok = ok && day == 0 && fabsf(night / (float)UINT16_MAX - illumination) <= 0.03f;
+    ok = ok && moon.isFor(date.unixtime());
+
+    if (!ok)
+    {
+        fprintf(stderr, "luna %s: orto %d, sol %d, maximo noche %u, dia %u\n", date.timestamp().c_str(), moonEvent, sunEvent, night, day);
+    }
+
+    return ok ? 0 : 1;
+}
+
+void test_phases(void)
+{
+    // Cuarto creciente, luna llena, cuarto menguante y luna nueva de otoño de 2020 (UTC)
+    TEST_ASSERT_EQUAL(0, checkMoonPhase(DateTime(2020, 10, 23, 13, 23, 0), 90, 0.5f));
+    TEST_ASSERT_EQUAL(0, checkMoonPhase(DateTime(2020, 10, 31, 14, 49, 0), 180, 1));
+    TEST_ASSERT_EQUAL(0, checkMoonPhase(DateTime(2020, 11, 8, 13, 46, 0), 270, 0.5f));
+    TEST_ASSERT_EQUAL(0, checkMoonPhase(DateTime(2020, 11, 15, 5, 7, 0), 0, 0));
+}
+
+void test_table(void)
+{
+    TEST_ASSERT_EQUAL(0, checkMoonTable(DateTime(2020, 10, 31), 40.4168f, -3.7038f, 3600, true, 1));
+    TEST_ASSERT_EQUAL(0, checkMoonTable(DateTime(2020, 11, 15), 40.4168f, -3.7038f, 3600, false, 0));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_phases);
+    RUN_TEST(test_table);
+    return UNITY_END();
+}
@@ -0,0 +1,117 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests de la lista de puntos de programacion (pio test -e native).
+ */
+
+#include <stdlib.h>
+#include <new>
+#include <unity.h>
+#include "channel/schedulePoint.h"
+#include "channel/scheduleTimeline.h"
+
+/**
+ * Reservas de memoria hechas con new desde el inicio del programa
+ */
+static uint32_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *memory = malloc(size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_add_and_full(void)
+{
+    DomDomSchedulePointList points;
+    TEST_ASSERT_EQUAL(0, points.size());
+
+    uint8_t values[CHANNEL_SIZE] = {};
+    for (int i = 0; i < EEPROM_MAX_SCHEDULE_POINTS; i++)
+    {
+        values[0] = i;
+        TEST_ASSERT_FALSE(points.full());
+        TEST_ASSERT_TRUE(points.add(DomDomSchedulePoint(ALL, i % 24, i % 60, values)));
+    }
+
+    // Los puntos se guardan por valor en el orden en el que se añaden
+    TEST_ASSERT_TRUE(points.full());
+    TEST_ASSERT_FALSE(points.add(DomDomSchedulePoint()));
+    TEST_ASSERT_EQUAL(EEPROM_MAX_SCHEDULE_POINTS, points.size());
+    for (int i = 0; i < EEPROM_MAX_SCHEDULE_POINTS; i++)
+    {
+        TEST_ASSERT_EQUAL(i, points[i].value[0]);
+        TEST_ASSERT_EQUAL(i % 24, points[i].hour);
+    }
+
+    points.clear();
+    TEST_ASSERT_EQUAL(0, points.size());
+}
+
+void test_uploads_do_not_allocate(void)
+{
+    static DomDomSchedulePointList points;
+    static DomDomScheduleTimeline timeline;
+    uint8_t values[CHANNEL_SIZE] = {};
+
+    // Como hace el servidor web: borra los puntos y la linea de tiempo y añade los nuevos
+    uint32_t start = allocations;
+    for (uint32_t u = 0; u < 1000; u++)
+    {
+        points.clear();
+        timeline.clear();
+        for (int i = 0; i < EEPROM_MAX_SCHEDULE_POINTS; i++)
+        {
+            values[0] = u + i;
+            TEST_ASSERT_TRUE(points.add(DomDomSchedulePoint(ALL, i % 24, i % 60, values)));
+            TEST_ASSERT_TRUE(timeline.add((i % 24) * 60 + i % 60, ALL, points.size() - 1));
+        }
+
+        // El ultimo punto guarda sus valores
+        TEST_ASSERT_EQUAL((uint8_t)(u + EEPROM_MAX_SCHEDULE_POINTS - 1), points[EEPROM_MAX_SCHEDULE_POINTS - 1].value[0]);
+    }
+
+    TEST_ASSERT_EQUAL(0, allocations - start);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_add_and_full);
+    RUN_TEST(test_uploads_do_not_allocate);
+    return UNITY_END();
+}
@@ -0,0 +1,125 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests de la publicacion de la programacion con DomDomDoubleBuffer (pio test -e native).
+ */
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <unity.h>
+#include "channel/compiledSchedule.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+/**
+ * Publica @publications programaciones de @size puntos mientras @readers hilos las leen.
+ * Todos los puntos de cada programacion tienen como valor su numero de publicacion,
+ * asi que una lectura que mezcle dos programaciones se detecta. Devuelve el numero de
+ * lecturas mezcladas y en @reads las lecturas hechas.
+ */
+static uint32_t checkPublish(int size, uint32_t publications, int readers, uint32_t &reads)
+{
+    static DomDomDoubleBuffer<DomDomCompiledSchedule> buffer;
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> errors(0), total(0);
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; r++)
+    {
+        threads.push_back(std::thread([&]()
+        {
+            uint32_t count = 0;
+            while (!done.load())
+            {
+                DomDomScheduleReader schedule(buffer);
+                uint8_t generation = schedule->points.size() > 0 ? schedule->points[0].value[0] : 0;
+                bool ok = schedule->points.size() == 0 || schedule->points.size() == size;
+                ok = ok && schedule->timeline.count() == schedule->points.size();
+                for (int i = 0; i < schedule->points.size(); i++)
+                {
+                    ok = ok && schedule->points[i].value[CHANNEL_SIZE - 1] == generation;
+                }
+                errors += !ok;
+
+                // Dejamos avanzar al escritor aunque haya un solo nucleo
+                if (++count % 64 == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            total += count;
+        }));
+    }
+
+    uint8_t values[CHANNEL_SIZE];
+    for (uint32_t p = 1; p <= publications; p++)
+    {
+        DomDomCompiledSchedule *schedule;
+        while ((schedule = buffer.back()) == nullptr)
+        {
+            std::this_thread::yield();
+        }
+
+        schedule->clear();
+        for (int c = 0; c < CHANNEL_SIZE; c++)
+        {
+            values[c] = p;
+        }
+        for (int i = 0; i < size; i++)
+        {
+            schedule->add(DomDomSchedulePoint(ALL, (i + p) % 24, i % 60, values));
+        }
+        schedule->compile();
+        buffer.publish();
+    }
+
+    done = true;
+    for (int r = 0; r < readers; r++)
+    {
+        threads[r].join();
+    }
+
+    reads = total;
+    if (errors > 0)
+    {
+        fprintf(stderr, "publicacion: %u lecturas mezcladas de %u\n", errors.load(), reads);
+    }
+
+    return errors;
+}
+
+void test_readers_see_whole_schedules(void)
+{
+    uint32_t reads;
+    TEST_ASSERT_EQUAL(0, checkPublish(EEPROM_MAX_SCHEDULE_POINTS, 5000, 3, reads));
+    TEST_ASSERT_TRUE(reads > 0);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_readers_see_whole_schedules);
+    return UNITY_END();
+}
@@ -0,0 +1,200 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests del gestor de la programacion (pio test -e native).
+ *
+ * Preparacion y publicacion de la programacion y copia en la EEPROM
+ * del host, sin arrancar la tarea del programador.
+ */
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <unity.h>
+#include "configuration.h"
+#include "channel/ScheduleMgt.h"
+
+#define TEST_EEPROM_FILE    "test_schedule.bin"
+
+static DomDomScheduleMgtClass *scheduleMgt;
+
+void setUp(void)
+{
+    // EEPROM borrada en cada test
+    remove(TEST_EEPROM_FILE);
+    EEPROM.setFile(TEST_EEPROM_FILE);
+    EEPROM.begin(EEPROM_SIZE);
+    scheduleMgt = new DomDomScheduleMgtClass();
+}
+
+void tearDown(void)
+{
+    delete scheduleMgt;
+    EEPROM.end();
+    remove(TEST_EEPROM_FILE);
+}
+
+static uint8_t pointCount()
+{
+    DomDomScheduleReader schedule(scheduleMgt->schedule());
+    return schedule->points.size();
+}
+
+void test_publish_replaces_schedule(void)
+{
+    uint8_t values[CHANNEL_SIZE] = { 50 };
+
+    scheduleMgt->beginEdit();
+    scheduleMgt->addSchedulePoint(ALL, 8, 0, values, true);
+    scheduleMgt->publish();
+    TEST_ASSERT_EQUAL(1, pointCount());
+
+    // Lo que se prepara no se ve hasta publicarlo
+    scheduleMgt->beginEdit();
+    scheduleMgt->addSchedulePoint(ALL, 9, 0, values, true);
+    scheduleMgt->addSchedulePoint(ALL, 21, 0, values, true);
+    TEST_ASSERT_EQUAL(1, pointCount());
+    scheduleMgt->publish();
+    TEST_ASSERT_EQUAL(2, pointCount());
+
+    scheduleMgt->clear();
+    TEST_ASSERT_EQUAL(0, pointCount());
+}
+
+void test_add_outside_edit_or_invalid_is_ignored(void)
+{
+    uint8_t values[CHANNEL_SIZE] = { 50 };
+
+    scheduleMgt->addSchedulePoint(ALL, 8, 0, values, true);
+    TEST_ASSERT_EQUAL(0, pointCount());
+
+    scheduleMgt->beginEdit();
+    scheduleMgt->addSchedulePoint(ALL, 24, 0, values, true);
+    scheduleMgt->addSchedulePoint(ALL, 8, 60, values, true);
+    for (int i = 0; i < EEPROM_MAX_SCHEDULE_POINTS + 5; i++)
+    {
+        scheduleMgt->addSchedulePoint(ALL, i % 24, i % 60, values, true);
+    }
+    scheduleMgt->publish();
+    TEST_ASSERT_EQUAL(EEPROM_MAX_SCHEDULE_POINTS, pointCount());
+}
+
+void test_save_and_load(void)
+{
+    uint8_t morning[CHANNEL_SIZE], night[CHANNEL_SIZE];
+    for (int c = 0; c < CHANNEL_SIZE; c++)
+    {
+        morning[c] = 80;
+        night[c] = 5;
+    }
+
+    scheduleMgt->beginEdit();
+    scheduleMgt->addSchedulePoint(SEMANA, 8, 30, morning, true, FADE_CURVE_SPLINE);
+    scheduleMgt->addSchedulePoint(FESTIVO, 22, 15, night, false);
+    scheduleMgt->publish();
+
+    DomDomSolarSettings solar;
+    solar.enabled = true;
+    solar.latitude = 40.4f;
+    solar.longitude = -3.7f;
+    scheduleMgt->setSolar(solar);
+
+    DomDomMoonSettings moon;
+    moon.enabled = true;
+    scheduleMgt->setMoon(moon);
+
+    TEST_ASSERT_TRUE(scheduleMgt->save());
+
+    // Otro gestor con la misma EEPROM
+    delete scheduleMgt;
+    scheduleMgt = new DomDomScheduleMgtClass();
+    TEST_ASSERT_TRUE(scheduleMgt->load());
+
+    {
+        DomDomScheduleReader schedule(scheduleMgt->schedule());
+        const DomDomSchedulePointList &points = schedule->points;
+        TEST_ASSERT_EQUAL(2, points.size());
+
+        TEST_ASSERT_EQUAL(SEMANA, points[0].dayOfWeek);
+        TEST_ASSERT_EQUAL(8, points[0].hour);
+        TEST_ASSERT_EQUAL(30, points[0].minute);
+        TEST_ASSERT_TRUE(points[0].fade);
+        TEST_ASSERT_EQUAL(FADE_CURVE_SPLINE, points[0].curve);
+        TEST_ASSERT_EQUAL(80, points[0].value[0]);
+
+        TEST_ASSERT_EQUAL(FESTIVO, points[1].dayOfWeek);
+        TEST_ASSERT_EQUAL(22, points[1].hour);
+        TEST_ASSERT_EQUAL(15, points[1].minute);
+        TEST_ASSERT_FALSE(points[1].fade);
+        TEST_ASSERT_EQUAL(5, points[1].value[0]);
+    }
+
+    TEST_ASSERT_TRUE(scheduleMgt->solar().enabled);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 40.4, scheduleMgt->solar().latitude);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -3.7, scheduleMgt->solar().longitude);
+    TEST_ASSERT_TRUE(scheduleMgt->moon().enabled);
+}
+
+void test_load_blank_eeprom(void)
+{
+    // EEPROM sin escribir (0xFF): sin puntos y la configuracion por defecto
+    TEST_ASSERT_TRUE(scheduleMgt->load());
+    TEST_ASSERT_EQUAL(0, pointCount());
+    TEST_ASSERT_FALSE(scheduleMgt->solar().enabled);
+    TEST_ASSERT_FALSE(scheduleMgt->moon().enabled);
+}
+
+void test_get_schedule_point(void)
+{
+    uint8_t values[CHANNEL_SIZE] = { 50 };
+
+    scheduleMgt->beginEdit();
+    scheduleMgt->addSchedulePoint(ALL, 8, 0, values, true);
+    scheduleMgt->addSchedulePoint(ALL, 20, 0, values, true);
+    scheduleMgt->publish();
+
+    // Miercoles 1 de julio de 2020 a las 12:00
+    DateTime now(2020, 7, 1, 12, 0, 0);
+    DateTime dt;
+    DomDomSchedulePoint point;
+
+    TEST_ASSERT_TRUE(scheduleMgt->getShedulePoint(now, dt, point, true));
+    TEST_ASSERT_EQUAL(8, point.hour);
+    TEST_ASSERT_EQUAL(DateTime(2020, 7, 1, 8, 0, 0).unixtime(), dt.unixtime());
+
+    TEST_ASSERT_TRUE(scheduleMgt->getShedulePoint(now, dt, point, false));
+    TEST_ASSERT_EQUAL(20, point.hour);
+    TEST_ASSERT_EQUAL(DateTime(2020, 7, 1, 20, 0, 0).unixtime(), dt.unixtime());
+
+    scheduleMgt->clear();
+    TEST_ASSERT_FALSE(scheduleMgt->getShedulePoint(now, dt, point, true));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_publish_replaces_schedule);
+    RUN_TEST(test_add_outside_edit_or_invalid_is_ignored);
+    RUN_TEST(test_save_and_load);
+    RUN_TEST(test_load_blank_eeprom);
+    RUN_TEST(test_get_schedule_point);
+    return UNITY_END();
+}
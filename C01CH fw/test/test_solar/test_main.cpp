@@ -0,0 +1,85 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests de la tabla de la programacion solar (pio test -e native).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+#include <RTClib.h>
+#include "channel/solarTable.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+/**
+ * Comprueba el orto y el ocaso de la tabla solar en @latitude, @longitude el dia @date con
+ * @utcOffset segundos respecto a UTC contra los publicados (minuto del dia, -1 si no hay).
+ * Devuelve el numero de errores.
+ */
+static uint32_t checkSolar(DateTime date, float latitude, float longitude, int32_t utcOffset, int sunrise, int sunset)
+{
+    DomDomSolarTable table;
+    table.compile(date.unixtime(), latitude, longitude, utcOffset);
+
+    // Las efemerides publicadas redondean al minuto
+    bool ok = abs(table.sunrise() - sunrise) <= 2 && abs(table.sunset() - sunset) <= 2;
+    ok = ok && (sunrise < 0) == (table.sunrise() < 0) && (sunset < 0) == (table.sunset() < 0);
+
+    // De noche no hay luz y al mediodia solar se llega al maximo
+    uint16_t maximum = 0;
+    for (int m = 0; m < INTENSITY_TABLE_SIZE; m++)
+    {
+        maximum = table.intensity(m) > maximum ? table.intensity(m) : maximum;
+    }
+    ok = ok && table.intensity(0) == 0 && (sunrise < 0 || maximum == UINT16_MAX);
+    ok = ok && table.isFor(date.unixtime()) && !table.isFor(date.unixtime() + 86400);
+
+    if (!ok)
+    {
+        fprintf(stderr, "solar %s: orto %d (%d), ocaso %d (%d), maximo %u\n", date.timestamp().c_str(), table.sunrise(), sunrise, table.sunset(), sunset, maximum);
+    }
+
+    return ok ? 0 : 1;
+}
+
+void test_madrid_solstices(void)
+{
+    TEST_ASSERT_EQUAL(0, checkSolar(DateTime(2020, 6, 21), 40.4168f, -3.7038f, 7200, 6 * 60 + 44, 21 * 60 + 48));
+    TEST_ASSERT_EQUAL(0, checkSolar(DateTime(2020, 12, 21), 40.4168f, -3.7038f, 3600, 8 * 60 + 33, 17 * 60 + 53));
+}
+
+void test_polar_night(void)
+{
+    // Tromso en la noche polar
+    TEST_ASSERT_EQUAL(0, checkSolar(DateTime(2020, 12, 21), 69.6492f, 18.9553f, 3600, -1, -1));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_madrid_solstices);
+    RUN_TEST(test_polar_night);
+    return UNITY_END();
+}
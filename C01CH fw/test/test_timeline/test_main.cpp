@@ -0,0 +1,265 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests de la linea de tiempo de la programacion (pio test -e native).
+ *
+ * Compara la busqueda binaria con un recorrido de todos los puntos en
+ * todos los minutos de la semana, y comprueba con DomDomCompiledSchedule::find
+ * las fechas de los puntos al cambiar de dia.
+ */
+
+#include <unity.h>
+#include "channel/schedulePoint.h"
+#include "channel/scheduleTimeline.h"
+#include "channel/compiledSchedule.h"
+
+/**
+ * Minuto del dia y dias de la semana de cada punto, en el orden en el que se añadieron
+ */
+struct TestPoint
+{
+    uint16_t minute;
+    uint8_t days;
+};
+
+static TestPoint points[EEPROM_MAX_SCHEDULE_POINTS];
+static uint8_t count;
+static DomDomScheduleTimeline timeline;
+static DomDomCompiledSchedule schedule;
+
+void setUp(void)
+{
+    count = 0;
+    timeline.clear();
+    schedule.clear();
+}
+
+void tearDown(void) {}
+
+static void addPoint(uint16_t minute, uint8_t days)
+{
+    points[count].minute = minute;
+    points[count].days = days;
+    TEST_ASSERT_TRUE(timeline.add(minute, days, count));
+    count++;
+
+    TEST_ASSERT_TRUE(schedule.add(DomDomSchedulePoint((DomDomDayOfWeek)days, minute / 60, minute % 60)));
+}
+
+/**
+ * Comprueba que find() devuelve en @now el punto @point (anterior si @previous) a la hora @expected
+ */
+static void checkFind(const DateTime &now, bool previous, int point, const DateTime &expected)
+{
+    DateTime dt;
+    const DomDomTimelineEntry *entry;
+    TEST_ASSERT_TRUE(schedule.find(now, dt, entry, previous));
+    TEST_ASSERT_EQUAL(point, entry->point);
+    TEST_ASSERT_EQUAL(expected.unixtime(), dt.unixtime());
+}
+
+/**
+ * Busqueda de referencia: prueba cada punto en el dia @day y en los siete anteriores
+ * (@previous) o siguientes. Con varios puntos en el mismo minuto gana el primero.
+ * Devuelve el punto o -1 y en @at su minuto contado desde el inicio del dia @day.
+ */
+static int reference(uint8_t day, uint16_t minute, bool previous, int32_t &at)
+{
+    int found = -1;
+    for (int i = 0; i < count; i++)
+    {
+        for (int32_t k = 0; k <= SCHEDULE_DAYS_PER_WEEK; k++)
+        {
+            uint8_t weekday = previous ? (day + SCHEDULE_DAYS_PER_WEEK - k % SCHEDULE_DAYS_PER_WEEK) % SCHEDULE_DAYS_PER_WEEK : (day + k) % SCHEDULE_DAYS_PER_WEEK;
+            int32_t time = points[i].minute + (previous ? -k : k) * SCHEDULE_MINUTES_PER_DAY;
+            bool candidate = previous ? time <= minute : time > minute;
+            if (!(points[i].days & (1 << weekday)) || !candidate)
+            {
+                continue;
+            }
+
+            bool better = previous ? time > at : time < at;
+            if (found == -1 || better)
+            {
+                found = i;
+                at = time;
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+ * Compara previous() y next() con la referencia en todos los minutos de la semana
+ */
+static void checkWeek()
+{
+    for (uint8_t day = 0; day < SCHEDULE_DAYS_PER_WEEK; day++)
+    {
+        for (uint16_t minute = 0; minute < SCHEDULE_MINUTES_PER_DAY; minute++)
+        {
+            for (int previous = 0; previous < 2; previous++)
+            {
+                int32_t expected_at = 0, at = 0;
+                int expected = reference(day, minute, previous, expected_at);
+
+                const DomDomTimelineEntry *entry;
+                bool found = previous ? timeline.previous(day, minute, entry, at) : timeline.next(day, minute, entry, at);
+                TEST_ASSERT_EQUAL(expected != -1, found);
+                if (found)
+                {
+                    TEST_ASSERT_EQUAL(expected, entry->point);
+                    TEST_ASSERT_EQUAL(expected_at, at);
+                }
+            }
+        }
+    }
+}
+
+void test_empty(void)
+{
+    const DomDomTimelineEntry *entry;
+    int32_t at;
+    TEST_ASSERT_FALSE(timeline.previous(0, 0, entry, at));
+    TEST_ASSERT_FALSE(timeline.next(6, 1439, entry, at));
+}
+
+void test_invalid_and_full(void)
+{
+    TEST_ASSERT_FALSE(timeline.add(SCHEDULE_MINUTES_PER_DAY, ALL, 0));
+    for (int i = 0; i < EEPROM_MAX_SCHEDULE_POINTS; i++)
+    {
+        TEST_ASSERT_TRUE(timeline.add(i, ALL, i));
+    }
+    TEST_ASSERT_FALSE(timeline.add(0, ALL, 0));
+    TEST_ASSERT_EQUAL(EEPROM_MAX_SCHEDULE_POINTS, timeline.count());
+}
+
+void test_single_point(void)
+{
+    // Antes del punto el anterior es el de ayer y despues el siguiente es el de mañana
+    addPoint(8 * 60, ALL);
+    checkWeek();
+
+    const DomDomTimelineEntry *entry;
+    int32_t at;
+    TEST_ASSERT_TRUE(timeline.previous(3, 7 * 60, entry, at));
+    TEST_ASSERT_EQUAL(8 * 60 - SCHEDULE_MINUTES_PER_DAY, at);
+    TEST_ASSERT_TRUE(timeline.next(3, 8 * 60, entry, at));
+    TEST_ASSERT_EQUAL(8 * 60 + SCHEDULE_MINUTES_PER_DAY, at);
+}
+
+void test_random_points(void)
+{
+    // Puntos repetibles en cualquier orden, con algun minuto repetido
+    uint32_t seed = 12345;
+    for (int i = 0; i < EEPROM_MAX_SCHEDULE_POINTS; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        addPoint((seed >> 8) % (SCHEDULE_MINUTES_PER_DAY / 10) * 10, ALL);
+    }
+    checkWeek();
+}
+
+void test_weekdays_and_weekend(void)
+{
+    addPoint(7 * 60, SEMANA);
+    addPoint(9 * 60, FESTIVO);
+    checkWeek();
+
+    // 2020-03-02 es lunes: a las 6:00 sigue en vigor el punto del domingo
+    checkFind(DateTime(2020, 3, 2, 6, 0, 0), true, 1, DateTime(2020, 3, 1, 9, 0, 0));
+    checkFind(DateTime(2020, 3, 2, 6, 0, 0), false, 0, DateTime(2020, 3, 2, 7, 0, 0));
+    // El sabado a las 8:00 sigue el del viernes y el siguiente es el de fin de semana
+    checkFind(DateTime(2020, 3, 7, 8, 0, 0), true, 0, DateTime(2020, 3, 6, 7, 0, 0));
+    checkFind(DateTime(2020, 3, 7, 8, 0, 0), false, 1, DateTime(2020, 3, 7, 9, 0, 0));
+    // El viernes por la tarde el siguiente es el del sabado, no el del lunes
+    checkFind(DateTime(2020, 3, 6, 20, 0, 0), false, 1, DateTime(2020, 3, 7, 9, 0, 0));
+}
+
+void test_saturday_to_sunday(void)
+{
+    addPoint(10, DOMINGO);
+    addPoint(23 * 60 + 30, SABADO);
+    checkWeek();
+
+    // 2020-02-29 es sabado: el siguiente punto es el del domingo, en otro mes
+    checkFind(DateTime(2020, 2, 29, 23, 50, 0), true, 1, DateTime(2020, 2, 29, 23, 30, 0));
+    checkFind(DateTime(2020, 2, 29, 23, 50, 0), false, 0, DateTime(2020, 3, 1, 0, 10, 0));
+    checkFind(DateTime(2020, 3, 1, 0, 5, 0), true, 1, DateTime(2020, 2, 29, 23, 30, 0));
+}
+
+void test_fade_across_midnight(void)
+{
+    // Fundido desde el viernes a las 22:00 hasta el sabado a las 2:00
+    addPoint(22 * 60, VIERNES);
+    addPoint(2 * 60, SABADO);
+    checkWeek();
+
+    const DomDomTimelineEntry *entry;
+    int32_t at;
+    TEST_ASSERT_TRUE(timeline.previous(6, 60, entry, at));
+    TEST_ASSERT_EQUAL(0, entry->point);
+    TEST_ASSERT_EQUAL(22 * 60 - SCHEDULE_MINUTES_PER_DAY, at);
+    TEST_ASSERT_TRUE(timeline.next(6, 60, entry, at));
+    TEST_ASSERT_EQUAL(1, entry->point);
+    TEST_ASSERT_EQUAL(2 * 60, at);
+
+    checkFind(DateTime(2020, 3, 7, 1, 0, 0), true, 0, DateTime(2020, 3, 6, 22, 0, 0));
+    checkFind(DateTime(2020, 3, 7, 1, 0, 0), false, 1, DateTime(2020, 3, 7, 2, 0, 0));
+    // Despues del fundido el siguiente es el del viernes de la semana siguiente
+    checkFind(DateTime(2020, 3, 7, 3, 0, 0), false, 0, DateTime(2020, 3, 13, 22, 0, 0));
+}
+
+void test_empty_days(void)
+{
+    addPoint(12 * 60, LUNES);
+    checkWeek();
+
+    // El jueves hay que volver tres dias atras y avanzar cuatro
+    const DomDomTimelineEntry *entry;
+    int32_t at;
+    TEST_ASSERT_TRUE(timeline.previous(4, 10 * 60, entry, at));
+    TEST_ASSERT_EQUAL(12 * 60 - 3 * SCHEDULE_MINUTES_PER_DAY, at);
+    TEST_ASSERT_TRUE(timeline.next(4, 10 * 60, entry, at));
+    TEST_ASSERT_EQUAL(12 * 60 + 4 * SCHEDULE_MINUTES_PER_DAY, at);
+
+    // El mismo lunes antes del punto, el anterior es el de hace una semana
+    checkFind(DateTime(2020, 3, 2, 11, 0, 0), true, 0, DateTime(2020, 2, 24, 12, 0, 0));
+    checkFind(DateTime(2020, 3, 2, 12, 0, 0), false, 0, DateTime(2020, 3, 9, 12, 0, 0));
+    checkFind(DateTime(2020, 3, 1, 23, 59, 0), true, 0, DateTime(2020, 2, 24, 12, 0, 0));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty);
+    RUN_TEST(test_invalid_and_full);
+    RUN_TEST(test_single_point);
+    RUN_TEST(test_random_points);
+    RUN_TEST(test_weekdays_and_weekend);
+    RUN_TEST(test_saturday_to_sunday);
+    RUN_TEST(test_fade_across_midnight);
+    RUN_TEST(test_empty_days);
+    return UNITY_END();
+}
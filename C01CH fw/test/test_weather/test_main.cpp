@@ -0,0 +1,90 @@
+/**
+ * DomDom Firmware
+ * Copyright (c) 2020 DomDomFirmware
+ *
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/**
+ * Tests del efecto de nubes y tormenta (pio test -e native).
+ */
+
+#include <unity.h>
+#include "channel/weather.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_repeatable_and_in_range(void)
+{
+    DomDomWeatherSettings settings;
+    settings.enabled = true;
+    settings.seed = 42;
+    settings.flashes_per_hour = 60;
+
+    // Empezamos cerca del desbordamiento de millis()
+    uint32_t start = UINT32_MAX - 60000;
+    DomDomWeather first, second, other;
+    first.configure(settings, start);
+    second.configure(settings, start);
+    settings.seed = 43;
+    other.configure(settings, start);
+
+    // Un dia a 100 Hz: con la misma semilla se repite la misma secuencia, con otra
+    // semilla cambia, y la corriente no sale nunca del rango del canal
+    uint32_t differences = 0, clouds = 0, flashes = 0;
+    uint32_t ticks = 24 * 360000;
+    for (uint32_t t = 0; t < ticks; t++)
+    {
+        uint32_t now = start + t * 10;
+        DomDomWeatherSample a = first.sample(now);
+        DomDomWeatherSample b = second.sample(now);
+        DomDomWeatherSample c = other.sample(now);
+
+        TEST_ASSERT_TRUE(a.dim == b.dim && a.flash == b.flash);
+        differences += a.dim != c.dim || a.flash != c.flash;
+        clouds += a.dim < WEATHER_ONE;
+        flashes += a.flash > 0;
+
+        float mA = DomDomWeather::apply(a, 500, 10, 1000);
+        TEST_ASSERT_TRUE(mA >= 10 && mA <= 1000);
+    }
+
+    // Con 20 nubes de 10 a 90 s por hora hay nube cerca de una quinta parte del tiempo
+    TEST_ASSERT_GREATER_THAN(0, differences);
+    TEST_ASSERT_GREATER_THAN(ticks / 10, clouds);
+    TEST_ASSERT_LESS_THAN(ticks * 3 / 10, clouds);
+    TEST_ASSERT_GREATER_THAN(0, flashes);
+}
+
+void test_apply_limits(void)
+{
+    // Sin efecto la consigna no cambia y un rayo no enciende un canal apagado
+    DomDomWeatherSample flash;
+    flash.flash = WEATHER_ONE;
+    TEST_ASSERT_EQUAL_FLOAT(500, DomDomWeather::apply(DomDomWeatherSample(), 500, 10, 1000));
+    TEST_ASSERT_EQUAL_FLOAT(0, DomDomWeather::apply(flash, 0, 0, 1000));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_repeatable_and_in_range);
+    RUN_TEST(test_apply_limits);
+    return UNITY_END();
+}